@@ -0,0 +1,184 @@
+#include "Analysis.h"
+#include <vector>
+#include <cmath>
+
+void Analysis::Initialize(CL* pOpenCL, uint32_t sampleSteps, bool withPairs)
+{
+	openCL = pOpenCL;
+	interval = sampleSteps;
+	pairs = withPairs;
+	pending = false;
+	step = 0;
+	sampleStep = 0;
+
+	// rows of partials hold the sums of both species, then their maxima, each row is one segment
+	uint32_t sumRows = 2*ANA_SUMS;
+	uint32_t maxRows = 2*ANA_MAXES;
+	std::vector<cl_uint> sumRowOffsets(sumRows+1), maxRowOffsets(maxRows+1);
+	for (uint32_t r=0; r <= sumRows; ++r) sumRowOffsets[r] = r * ANA_GROUPS;
+	for (uint32_t r=0; r <= maxRows; ++r) maxRowOffsets[r] = (sumRows + r) * ANA_GROUPS;
+
+	partials = cl::Buffer(openCL->context, CL_MEM_READ_WRITE, sizeof(cl_double)*(sumRows + maxRows)*ANA_GROUPS);
+	sumOffsets = cl::Buffer(openCL->context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(cl_uint)*sumRowOffsets.size(), sumRowOffsets.data());
+	maxOffsets = cl::Buffer(openCL->context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(cl_uint)*maxRowOffsets.size(), maxRowOffsets.data());
+	sums = cl::Buffer(openCL->context, CL_MEM_READ_WRITE, sizeof(cl_double)*sumRows);
+	maxes = cl::Buffer(openCL->context, CL_MEM_READ_WRITE, sizeof(cl_double)*maxRows);
+	values = cl::Buffer(openCL->context, CL_MEM_READ_WRITE, sizeof(cl_double)*2*ANA_VALUES);
+	hist = cl::Buffer(openCL->context, CL_MEM_READ_WRITE, sizeof(cl_uint)*ANA_HIST);
+	mesh = cl::Buffer(openCL->context, CL_MEM_READ_WRITE, sizeof(cl_uint)*ANA_CELLS);
+	for (int m=0; m < 2; ++m) {
+		modes[m] = cl::Buffer(openCL->context, CL_MEM_READ_WRITE, sizeof(cl_double2)*ANA_CELLS);
+	}
+
+	openCL->AnaT_Kernel.setArg(1, partials);
+	openCL->AnaS_Kernel.setArg(0, sums);
+	openCL->AnaS_Kernel.setArg(1, maxes);
+	openCL->AnaS_Kernel.setArg(2, values);
+	openCL->AnaH_Kernel.setArg(1, values);
+	openCL->AnaH_Kernel.setArg(2, hist);
+	openCL->AnaH_Kernel.setArg(3, mesh);
+	openCL->AnaP_Kernel.setArg(2, hist);
+	openCL->MeshD_Kernel.setArg(0, mesh);
+	openCL->MeshD_Kernel.setArg(1, modes[0]);
+	openCL->MeshP_Kernel.setArg(0, modes[1]);
+	openCL->MeshP_Kernel.setArg(1, values);
+
+	logFile.open(GLOBALS::DATA_FOLDER+ANALYSIS_LOG);
+	if (!logFile.is_open()) {
+		HandleFatalError(7, "Unable to open analysis log: "+GLOBALS::DATA_FOLDER+ANALYSIS_LOG);
+	}
+
+	// long format, one row per bin, so new kinds don't change the columns
+	logFile.precision(12);
+	logFile << "step,species,kind,bin,lo,hi,value\n";
+}
+
+void Analysis::Sample(ParticlePool& posPool, ParticlePool& negPool)
+{
+	Poll();
+	if (++step % interval != 0) return;
+
+	// only one sample in flight, a slow readback just skips the next one
+	if (pending) return;
+
+	openCL->queue.enqueueFillBuffer(hist, (cl_uint)0, 0, sizeof(cl_uint)*ANA_HIST);
+
+	// the centre and ranges have to be known before anything can be binned
+	ParticlePool* pools[2] = { &posPool, &negPool };
+	for (cl_uint s=0; s < 2; ++s) {
+		openCL->AnaT_Kernel.setArg(0, pools[s]->buffer);
+		openCL->AnaT_Kernel.setArg(2, pools[s]->count);
+		openCL->AnaT_Kernel.setArg(3, (cl_uint)(s*ANA_SUMS));
+		openCL->AnaT_Kernel.setArg(4, (cl_uint)(2*ANA_SUMS + s*ANA_MAXES));
+		openCL->AnalysisTerms();
+	}
+	openCL->SegmentedReduce(partials, sumOffsets, 2*ANA_SUMS, REDUCE_SUM, sums);
+	openCL->SegmentedReduce(partials, maxOffsets, 2*ANA_MAXES, REDUCE_MAX, maxes);
+	openCL->AnalysisStats();
+
+	for (cl_uint s=0; s < 2; ++s) {
+		cl_uint count = pools[s]->count;
+		sampleCount[s] = count;
+		openCL->queue.enqueueFillBuffer(mesh, (cl_uint)0, 0, sizeof(cl_uint)*ANA_CELLS);
+
+		openCL->AnaH_Kernel.setArg(0, pools[s]->buffer);
+		openCL->AnaH_Kernel.setArg(4, count);
+		openCL->AnaH_Kernel.setArg(5, s);
+		openCL->AnalysisHistograms(count);
+
+		// transform one axis at a time, ping-ponging so the result ends up in modes[1]
+		openCL->MeshD_Kernel.setArg(2, count);
+		openCL->MeshDelta();
+		for (cl_uint a=0; a < 3; ++a) {
+			openCL->MeshF_Kernel.setArg(0, modes[a & 1]);
+			openCL->MeshF_Kernel.setArg(1, modes[(a + 1) & 1]);
+			openCL->MeshF_Kernel.setArg(2, a);
+			openCL->MeshDFT();
+		}
+
+		openCL->MeshP_Kernel.setArg(2, s);
+		openCL->MeshPower();
+	}
+
+	if (pairs) {
+		openCL->AnaP_Kernel.setArg(0, posPool.buffer);
+		openCL->AnaP_Kernel.setArg(1, negPool.buffer);
+		openCL->AnaP_Kernel.setArg(3, posPool.count);
+		openCL->AnaP_Kernel.setArg(4, negPool.count);
+		openCL->AnalysisPairs(posPool.count);
+	}
+
+	// a few KB of bins come back without stalling the queue
+	openCL->queue.enqueueReadBuffer(values, CL_FALSE, 0, sizeof(hostValues), hostValues);
+	openCL->queue.enqueueReadBuffer(hist, CL_FALSE, 0, sizeof(hostHist), hostHist, NULL, &readEvent);
+	openCL->queue.flush();
+	sampleStep = step;
+	pending = true;
+}
+
+void Analysis::Poll()
+{
+	if (!pending || readEvent.getInfo<CL_EVENT_COMMAND_EXECUTION_STATUS>() != CL_COMPLETE) return;
+	pending = false;
+	WriteSample();
+}
+
+void Analysis::WriteBins(uint32_t species, const char* kind, const cl_uint* bins, double range, double scale)
+{
+	double width = range / ANA_BINS;
+	for (uint32_t b=0; b < ANA_BINS; ++b) {
+		logFile << sampleStep << ',' << (species == 0 ? "pos" : "neg") << ',' << kind << ',' << b;
+		logFile << ',' << b*width << ',' << (b+1)*width << ',' << bins[b] * scale << '\n';
+	}
+}
+
+void Analysis::WriteSample()
+{
+	const double pi = 3.14159265358979323846;
+	const double volume = SIM_POS_MOD * SIM_POS_MOD * SIM_POS_MOD;
+	const double kFund = 2.0 * pi / SIM_POS_MOD;
+
+	for (uint32_t s=0; s < 2; ++s) {
+		const cl_double* stats = hostValues + s*ANA_VALUES;
+		const cl_uint* bins = hostHist + s*3*ANA_BINS;
+		const char* sp = (s == 0) ? "pos" : "neg";
+
+		logFile << sampleStep << ',' << sp << ",total_mass,0,0,0," << stats[3] << '\n';
+		for (int a=0; a < 3; ++a) {
+			logFile << sampleStep << ',' << sp << ",centre," << a << ",0,0," << stats[a] << '\n';
+		}
+
+		// number density in each spherical shell about the species centre, distances taken across the wrap
+		double width = ANA_RADIUS_MAX / ANA_BINS;
+		for (uint32_t b=0; b < ANA_BINS; ++b) {
+			double lo = b*width;
+			double hi = (b+1)*width;
+			double shell = 4.0 / 3.0 * pi * (hi*hi*hi - lo*lo*lo);
+			logFile << sampleStep << ',' << sp << ",radial_density," << b << ',' << lo << ',' << hi;
+			logFile << ',' << bins[b] / shell << '\n';
+		}
+
+		WriteBins(s, "speed", bins + ANA_BINS, stats[4], 1.0);
+		WriteBins(s, "mass", bins + 2*ANA_BINS, stats[5], 1.0);
+
+		const cl_double* power = stats + ANA_STATS;
+		for (uint32_t b=0; b < ANA_K_BINS; ++b) {
+			double k = kFund * (b+1);
+			logFile << sampleStep << ',' << sp << ",power," << b << ',' << k - 0.5*kFund << ',' << k + 0.5*kFund;
+			logFile << ',' << power[b] << '\n';
+			logFile << sampleStep << ',' << sp << ",power_modes," << b << ',' << k - 0.5*kFund << ',' << k + 0.5*kFund;
+			logFile << ',' << power[ANA_K_BINS + b] << '\n';
+		}
+		// white noise floor of a Poisson sample, subtract it from power to compare runs of different size
+		double shotNoise = (sampleCount[s] > 0) ? volume / sampleCount[s] : 0.0;
+		logFile << sampleStep << ',' << sp << ",shot_noise,0,0,0," << shotNoise << '\n';
+	}
+
+	if (pairs) {
+		double width = ANA_SEP_MAX / ANA_BINS;
+		for (uint32_t b=0; b < ANA_BINS; ++b) {
+			logFile << sampleStep << ",pos_neg,pair_separation," << b << ',' << b*width << ',' << (b+1)*width;
+			logFile << ',' << hostHist[6*ANA_BINS + b] << '\n';
+		}
+	}
+}
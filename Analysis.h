@@ -0,0 +1,39 @@
+#pragma once
+#include "OpenCL.h"
+#include "ParticlePool.h"
+#include <fstream>
+
+// density profiles, histograms and power spectra reduced on the device every few steps,
+// only the binned results ever come back to the host
+class Analysis
+{
+public:
+	void Initialize(CL* pOpenCL, uint32_t sampleSteps, bool withPairs);
+	void Sample(ParticlePool& posPool, ParticlePool& negPool);
+	void Poll();
+private:
+	void WriteSample();
+	void WriteBins(uint32_t species, const char* kind, const cl_uint* bins, double range, double scale);
+public:
+	uint32_t interval;
+	bool pairs;
+private:
+	CL* openCL;
+	cl::Buffer partials;
+	cl::Buffer sumOffsets;
+	cl::Buffer maxOffsets;
+	cl::Buffer sums;
+	cl::Buffer maxes;
+	cl::Buffer values;
+	cl::Buffer hist;
+	cl::Buffer mesh;
+	cl::Buffer modes[2];
+	cl::Event readEvent;
+	cl_double hostValues[2*ANA_VALUES];
+	cl_uint hostHist[ANA_HIST];
+	cl_uint sampleCount[2];
+	bool pending;
+	uint64_t step;
+	uint64_t sampleStep;
+	std::ofstream logFile;
+};
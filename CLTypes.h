@@ -1,64 +1,116 @@
-#pragma once
-#include "OpenCL.h"
-
-#pragma pack(push,1)
-
-struct cl_RGB32
-{
-	cl_uchar CL_ALIGNED(4) s[4];
-}; // 4 bytes
-
-struct cl_Material
-{
-	cl_float3 ambient;
-	cl_float3 diffuse;
-	cl_float3 specular;
-	cl_float shininess;
-	cl_float glossiness;
-	cl_float reflectivity;
-	cl_float transparency;
-}; // 64 bytes
-
-struct cl_AAInfo
-{
-	cl_short lvl;
-	cl_short dim;
-	cl_float inc;
-	cl_float div;
-}; // 16 bytes
-
-struct cl_CamInfo {
-	cl_double3 bl_ray;
-	cl_double3 cam_pos;
-	cl_double3 cam_ori;
-	cl_double3 cam_fwd;
-	cl_double3 cam_rgt;
-	cl_double3 cam_up;
-	cl_double cam_foc;
-	cl_double cam_apt;
-}; // 208 bytes
-
-struct cl_RenderInfo
-{
-	cl_CamInfo cam_info;
-	cl_float d_time;
-	cl_uint span_X;
-	cl_uint span_Y;
-	cl_uint pixels_X;
-	cl_uint pixels_Y;
-	cl_uint half_X;
-	cl_uint half_Y;
-	cl_uint rand_int;
-	cl_uint particles;
-	cl_AAInfo aa_info;
-}; // 256 bytes
-
-typedef struct {
-	cl_double3 new_pos;
-	cl_double3 position;
-	cl_double3 velocity;
-	cl_float mass;
-	cl_float radius;
-} cl_Particle; // 104 bytes
-
-#pragma pack(pop)
+#pragma once
+#include "OpenCL.h"
+
+#pragma pack(push,1)
+
+struct cl_RGB32
+{
+	cl_uchar CL_ALIGNED(4) s[4];
+}; // 4 bytes
+
+struct cl_CovFrags
+{
+	cl_uint color;
+	cl_uint mask;
+}; // 8 bytes
+
+struct cl_Material
+{
+	cl_float3 ambient;
+	cl_float3 diffuse;
+	cl_float3 specular;
+	cl_float shininess;
+	cl_float glossiness;
+	cl_float reflectivity;
+	cl_float transparency;
+}; // 64 bytes
+
+struct cl_AAInfo
+{
+	cl_short lvl;
+	cl_short dim;
+	cl_float inc;
+	cl_float div;
+}; // 16 bytes
+
+struct cl_CamInfo {
+	cl_double3 bl_ray;
+	cl_double3 cam_pos;
+	cl_double3 cam_ori;
+	cl_double3 cam_fwd;
+	cl_double3 cam_rgt;
+	cl_double3 cam_up;
+	cl_double cam_foc;
+	cl_double cam_apt;
+}; // 208 bytes
+
+struct cl_RenderInfo
+{
+	cl_CamInfo cam_info;
+	cl_float d_time;
+	cl_uint span_X;
+	cl_uint span_Y;
+	cl_uint pixels_X;
+	cl_uint pixels_Y;
+	cl_uint half_X;
+	cl_uint half_Y;
+	cl_uint rand_int;
+	cl_uint pos_count;
+	cl_uint neg_count;
+	cl_uint padding;
+	cl_AAInfo aa_info;
+	cl_float2 jitter;
+	cl_double4 view_proj[4];
+	cl_float4 view_rot[4];
+}; // 464 bytes
+
+typedef struct {
+	cl_double3 new_pos;
+	cl_double3 position;
+	cl_double3 velocity;
+	cl_float mass;
+	cl_float radius;
+} cl_Particle; // 104 bytes
+
+struct cl_CompactParticle
+{
+	cl_uint new_pos[3];
+	cl_uint position[3];
+	cl_float velocity[3];
+	cl_float mass;
+}; // 40 bytes
+
+struct cl_SystemInfo
+{
+	cl_ulong seed;
+	cl_double g;
+	cl_uint pos_first;
+	cl_uint pos_count;
+	cl_uint neg_first;
+	cl_uint neg_count;
+}; // 32 bytes
+
+struct cl_VisParticle
+{
+	cl_float2 coords;
+	cl_float radius;
+	cl_float depth;
+}; // 16 bytes
+
+struct cl_CullStats
+{
+	cl_uint points;
+	cl_uint discs;
+	cl_uint behind;
+	cl_uint offscreen;
+}; // 16 bytes
+
+struct cl_GridInfo
+{
+	cl_uint max_radius;
+	cl_uint dim;
+	cl_float cell_size;
+	cl_uint pair_count;
+}; // 16 bytes
+
+#pragma pack(pop)
@@ -13,6 +13,75 @@
 #define IMP_MAX 24998.5
 #define IMP_MIN 5000.5
 #define INV_MASS 20000000.0
+#define FIXED_SCALE (4294967296.0 / POS_MOD)
+#define FIXED_STEP (POS_MOD / 4294967296.0)
+
+#define CULL_WG_SIZE 256
+#define CULL_POINT 0
+#define CULL_DISC 1
+#define CULL_BEHIND 2
+#define CULL_OFFSCREEN 3
+#define CULL_NONE 4
+
+#define DENS_BINS 64
+#define DENS_BIN_RES 2.0f
+#define DENS_ONE 256.0f
+#define DENS_SCALE (1.0f/256.0f)
+#define DENS_PERCENTILE 0.99f
+#define DENS_ADAPT 0.05f
+
+#define GRID_MAX_DIM 64
+#define GRID_EMPTY 0xFFFFFFFF
+#define GRID_NEG_BIT 0x80000000
+#define GRID_INDEX_MASK 0x7FFFFFFF
+#define COLLIDE_BOUNCE 1
+#define COLLIDE_MERGE 2
+
+#define CURVE_BITS 10
+#define CURVE_CELLS 1024
+#define CURVE_HILBERT 1
+
+#define DIAG_TERMS 11
+#define DIAG_CENTER 15000.0
+#define ENS_TERMS 7
+
+#define ANA_BINS 64
+#define ANA_STATS 6
+#define ANA_SUMS 7
+#define ANA_MAXES 2
+#define ANA_MESH 32
+#define ANA_CELLS (ANA_MESH*ANA_MESH*ANA_MESH)
+#define ANA_K_BINS (ANA_MESH/2)
+#define ANA_VALUES (ANA_STATS + 2*ANA_K_BINS)
+#define ANA_RADIUS_MAX (POS_MOD * 0.5)
+#define ANA_SEP_MAX (POS_MOD * 0.8660254037844386)
+
+#define FOF_TERMS 9
+
+#define INIT_UNIFORM 0
+#define INIT_LATTICE 1
+#define INIT_PLUMMER 2
+#define INIT_DISK 3
+#define INIT_CLUMPS 4
+#define INIT_CENTER 15000.0
+#define INIT_EXTENT 4990.0
+#define INIT_JITTER 0.5
+#define INIT_PLUMMER_A 625.0
+#define INIT_DISK_RD 800.0
+#define INIT_DISK_THICK 40.0
+#define INIT_CLUMP_RANGE 3000.0
+#define INIT_TRIES 32
+#define PHILOX_M0 0xD2511F53
+#define PHILOX_M1 0xCD9E8D57
+#define PHILOX_W0 0x9E3779B9
+#define PHILOX_W1 0xBB67AE85
+
+#define TAA_EMPTY 0xFFFFFFFF
+#define TAA_LOG_FAR 16.61f
+#define TAA_FAR 100000.0
+#define TAA_BLEND 0.1f
+#define TAA_MAX_MOTION 16.0f
+#define TAA_DEPTH_TOL 0.1f
 
 #pragma pack(push,1)
 
@@ -46,13 +115,28 @@ typedef struct {
 	uint half_X;
 	uint half_Y;
 	uint rand_int;
-	uint particles;
+	uint pos_count;
+	uint neg_count;
+	uint padding;
 	short aa_lvl;
 	short aa_dim;
 	float aa_inc;
 	float aa_div;
+	float2 jitter;
+	double4 view_proj[4];
+	float4 view_rot[4];
 } RenderInfo;
 
+typedef struct {
+	double3 bl_ray;
+	double3 cam_pos;
+	double3 cam_ori;
+	double3 cam_fwd;
+	double3 cam_rgt;
+	double3 cam_up;
+	double2 cam_set;
+} CamInfo;
+
 typedef struct {
 	double3 new_pos;
 	double3 position;
@@ -61,8 +145,60 @@ typedef struct {
 	float radius;
 } Particle;
 
+typedef struct {
+	ulong seed;
+	double g;
+	uint pos_first;
+	uint pos_count;
+	uint neg_first;
+	uint neg_count;
+} SystemInfo;
+
+#ifdef COMPACT_PARTICLES
+// 40 bytes in memory, positions are 32-bit fixed point across the box and the
+// radius is rebuilt from the mass the same way generation and merging set it
+typedef struct {
+	uint new_pos[3];
+	uint position[3];
+	float velocity[3];
+	float mass;
+} StoredParticle;
+#else
+typedef Particle StoredParticle;
+#endif
+
 #pragma pack(pop)
 
+typedef struct {
+	uint color;
+	uint mask;
+} CFrags;
+
+typedef struct {
+	uint data;
+} TFrags;
+
+#if defined(AA_COVERAGE)
+	typedef CFrags FragData;
+#elif defined(AA_TEMPORAL)
+	typedef TFrags FragData;
+#else
+	typedef PFrags FragData;
+#endif
+
+typedef struct {
+	float2 coords;
+	float radius;
+	float depth;
+} VisParticle;
+
+typedef struct {
+	uint max_radius;
+	uint dim;
+	float cell_size;
+	uint pair_count;
+} GridInfo;
+
 // ------------------------------ //
 // ------ VECTOR FUNCTIONS ------ //
 // ------------------------------ //
@@ -97,6 +233,142 @@ double3 VectRot(const double3 v, const double3 rot)
 	result = VectRotZ(result, rot.z);
 	return VectRotX(result, rot.x);
 }
+double3 PeriodicDiff(const double3 diff)
+{
+	// shortest separation across the wrapped box
+	return diff - POS_MOD * round(diff / POS_MOD);
+}
+double3 WrapPosition(double3 pos)
+{
+	pos.x -= (pos.x > POS_MAX) ? POS_MOD : 0.0;
+	pos.y -= (pos.y > POS_MAX) ? POS_MOD : 0.0;
+	pos.z -= (pos.z > POS_MAX) ? POS_MOD : 0.0;
+	pos.x += (pos.x < POS_MIN) ? POS_MOD : 0.0;
+	pos.y += (pos.y < POS_MIN) ? POS_MOD : 0.0;
+	pos.z += (pos.z < POS_MIN) ? POS_MOD : 0.0;
+	return pos;
+}
+
+// ------------------------------ //
+// ------ PARTICLE STORAGE ------ //
+// ------------------------------ //
+
+#ifdef COMPACT_PARTICLES
+void EncodePosition(__global uint* fixed, const double3 pos)
+{
+	// one box width spans the whole 32-bit range so the integer wrap is the periodic wrap
+	long3 steps = convert_long3_rte((pos - POS_MIN) * FIXED_SCALE);
+	fixed[0] = (uint)steps.x;
+	fixed[1] = (uint)steps.y;
+	fixed[2] = (uint)steps.z;
+}
+double3 DecodePosition(__global const uint* fixed)
+{
+	return POS_MIN + (double3)((double)fixed[0], (double)fixed[1], (double)fixed[2]) * FIXED_STEP;
+}
+#endif
+
+double3 LoadPosition(__global const StoredParticle* buffer, const uint index)
+{
+#ifdef COMPACT_PARTICLES
+	return DecodePosition(buffer[index].position);
+#else
+	return buffer[index].position;
+#endif
+}
+double3 LoadNewPos(__global const StoredParticle* buffer, const uint index)
+{
+#ifdef COMPACT_PARTICLES
+	return DecodePosition(buffer[index].new_pos);
+#else
+	return buffer[index].new_pos;
+#endif
+}
+double3 LoadVelocity(__global const StoredParticle* buffer, const uint index)
+{
+#ifdef COMPACT_PARTICLES
+	__global const float* vel = buffer[index].velocity;
+	return (double3)(vel[0], vel[1], vel[2]);
+#else
+	return buffer[index].velocity;
+#endif
+}
+float LoadMass(__global const StoredParticle* buffer, const uint index)
+{
+	return buffer[index].mass;
+}
+float LoadRadius(__global const StoredParticle* buffer, const uint index)
+{
+#ifdef COMPACT_PARTICLES
+	return sqrt(fabs(buffer[index].mass) / M_PI_F);
+#else
+	return buffer[index].radius;
+#endif
+}
+Particle LoadParticle(__global const StoredParticle* buffer, const uint index)
+{
+#ifdef COMPACT_PARTICLES
+	Particle prtcl;
+	prtcl.new_pos = LoadNewPos(buffer, index);
+	prtcl.position = LoadPosition(buffer, index);
+	prtcl.velocity = LoadVelocity(buffer, index);
+	prtcl.mass = LoadMass(buffer, index);
+	prtcl.radius = LoadRadius(buffer, index);
+	return prtcl;
+#else
+	return buffer[index];
+#endif
+}
+
+void StoreNewPos(__global StoredParticle* buffer, const uint index, const double3 new_pos)
+{
+#ifdef COMPACT_PARTICLES
+	EncodePosition(buffer[index].new_pos, new_pos);
+#else
+	buffer[index].new_pos = new_pos;
+#endif
+}
+void StorePosition(__global StoredParticle* buffer, const uint index, const double3 position)
+{
+#ifdef COMPACT_PARTICLES
+	EncodePosition(buffer[index].position, position);
+#else
+	buffer[index].position = position;
+#endif
+}
+void StoreVelocity(__global StoredParticle* buffer, const uint index, const double3 velocity)
+{
+#ifdef COMPACT_PARTICLES
+	__global float* vel = buffer[index].velocity;
+	vel[0] = (float)velocity.x;
+	vel[1] = (float)velocity.y;
+	vel[2] = (float)velocity.z;
+#else
+	buffer[index].velocity = velocity;
+#endif
+}
+void StoreParticle(__global StoredParticle* buffer, const uint index, const Particle prtcl)
+{
+#ifdef COMPACT_PARTICLES
+	StoreNewPos(buffer, index, prtcl.new_pos);
+	StorePosition(buffer, index, prtcl.position);
+	StoreVelocity(buffer, index, prtcl.velocity);
+	buffer[index].mass = prtcl.mass;
+#else
+	buffer[index] = prtcl;
+#endif
+}
+void CommitParticle(__global StoredParticle* buffer, const uint index)
+{
+	// a plain copy in either layout, the fixed-point words never need decoding here
+#ifdef COMPACT_PARTICLES
+	buffer[index].position[0] = buffer[index].new_pos[0];
+	buffer[index].position[1] = buffer[index].new_pos[1];
+	buffer[index].position[2] = buffer[index].new_pos[2];
+#else
+	buffer[index].position = buffer[index].new_pos;
+#endif
+}
 
 // ------------------------------ //
 // ------- MISC FUNCTIONS ------- //
@@ -107,6 +379,38 @@ float4 VectToColor(const float3 v)
 	return (float4)(v / 255, 1.0f);
 }
 
+float3 ColorToVect(const RGB32 color)
+{
+	return (float3)(color.red, color.green, color.blue) / 255;
+}
+
+uint PackColor(const RGB32 color)
+{
+	return color.blue | (color.green << 8) | (color.red << 16) | (255 << 24);
+}
+
+float3 UnpackColor(const uint color)
+{
+	return (float3)((color >> 16) & 0xFF, (color >> 8) & 0xFF, color & 0xFF);
+}
+
+uint PackDepthColor(const float depth, const RGB32 color)
+{
+	// log depth in the high bits so atomic_min keeps the nearest sample
+	uint depth_bits = clamp(log2(depth) / TAA_LOG_FAR, 0.0f, 1.0f) * 65534.0f;
+	return (depth_bits << 16) | ((color.red >> 3) << 11) | ((color.green >> 2) << 5) | (color.blue >> 3);
+}
+
+float3 UnpackColor565(const uint data)
+{
+	return (float3)(((data >> 11) & 0x1F) / 31.0f, ((data >> 5) & 0x3F) / 63.0f, (data & 0x1F) / 31.0f);
+}
+
+float UnpackDepth(const uint data)
+{
+	return exp2((data >> 16) / 65534.0f * TAA_LOG_FAR);
+}
+
 char is_black(const RGB32 color) {
 	if (color.red == 0 && color.green == 0 && color.blue == 0) {
 		return 1;
@@ -115,22 +419,287 @@ char is_black(const RGB32 color) {
 	}
 }
 
-ulong rand_long(ulong seed) {
-	seed ^= seed >> 12;
-	seed ^= seed << 25;
-	seed ^= seed >> 27;
-	return seed * 0x2545F4914F6CDD1D;
+uint4 Philox4x32(uint4 ctr, uint2 key)
+{
+	// Philox4x32-10, the output depends only on the counter and key so any draw can be made directly
+	for (uint r=0; r < 10; ++r) {
+		uint hi0 = mul_hi((uint)PHILOX_M0, ctr.x);
+		uint hi1 = mul_hi((uint)PHILOX_M1, ctr.z);
+		ctr = (uint4)(hi1 ^ ctr.y ^ key.x, PHILOX_M1 * ctr.z, hi0 ^ ctr.w ^ key.y, PHILOX_M0 * ctr.x);
+		key += (uint2)(PHILOX_W0, PHILOX_W1);
+	}
+	return ctr;
+}
+
+double UnitDouble(const uint a, const uint b)
+{
+	// 53 random bits mapped to [0,1)
+	return ((a >> 5) * 67108864.0 + (b >> 6)) * (1.0 / 9007199254740992.0);
+}
+
+double4 RandomUnits(const ulong seed, const uint index, const uint species, const uint draw)
+{
+	// draw numbers a stream so one particle can take as many values as it needs
+	uint2 key = (uint2)((uint)seed, (uint)(seed >> 32));
+	uint4 bits0 = Philox4x32((uint4)(index, species, draw*2, 0), key);
+	uint4 bits1 = Philox4x32((uint4)(index, species, draw*2+1, 0), key);
+	return (double4)(UnitDouble(bits0.x, bits0.y), UnitDouble(bits0.z, bits0.w),
+					 UnitDouble(bits1.x, bits1.y), UnitDouble(bits1.z, bits1.w));
+}
+
+double2 GaussPair(const double2 u)
+{
+	// Box-Muller, 1-u keeps the log away from zero
+	double r = sqrt(-2.0 * log(1.0 - u.x));
+	return (double2)(r * cos(2.0 * M_PI * u.y), r * sin(2.0 * M_PI * u.y));
+}
+
+double3 RandomDirection(const double2 u)
+{
+	double z = 2.0 * u.x - 1.0;
+	double s = sqrt(max(1.0 - z*z, 0.0));
+	return (double3)(s * cos(2.0 * M_PI * u.y), s * sin(2.0 * M_PI * u.y), z);
+}
+
+double CircularSpeed(const double mass, const double dist)
+{
+	// velocity is integrated as v += F/m and x += v*SPEED_MULT so speeds carry a 1/SPEED_MULT
+	return sqrt(G * mass / (max(dist, 1.0) * SPEED_MULT));
+}
+
+uint SpreadBits(uint v)
+{
+	// put two zero bits between each of the low 10 bits
+	v &= 0x3FF;
+	v = (v | (v << 16)) & 0x030000FF;
+	v = (v | (v << 8)) & 0x0300F00F;
+	v = (v | (v << 4)) & 0x030C30C3;
+	v = (v | (v << 2)) & 0x09249249;
+	return v;
+}
+
+uint MortonKey(const uint3 cell)
+{
+	return SpreadBits(cell.x) | (SpreadBits(cell.y) << 1) | (SpreadBits(cell.z) << 2);
+}
+
+uint HilbertKey(const uint3 cell)
+{
+	// Skilling's axes to transpose conversion followed by bit interleaving
+	uint axes[3] = { cell.x, cell.y, cell.z };
+	uint p, t, key = 0;
+	
+	for (uint q = 1 << (CURVE_BITS-1); q > 1; q >>= 1) {
+		p = q - 1;
+		for (int i=0; i < 3; ++i) {
+			if (axes[i] & q) {
+				axes[0] ^= p;
+			} else {
+				t = (axes[0] ^ axes[i]) & p;
+				axes[0] ^= t;
+				axes[i] ^= t;
+			}
+		}
+	}
+	
+	axes[1] ^= axes[0];
+	axes[2] ^= axes[1];
+	t = 0;
+	for (uint q = 1 << (CURVE_BITS-1); q > 1; q >>= 1) {
+		if (axes[2] & q) t ^= q - 1;
+	}
+	
+	for (int b = CURVE_BITS-1; b >= 0; --b) {
+		for (int i=0; i < 3; ++i) {
+			key = (key << 1) | ((axes[i] ^ t) >> b & 1);
+		}
+	}
+	
+	return key;
+}
+
+// ------------------------------ //
+// ------- DRAW FUNCTIONS ------- //
+// ------------------------------ //
+
+uint ProjectParticle(const double3 position, const float radius, const RenderInfo render_info,
+float2* screen_coords, float* p_prad, float* p_depth)
+{
+#ifdef FLOAT_PROJECTION
+	// the camera offset is taken in double so the float matrix only sees small values
+	float3 rel = convert_float3(position - render_info.cam_pos);
+	float4 clip = (float4)(dot(render_info.view_rot[0].xyz, rel), dot(render_info.view_rot[1].xyz, rel),
+						   dot(render_info.view_rot[2].xyz, rel), dot(render_info.view_rot[3].xyz, rel));
+	float p_dist = length(rel);
+#else
+	double4 point = (double4)(position, 1.0);
+	double4 clip = (double4)(dot(render_info.view_proj[0], point), dot(render_info.view_proj[1], point),
+							 dot(render_info.view_proj[2], point), dot(render_info.view_proj[3], point));
+	double p_dist = length(position - render_info.cam_pos);
+#endif
+	
+	if (clip.w <= 0.0f) { return CULL_BEHIND; }
+	
+	*p_depth = clip.z;
+	screen_coords->x = clip.x / clip.w;
+	screen_coords->y = clip.y / clip.w;
+	*p_prad = (render_info.cam_set.x / p_dist) * radius;
+	
+	if (screen_coords->x + *p_prad > 0.0f && screen_coords->x - *p_prad < render_info.pixels_X
+	&& screen_coords->y + *p_prad > 0.0f && screen_coords->y - *p_prad < render_info.pixels_Y) {
+		return (*p_prad < 0.5f) ? CULL_POINT : CULL_DISC;
+	}
+	
+	return CULL_OFFSCREEN;
+}
+
+void WriteSample(__global FragData* frag_buffer, const int pix_index,
+const int frag_index, const float p_depth, const RGB32 color)
+{
+#if defined(AA_TEMPORAL)
+	atomic_min(&frag_buffer[pix_index].data, PackDepthColor(p_depth, color));
+#elif defined(AA_COVERAGE)
+	// first color to claim the pixel owns it, matching samples add coverage
+	uint color_bits = PackColor(color);
+	uint old_bits = atomic_cmpxchg(&frag_buffer[pix_index].color, 0, color_bits);
+	if (old_bits == 0 || old_bits == color_bits) {
+		atomic_or(&frag_buffer[pix_index].mask, 1 << frag_index);
+	}
+#else
+	PFrags tmp_frags = frag_buffer[pix_index];
+	if (is_black(tmp_frags.colors[frag_index]) == 1)
+		frag_buffer[pix_index].colors[frag_index] = color;
+#endif
+}
+
+void PlotParticle(__global FragData* frag_buffer, const float2 screen_coords,
+const float p_prad, const float p_depth, const RGB32 color, const RenderInfo render_info)
+{
+	int frag_index, pix_index;
+	int2 pixel_coords, ifrag_coords;
+	float2 ffrag_coords;
+	
+#ifdef AA_TEMPORAL
+	// a single sample per pixel, offset by this frame's jitter
+	if (p_prad < 0.5f) {
+		pixel_coords = convert_int2(floor(screen_coords - render_info.jitter + 0.5f));
+		if (pixel_coords.x >= 0 && pixel_coords.y >= 0
+		&& pixel_coords.x < render_info.pixels_X && pixel_coords.y < render_info.pixels_Y) {
+			pix_index = (pixel_coords.y * render_info.pixels_X) + pixel_coords.x;
+			WriteSample(frag_buffer, pix_index, 0, p_depth, color);
+		}
+	} else {
+		int2 pix_min = convert_int2(ceil(screen_coords - p_prad - render_info.jitter));
+		int2 pix_max = convert_int2(ceil(screen_coords + p_prad - render_info.jitter));
+		pix_min = max(pix_min, (int2)(0, 0));
+		pix_max = min(pix_max, (int2)((int)render_info.pixels_X, (int)render_info.pixels_Y));
+		
+		for (pixel_coords.y = pix_min.y; pixel_coords.y < pix_max.y; ++pixel_coords.y) {
+			for (pixel_coords.x = pix_min.x; pixel_coords.x < pix_max.x; ++pixel_coords.x) {
+				ffrag_coords = convert_float2(pixel_coords) + render_info.jitter - screen_coords;
+				if (dot(ffrag_coords, ffrag_coords) < p_prad*p_prad) {
+					pix_index = (pixel_coords.y * render_info.pixels_X) + pixel_coords.x;
+					WriteSample(frag_buffer, pix_index, 0, p_depth, color);
+				}
+			}
+		}
+	}
+	return;
+#endif
+	
+#ifdef AA_COVERAGE
+	const int frag_dim = render_info.aa_dim;
+	const float frag_inc = render_info.aa_inc;
+	const float frag_mult = render_info.aa_dim - 0.000001f;
+#else
+	const int frag_dim = 2;
+	const float frag_inc = 0.5f;
+	const float frag_mult = ALMOST_TWO;
+#endif
+	
+	if (p_prad < 0.5f) {
+		pixel_coords.x = screen_coords.x;
+		pixel_coords.y = screen_coords.y;
+		if (pixel_coords.x < render_info.pixels_X
+		&& pixel_coords.y < render_info.pixels_Y) {
+			ffrag_coords.x = screen_coords.x - pixel_coords.x;
+			ffrag_coords.y = screen_coords.y - pixel_coords.y;
+			ifrag_coords.x = ffrag_coords.x * frag_mult;
+			ifrag_coords.y = ffrag_coords.y * frag_mult;
+			pix_index = (pixel_coords.y * render_info.pixels_X) + pixel_coords.x;
+			frag_index = (ifrag_coords.y * frag_dim) + ifrag_coords.x;
+			WriteSample(frag_buffer, pix_index, frag_index, p_depth, color);
+		}
+	} else {
+		float p_right = screen_coords.x+p_prad;
+		float p_left = screen_coords.x-p_prad;
+		float p_top = screen_coords.y+p_prad;
+		float p_bot = screen_coords.y-p_prad;
+		
+		for (float y = p_bot; y < p_top; y += frag_inc) {
+			pixel_coords.y = y;
+			if (pixel_coords.y >= render_info.pixels_Y) { break; }
+			for (float x = p_left; x < p_right; x += frag_inc) {
+				pixel_coords.x = x;
+				if (pixel_coords.x >= render_info.pixels_X) { break; }
+				if (sqrt(((x-screen_coords.x)*(x-screen_coords.x)
+				+(y-screen_coords.y)*(y-screen_coords.y))) < p_prad)
+				{	
+					ffrag_coords.x = x - pixel_coords.x;
+					ffrag_coords.y = y - pixel_coords.y;
+					ifrag_coords.x = ffrag_coords.x * frag_mult;
+					ifrag_coords.y = ffrag_coords.y * frag_mult;	
+					pix_index = (pixel_coords.y * render_info.pixels_X) + pixel_coords.x;
+					frag_index = (ifrag_coords.y * frag_dim) + ifrag_coords.x;
+					WriteSample(frag_buffer, pix_index, frag_index, p_depth, color);
+				}
+			}
+		}
+	}
+}
+
+void AddDensity(__global uint* dens_buffer, const int x, const int y,
+const float weight, const uint channel, const RenderInfo render_info)
+{
+	if (x >= 0 && y >= 0 && x < (int)render_info.pixels_X && y < (int)render_info.pixels_Y) {
+		uint fixed_weight = weight * DENS_ONE + 0.5f;
+		if (fixed_weight > 0) {
+			atomic_add(&dens_buffer[(((y * render_info.pixels_X) + x) * 2) + channel], fixed_weight);
+		}
+	}
+}
+
+void SplatDensity(__global uint* dens_buffer, const float2 screen_coords,
+const uint channel, const RenderInfo render_info)
+{
+	// bilinear splat over the four nearest pixel centers
+	float2 fcoords = screen_coords - 0.5f;
+	float2 base = floor(fcoords);
+	float2 frac = fcoords - base;
+	int2 pix = convert_int2(base);
+	
+	AddDensity(dens_buffer, pix.x, pix.y, (1.0f-frac.x)*(1.0f-frac.y), channel, render_info);
+	AddDensity(dens_buffer, pix.x+1, pix.y, frac.x*(1.0f-frac.y), channel, render_info);
+	AddDensity(dens_buffer, pix.x, pix.y+1, (1.0f-frac.x)*frac.y, channel, render_info);
+	AddDensity(dens_buffer, pix.x+1, pix.y+1, frac.x*frac.y, channel, render_info);
 }
 
 // ------------------------------ //
 // ------ KERNEL FUNCTIONS ------ //
 // ------------------------------ //
 
-__kernel void FillFragBuff(__global PFrags* frag_buffer, const RenderInfo render_info)
+__kernel void FillFragBuff(__global FragData* frag_buffer, const RenderInfo render_info)
 {
     uint pix_X = get_global_id(0);
 	uint pix_Y = get_global_id(1);
 	uint pix_index = (pix_Y * render_info.pixels_X) + pix_X;
+	
+#if defined(AA_TEMPORAL)
+	frag_buffer[pix_index].data = TAA_EMPTY;
+#elif defined(AA_COVERAGE)
+	frag_buffer[pix_index].color = 0;
+	frag_buffer[pix_index].mask = 0;
+#else
 	PFrags frags;
 	
 	for (unsigned int r=0; r < render_info.aa_lvl; ++r) {
@@ -140,75 +709,117 @@ __kernel void FillFragBuff(__global PFrags* frag_buffer, const RenderInfo render
 	}
 	
 	frag_buffer[pix_index] = frags;
+#endif
 }
 
-__kernel void GenParticles(__global Particle* prtcl_buffer, const char is_neg, const RenderInfo render_info)
+__kernel void FillDensBuff(__global uint2* dens_buffer, __global uint* hist_buffer, const RenderInfo render_info)
 {
-    uint prtcl_index = get_global_id(0);
-	Particle particle;
-	ulong seed;
+    uint pix_X = get_global_id(0);
+	uint pix_Y = get_global_id(1);
+	uint pix_index = (pix_Y * render_info.pixels_X) + pix_X;
 	
-	if (is_neg == 1) {
-		seed = prtcl_index + (long)9876543210; //+(long)render_info.rand_int
+	dens_buffer[pix_index] = (uint2)(0, 0);
+	if (pix_index < DENS_BINS) { hist_buffer[pix_index] = 0; }
+}
+
+Particle GenerateParticle(const uint species, const uint prtcl_index, const uint count, const uint dist,
+const ulong seed, const uint clumps)
+{
+	double4 u0 = RandomUnits(seed, prtcl_index, species, 0);
+	double4 u1 = RandomUnits(seed, prtcl_index, species, 1);
+	double total_mass = count * (MASS_MIN + 0.5 * MASS_MOD);
+	double3 center = (double3)(INIT_CENTER, INIT_CENTER, INIT_CENTER);
+	double3 offset = (double3)(0.0, 0.0, 0.0);
+	Particle particle;
+
+	particle.velocity = (double3)(0.0, 0.0, 0.0);
+
+	if (dist == INIT_LATTICE) {
+		// the species sit on lattices shifted by half a cell so their sites never coincide
+		uint side = max((uint)ceil(cbrt((double)count)), (uint)1);
+		double spacing = POS_MOD / (double)side;
+		double3 cell = (double3)((double)(prtcl_index % side), (double)((prtcl_index / side) % side), (double)(prtcl_index / (side * side)));
+		cell += 0.5 + 0.5 * species + INIT_JITTER * (u0.xyz - 0.5);
+		particle.position = POS_MIN + fmod(cell, (double3)((double)side)) * spacing;
+	} else if (dist == INIT_PLUMMER) {
+		// invert the enclosed mass fraction, truncated so the sphere stays inside the box
+		double a = INIT_PLUMMER_A;
+		double cut = pow(INIT_EXTENT*INIT_EXTENT / (INIT_EXTENT*INIT_EXTENT + a*a), 1.5);
+		double frac = max(u0.x * cut, 1e-12);
+		double radius = a / sqrt(pow(frac, -2.0/3.0) - 1.0);
+		offset = radius * RandomDirection(u0.yz);
+
+		// speed as a fraction of escape speed by rejection on q^2 (1-q^2)^3.5
+		double q = 0.0;
+		for (uint t=0; t < INIT_TRIES; ++t) {
+			double4 ut = RandomUnits(seed, prtcl_index, species, 2 + t);
+			if (0.1 * ut.y < ut.x*ut.x * pow(1.0 - ut.x*ut.x, 3.5)) {
+				q = ut.x;
+				break;
+			}
+		}
+		double escape = sqrt(2.0) * CircularSpeed(total_mass, a) * pow(1.0 + radius*radius / (a*a), -0.25);
+		particle.velocity = q * escape * RandomDirection(u1.xy);
+	} else if (dist == INIT_DISK) {
+		// exponential surface density in the xy plane, r ~ Gamma(2, Rd), spinning about z
+		double radius = min(-INIT_DISK_RD * log((1.0 - u0.x) * (1.0 - u0.y)), INIT_EXTENT);
+		double angle = 2.0 * M_PI * u0.z;
+		double x = radius / INIT_DISK_RD;
+		double enclosed = total_mass * (1.0 - (1.0 + x) * exp(-x));
+		offset = (double3)(radius * cos(angle), radius * sin(angle), INIT_DISK_THICK * GaussPair(u1.xy).x);
+		particle.velocity = CircularSpeed(enclosed, radius) * (double3)(-sin(angle), cos(angle), 0.0);
+	} else if (dist == INIT_CLUMPS) {
+		// each species gets its own clump centres, drawn from the clump index instead of the particle
+		uint clump = prtcl_index % max(clumps, (uint)1);
+		double4 uc = RandomUnits(seed, clump, species + 2, 0);
+		double sigma = POS_MOD / (8.0 * cbrt((double)max(clumps, (uint)1)));
+		center += INIT_CLUMP_RANGE * (2.0 * uc.xyz - 1.0);
+		offset = sigma * (double3)(GaussPair(u0.xy), GaussPair(u0.zw).x);
 	} else {
-		seed = prtcl_index + (long)1234567890; //+(long)render_info.rand_int
-	}
-
-	seed = rand_long(seed);
-	particle.position.x = (seed % POS_MOD) + POS_MIN;
-	seed = rand_long(seed);
-	particle.position.y = (seed % POS_MOD) + POS_MIN;
-	seed = rand_long(seed);
-	particle.position.z = (seed % POS_MOD) + POS_MIN;
-	seed = rand_long(seed);
-	particle.velocity.x = 0.0;
-	seed = rand_long(seed);
-	particle.velocity.y = 0.0;
-	seed = rand_long(seed);
-	particle.velocity.z = 0.0;
-	seed = rand_long(seed);
-	particle.mass = (seed % MASS_MOD) + MASS_MIN;
+		particle.position = POS_MIN + u0.xyz * POS_MOD;
+	}
+
+	if (dist == INIT_PLUMMER || dist == INIT_DISK || dist == INIT_CLUMPS) {
+		particle.position = clamp(center + offset, POS_MIN, POS_MAX);
+	}
+
+	particle.new_pos = particle.position;
+	particle.mass = MASS_MIN + u1.w * MASS_MOD;
 	particle.radius = sqrt(particle.mass / M_PI_F);
 	
-	if (is_neg == 1) particle.mass = -particle.mass;
+	if (species == 1) particle.mass = -particle.mass;
 	
-	prtcl_buffer[prtcl_index] = particle;
+	return particle;
 }
 
-__kernel void UpdateParticles(__global Particle* pos_buffer, __global Particle* neg_buffer, const RenderInfo render_info)
+__kernel void GenParticles(__global StoredParticle* prtcl_buffer, const char is_neg, const uint count, const uint dist,
+const ulong seed, const uint clumps)
 {
     uint prtcl_index = get_global_id(0);
-	Particle pos_prtcl = pos_buffer[prtcl_index];
-	Particle neg_prtcl = neg_buffer[prtcl_index];
+	StoreParticle(prtcl_buffer, prtcl_index, GenerateParticle((uint)is_neg, prtcl_index, count, dist, seed, clumps));
+}
+
+void IntegrateParticles(__global StoredParticle* pos_buffer, __global StoredParticle* neg_buffer, const RenderInfo render_info,
+const uint prtcl_index, Particle* pos_out, Particle* neg_out)
+{
+	// the species can hold different counts so either particle may be missing
+	bool has_pos = prtcl_index < render_info.pos_count;
+	bool has_neg = prtcl_index < render_info.neg_count;
+	Particle pos_prtcl = LoadParticle(pos_buffer, has_pos ? prtcl_index : 0);
+	Particle neg_prtcl = LoadParticle(neg_buffer, has_neg ? prtcl_index : 0);
 	double3 force_pos = (double3)(0.0, 0.0, 0.0);
 	double3 force_neg = (double3)(0.0, 0.0, 0.0);
 	double3 diff_pp, diff_np, diff_pn, diff_nn;
 	double force, dist_pp, dist_np, dist_pn, dist_nn;
 	Particle pos_p, neg_p;
-		
-	for (uint i=0; i < render_info.particles; ++i)
+	
+	for (uint i=0; i < render_info.pos_count; ++i)
 	{
-		if (prtcl_index == i) {
-			/*double3 diff_np = neg_prtcl.position - pos_prtcl.position;
-			double3 diff_pn = pos_prtcl.position - neg_prtcl.position;
-			double rad_sum = pos_prtcl.radius + neg_prtcl.radius;
-			double dist_np = length(diff_np);
-			dist_np = (dist_np > rad_sum) ? dist_np : rad_sum;
-			double gpn_mass = G * pos_prtcl.mass * neg_prtcl.mass;
-			double force = gpn_mass / pow(dist_np, 2.0);
-			force_pos += normalize(diff_np) * force;
-			force_neg += normalize(diff_pn) * force;*/
-		} else {
-			pos_p = pos_buffer[i];
-			neg_p = neg_buffer[i];
-			
+		pos_p = LoadParticle(pos_buffer, i);
+		
+		if (has_pos && i != prtcl_index) {
 			diff_pp = pos_p.position - pos_prtcl.position;
-			diff_np = neg_p.position - pos_prtcl.position;
-			diff_pn = pos_p.position - neg_prtcl.position;
-			diff_nn = neg_p.position - neg_prtcl.position;
-			
-			dist_pp = length(diff_pp); dist_np = length(diff_np);
-			dist_pn = length(diff_pn); dist_nn = length(diff_nn);
+			dist_pp = length(diff_pp);
 
 			if (dist_pp > (pos_p.radius + pos_prtcl.radius)) {
 				force = (G * pos_p.mass * pos_prtcl.mass) / pow(dist_pp, 2.0);
@@ -218,13 +829,11 @@ __kernel void UpdateParticles(__global Particle* pos_buffer, __global Particle*
 			//} else if (dist_pp > 0.1) {
 				//TODO: handle collisions here
 			}
+		}
 
-			if (dist_np > pos_prtcl.radius) {
-				force = (G * neg_p.mass * pos_prtcl.mass) / pow(dist_np, 2.0);
-				force_pos.x -= (diff_np.x / dist_np) * force;
-				force_pos.y -= (diff_np.y / dist_np) * force;
-				force_pos.z -= (diff_np.z / dist_np) * force;
-			}
+		if (has_neg) {
+			diff_pn = pos_p.position - neg_prtcl.position;
+			dist_pn = length(diff_pn);
 
 			if (dist_pn > neg_prtcl.radius) {
 				force = (G * pos_p.mass * neg_prtcl.mass) / pow(dist_pn, 2.0);
@@ -232,6 +841,28 @@ __kernel void UpdateParticles(__global Particle* pos_buffer, __global Particle*
 				force_neg.y -= (diff_pn.y / dist_pn) * force;
 				force_neg.z -= (diff_pn.z / dist_pn) * force;		
 			}
+		}
+	}
+	
+	for (uint i=0; i < render_info.neg_count; ++i)
+	{
+		neg_p = LoadParticle(neg_buffer, i);
+		
+		if (has_pos) {
+			diff_np = neg_p.position - pos_prtcl.position;
+			dist_np = length(diff_np);
+
+			if (dist_np > pos_prtcl.radius) {
+				force = (G * neg_p.mass * pos_prtcl.mass) / pow(dist_np, 2.0);
+				force_pos.x -= (diff_np.x / dist_np) * force;
+				force_pos.y -= (diff_np.y / dist_np) * force;
+				force_pos.z -= (diff_np.z / dist_np) * force;
+			}
+		}
+
+		if (has_neg && i != prtcl_index) {
+			diff_nn = neg_p.position - neg_prtcl.position;
+			dist_nn = length(diff_nn);
 
 			if (dist_nn > neg_prtcl.radius) {
 				force = (G * neg_p.mass * neg_prtcl.mass) / pow(dist_nn, 2.0);
@@ -299,85 +930,320 @@ __kernel void UpdateParticles(__global Particle* pos_buffer, __global Particle*
 	neg_prtcl.new_pos.y += (neg_prtcl.new_pos.y < POS_MIN) ? POS_MOD : 0.0;
 	neg_prtcl.new_pos.z += (neg_prtcl.new_pos.z < POS_MIN) ? POS_MOD : 0.0;
 		
-	pos_buffer[prtcl_index] = pos_prtcl;
-	neg_buffer[prtcl_index] = neg_prtcl;
+	if (has_pos) StoreParticle(pos_buffer, prtcl_index, pos_prtcl);
+	if (has_neg) StoreParticle(neg_buffer, prtcl_index, neg_prtcl);
+	*pos_out = pos_prtcl;
+	*neg_out = neg_prtcl;
 }
 
-__kernel void DrawParticles(__global Particle* prtcl_buffer,
-__global PFrags* frag_buffer, const RGB32 color, const RenderInfo render_info)
+__kernel void UpdateParticles(__global StoredParticle* pos_buffer, __global StoredParticle* neg_buffer, const RenderInfo render_info)
 {
-    uint prtcl_index = get_global_id(0);
-	Particle prtcl = prtcl_buffer[prtcl_index];
-	prtcl_buffer[prtcl_index].position = prtcl.new_pos;
-	
-	PFrags tmp_frags;
-	int frag_index, pix_index;
-	int2 pixel_coords, ifrag_coords;
-	float2 ffrag_coords, screen_coords;
-	
-	double3 pprc = VectRot(prtcl.new_pos - render_info.cam_pos, render_info.cam_ori);
-	double p_dist = length(pprc);
+	Particle pos_prtcl, neg_prtcl;
+	IntegrateParticles(pos_buffer, neg_buffer, render_info, get_global_id(0), &pos_prtcl, &neg_prtcl);
+}
+
+double3 PairForce(const double3 position, const float mass, const float radius, const bool is_neg,
+const double3 src_pos, const float src_mass, const float src_radius, const bool src_neg)
+{
+	// same pair rules as UpdateParticles, a source of the other species pulls with the sign flipped
+	double3 diff = src_pos - position;
+	double dist = length(diff);
+	float cut = (!is_neg && !src_neg) ? (src_radius + radius) : radius;
+	if (dist <= cut) return (double3)(0.0, 0.0, 0.0);
+	double sign = (is_neg == src_neg) ? 1.0 : -1.0;
+	return diff * (sign * G * src_mass * mass / (dist * dist * dist));
+}
+
+double3 SourceForce(const double3 position, const float mass, const float radius, const bool is_neg,
+const uint self, __local const double4* src, __local const float2* src_mr, const uint count, const bool src_neg)
+{
+	double3 force = (double3)(0.0, 0.0, 0.0);
+	bool same = (is_neg == src_neg);
 	
-	if (pprc.z > 0.0f) {
-		screen_coords.x = render_info.half_X + (pprc.x / pprc.z) * render_info.cam_set.x;
-		screen_coords.y = render_info.half_Y + (pprc.y / pprc.z) * render_info.cam_set.x;
-		float p_prad = (render_info.cam_set.x / p_dist) * prtcl.radius;
-		float p_right = screen_coords.x+p_prad;
-		float p_left = screen_coords.x-p_prad;
-		float p_top = screen_coords.y+p_prad;
-		float p_bot = screen_coords.y-p_prad;
-		
-		if (p_right > 0.0f && p_left < render_info.pixels_X
-		&& p_top > 0.0f && p_bot < render_info.pixels_Y) {
-			if (p_prad < 0.5f) {
-				pixel_coords.x = screen_coords.x;
-				pixel_coords.y = screen_coords.y;
-				if (pixel_coords.x < render_info.pixels_X
-				&& pixel_coords.y < render_info.pixels_Y) {
-					ffrag_coords.x = screen_coords.x - pixel_coords.x;
-					ffrag_coords.y = screen_coords.y - pixel_coords.y;
-					ifrag_coords.x = ffrag_coords.x * ALMOST_TWO;
-					ifrag_coords.y = ffrag_coords.y * ALMOST_TWO;
-					pix_index = (pixel_coords.y * render_info.pixels_X) + pixel_coords.x;
-					frag_index = (ifrag_coords.y * 2) + ifrag_coords.x;
-					tmp_frags = frag_buffer[pix_index];
-					if (is_black(tmp_frags.colors[frag_index]) == 1)
-						frag_buffer[pix_index].colors[frag_index] = color;
-				}
-			} else {
-				for (float y = p_bot; y < p_top; y += 0.5f) {
-					pixel_coords.y = y;
-					if (pixel_coords.y >= render_info.pixels_Y) { break; }
-					for (float x = p_left; x < p_right; x += 0.5f) {
-						pixel_coords.x = x;
-						if (pixel_coords.x >= render_info.pixels_X) { break; }
-						if (sqrt(((x-screen_coords.x)*(x-screen_coords.x)
-						+(y-screen_coords.y)*(y-screen_coords.y))) < p_prad)
-						{	
-							ffrag_coords.x = x - pixel_coords.x;
-							ffrag_coords.y = y - pixel_coords.y;
-							ifrag_coords.x = ffrag_coords.x * ALMOST_TWO;
-							ifrag_coords.y = ffrag_coords.y * ALMOST_TWO;	
-							pix_index = (pixel_coords.y * render_info.pixels_X) + pixel_coords.x;
-							frag_index = (ifrag_coords.y * 2) + ifrag_coords.x;
-							tmp_frags = frag_buffer[pix_index];
-							if (is_black(tmp_frags.colors[frag_index]) == 1)
-								frag_buffer[pix_index].colors[frag_index] = color;
-						}
-					}
-				}
-			}
-		}
+	for (uint i=0; i < count; ++i) {
+		if (same && i == self) continue;
+		force += PairForce(position, mass, radius, is_neg, src[i].xyz, src_mr[i].x, src_mr[i].y, src_neg);
 	}
+	return force;
 }
 
-__kernel void FragsToFrame(__global PFrags* frag_buffer,
-write_only image2d_t pix_buffer, const RenderInfo render_info)
+double3 WallForce(const double3 position, const float mass)
+{
+	double gm = G * INV_MASS * mass;
+	double3 to_max = IMP_MAX - position;
+	double3 to_min = position - IMP_MIN;
+	return gm / (to_max * to_max) - gm / (to_min * to_min);
+}
+
+__kernel void UpdateSubsteps(__global StoredParticle* pos_buffer, __global StoredParticle* neg_buffer, const RenderInfo render_info,
+const uint substeps, __local double4* pos_src, __local float2* pos_mr, __local double4* neg_src, __local float2* neg_mr)
+{
+	// a single work-group holds every particle in local memory and steps them without leaving the kernel
+	uint lid = get_local_id(0);
+	uint wg_size = get_local_size(0);
+	uint pos_count = render_info.pos_count;
+	uint neg_count = render_info.neg_count;
+	
+	for (uint i=lid; i < pos_count; i += wg_size) {
+		pos_src[i] = (double4)(LoadPosition(pos_buffer, i), 0.0);
+		pos_mr[i] = (float2)(LoadMass(pos_buffer, i), LoadRadius(pos_buffer, i));
+	}
+	for (uint i=lid; i < neg_count; i += wg_size) {
+		neg_src[i] = (double4)(LoadPosition(neg_buffer, i), 0.0);
+		neg_mr[i] = (float2)(LoadMass(neg_buffer, i), LoadRadius(neg_buffer, i));
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+	
+	for (uint step=0; step < substeps; ++step) {
+		// everyone reads the whole set, so new positions wait in global memory until the barrier
+		for (uint i=lid; i < pos_count; i += wg_size) {
+			double3 position = pos_src[i].xyz;
+			float2 mr = pos_mr[i];
+			double3 force = SourceForce(position, mr.x, mr.y, false, i, pos_src, pos_mr, pos_count, false)
+						  + SourceForce(position, mr.x, mr.y, false, i, neg_src, neg_mr, neg_count, true)
+						  + WallForce(position, mr.x);
+			double3 velocity = LoadVelocity(pos_buffer, i) + force / mr.x;
+			StoreVelocity(pos_buffer, i, velocity);
+			StoreNewPos(pos_buffer, i, WrapPosition(position + velocity * SPEED_MULT));
+		}
+		for (uint i=lid; i < neg_count; i += wg_size) {
+			double3 position = neg_src[i].xyz;
+			float2 mr = neg_mr[i];
+			double3 force = SourceForce(position, mr.x, mr.y, true, i, pos_src, pos_mr, pos_count, false)
+						  + SourceForce(position, mr.x, mr.y, true, i, neg_src, neg_mr, neg_count, true);
+			double3 velocity = LoadVelocity(neg_buffer, i) + force / mr.x;
+			StoreVelocity(neg_buffer, i, velocity);
+			StoreNewPos(neg_buffer, i, WrapPosition(position + velocity * SPEED_MULT));
+		}
+		barrier(CLK_LOCAL_MEM_FENCE);
+		
+		// the last step stays uncommitted so the draw or commit kernels finish it as usual
+		if (step + 1 < substeps) {
+			for (uint i=lid; i < pos_count; i += wg_size) {
+				CommitParticle(pos_buffer, i);
+				pos_src[i].xyz = LoadPosition(pos_buffer, i);
+			}
+			for (uint i=lid; i < neg_count; i += wg_size) {
+				CommitParticle(neg_buffer, i);
+				neg_src[i].xyz = LoadPosition(neg_buffer, i);
+			}
+			barrier(CLK_LOCAL_MEM_FENCE);
+		}
+	}
+}
+
+double3 LoadCurrent(__global const StoredParticle* buffer, const uint index, const uint parity)
+{
+	// streamed steps swap the roles of position and new_pos so no commit pass is needed
+	return parity ? LoadNewPos(buffer, index) : LoadPosition(buffer, index);
+}
+
+__kernel void StreamForces(__global StoredParticle* target_buffer, __global double4* force_buffer,
+__global StoredParticle* source_buffer, const uint target_count, const uint source_count,
+const uint target_neg, const uint source_neg, const long self_shift, const uint parity)
+{
+	// one source tile against the resident target block, forces add up over the tiles
+	uint prtcl_index = get_global_id(0);
+	if (prtcl_index >= target_count) return;
+	
+	double3 position = LoadCurrent(target_buffer, prtcl_index, parity);
+	float mass = LoadMass(target_buffer, prtcl_index);
+	float radius = LoadRadius(target_buffer, prtcl_index);
+	double3 force = (double3)(0.0, 0.0, 0.0);
+	
+	for (uint j=0; j < source_count; ++j) {
+		// source j is this particle when the offset between the tiles matches
+		if ((long)j - (long)prtcl_index == self_shift) continue;
+		force += PairForce(position, mass, radius, target_neg, LoadCurrent(source_buffer, j, parity),
+						   LoadMass(source_buffer, j), LoadRadius(source_buffer, j), source_neg);
+	}
+	
+	force_buffer[prtcl_index].xyz += force;
+}
+
+__kernel void StreamIntegrate(__global StoredParticle* target_buffer, __global double4* force_buffer,
+const uint target_count, const uint target_neg, const uint parity)
+{
+	uint prtcl_index = get_global_id(0);
+	if (prtcl_index >= target_count) return;
+	
+	double3 position = LoadCurrent(target_buffer, prtcl_index, parity);
+	float mass = LoadMass(target_buffer, prtcl_index);
+	double3 force = force_buffer[prtcl_index].xyz;
+	if (!target_neg) force += WallForce(position, mass);
+	
+	double3 velocity = LoadVelocity(target_buffer, prtcl_index) + force / mass;
+	double3 next_pos = WrapPosition(position + velocity * SPEED_MULT);
+	StoreVelocity(target_buffer, prtcl_index, velocity);
+	if (parity) {
+		StorePosition(target_buffer, prtcl_index, next_pos);
+	} else {
+		StoreNewPos(target_buffer, prtcl_index, next_pos);
+	}
+	
+	// cleared here so the next block starts from zero
+	force_buffer[prtcl_index] = (double4)(0.0, 0.0, 0.0, 0.0);
+}
+
+__kernel void DrawParticles(__global StoredParticle* prtcl_buffer,
+__global FragData* frag_buffer, const RGB32 color, const RenderInfo render_info)
+{
+    uint prtcl_index = get_global_id(0);
+	Particle prtcl = LoadParticle(prtcl_buffer, prtcl_index);
+	CommitParticle(prtcl_buffer, prtcl_index);
+	
+	float2 screen_coords;
+	float p_prad, p_depth;
+	
+	if (ProjectParticle(prtcl.new_pos, prtcl.radius, render_info, &screen_coords, &p_prad, &p_depth) <= CULL_DISC) {
+		PlotParticle(frag_buffer, screen_coords, p_prad, p_depth, color, render_info);
+	}
+}
+
+void CompactVisible(const uint p_class, const VisParticle vis, __global VisParticle* vis_buffer,
+__global uint* cull_stats, const uint prtcl_count, __local ulong* scan_buffer, __local uint* group_base)
+{
+	uint local_index = get_local_id(0);
+	// one 16-bit counter per class so a single scan counts every class
+	ulong p_flag = (p_class == CULL_NONE) ? 0 : (ulong)1 << (p_class * 16);
+	ulong scan_sum, scan_add;
+	
+	// inclusive Hillis-Steele scan of the packed class counters
+	scan_buffer[local_index] = p_flag;
+	barrier(CLK_LOCAL_MEM_FENCE);
+	
+	for (uint offset = 1; offset < CULL_WG_SIZE; offset <<= 1) {
+		scan_add = (local_index >= offset) ? scan_buffer[local_index - offset] : 0;
+		barrier(CLK_LOCAL_MEM_FENCE);
+		scan_buffer[local_index] += scan_add;
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+	
+	// last work-item holds the group totals, reserve space for the group
+	if (local_index == CULL_WG_SIZE-1) {
+		scan_sum = scan_buffer[local_index];
+		group_base[CULL_POINT] = atomic_add(&cull_stats[CULL_POINT], (uint)(scan_sum & 0xFFFF));
+		group_base[CULL_DISC] = atomic_add(&cull_stats[CULL_DISC], (uint)((scan_sum >> 16) & 0xFFFF));
+		atomic_add(&cull_stats[CULL_BEHIND], (uint)((scan_sum >> 32) & 0xFFFF));
+		atomic_add(&cull_stats[CULL_OFFSCREEN], (uint)((scan_sum >> 48) & 0xFFFF));
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+	
+	// points are packed from the front of the list and discs from the back
+	scan_sum = scan_buffer[local_index] - p_flag;
+	
+	if (p_class == CULL_POINT) {
+		vis_buffer[group_base[CULL_POINT] + (uint)(scan_sum & 0xFFFF)] = vis;
+	} else if (p_class == CULL_DISC) {
+		vis_buffer[prtcl_count - 1 - (group_base[CULL_DISC] + (uint)((scan_sum >> 16) & 0xFFFF))] = vis;
+	}
+}
+
+__kernel __attribute__((reqd_work_group_size(CULL_WG_SIZE, 1, 1)))
+void CullParticles(__global StoredParticle* prtcl_buffer, __global VisParticle* vis_buffer,
+__global uint* cull_stats, const uint prtcl_count, const RenderInfo render_info)
+{
+    uint prtcl_index = get_global_id(0);
+	uint p_class = CULL_NONE;
+	VisParticle vis;
+	
+	__local ulong scan_buffer[CULL_WG_SIZE];
+	__local uint group_base[2];
+	
+	if (prtcl_index < prtcl_count) {
+		Particle prtcl = LoadParticle(prtcl_buffer, prtcl_index);
+		CommitParticle(prtcl_buffer, prtcl_index);
+		p_class = ProjectParticle(prtcl.new_pos, prtcl.radius, render_info, &vis.coords, &vis.radius, &vis.depth);
+	}
+	
+	CompactVisible(p_class, vis, vis_buffer, cull_stats, prtcl_count, scan_buffer, group_base);
+}
+
+__kernel __attribute__((reqd_work_group_size(CULL_WG_SIZE, 1, 1)))
+void UpdateAndProject(__global StoredParticle* pos_buffer, __global StoredParticle* neg_buffer,
+__global VisParticle* pos_vis_buffer, __global VisParticle* neg_vis_buffer,
+__global uint* pos_stats, __global uint* neg_stats, const RenderInfo render_info)
+{
+	// integrate, then project the fresh positions while they are still in registers so
+	// drawing reads only the compact screen-space lists
+    uint prtcl_index = get_global_id(0);
+	uint pos_class = CULL_NONE;
+	uint neg_class = CULL_NONE;
+	VisParticle pos_vis, neg_vis;
+	Particle pos_prtcl, neg_prtcl;
+	
+	__local ulong scan_buffer[CULL_WG_SIZE];
+	__local uint group_base[2];
+	
+	if (prtcl_index < max(render_info.pos_count, render_info.neg_count)) {
+		IntegrateParticles(pos_buffer, neg_buffer, render_info, prtcl_index, &pos_prtcl, &neg_prtcl);
+		if (prtcl_index < render_info.pos_count) {
+			pos_class = ProjectParticle(pos_prtcl.new_pos, pos_prtcl.radius, render_info, &pos_vis.coords, &pos_vis.radius, &pos_vis.depth);
+		}
+		if (prtcl_index < render_info.neg_count) {
+			neg_class = ProjectParticle(neg_prtcl.new_pos, neg_prtcl.radius, render_info, &neg_vis.coords, &neg_vis.radius, &neg_vis.depth);
+		}
+	}
+	
+	CompactVisible(pos_class, pos_vis, pos_vis_buffer, pos_stats, render_info.pos_count, scan_buffer, group_base);
+	CompactVisible(neg_class, neg_vis, neg_vis_buffer, neg_stats, render_info.neg_count, scan_buffer, group_base);
+}
+
+__kernel void DrawVisible(__global VisParticle* vis_buffer,
+__global FragData* frag_buffer, const RGB32 color, const RenderInfo render_info)
+{
+	VisParticle vis = vis_buffer[get_global_id(0)];
+	PlotParticle(frag_buffer, vis.coords, vis.radius, vis.depth, color, render_info);
+}
+
+__kernel void CommitParticles(__global StoredParticle* prtcl_buffer)
+{
+	CommitParticle(prtcl_buffer, get_global_id(0));
+}
+
+__kernel void MoveParticles(__global StoredParticle* prtcl_buffer, __global uint2* move_pairs)
+{
+	// fill a freed slot with a live particle from the tail of the pool
+	uint2 pair = move_pairs[get_global_id(0)];
+	prtcl_buffer[pair.x] = prtcl_buffer[pair.y];
+}
+
+__kernel void MergeParticles(__global StoredParticle* prtcl_buffer, __global uint2* merge_pairs)
+{
+	// absorb the second particle into the first, conserving mass and momentum
+	uint2 pair = merge_pairs[get_global_id(0)];
+	Particle prtcl_a = LoadParticle(prtcl_buffer, pair.x);
+	Particle prtcl_b = LoadParticle(prtcl_buffer, pair.y);
+	double mass_a = prtcl_a.mass;
+	double mass_b = prtcl_b.mass;
+	double mass_sum = mass_a + mass_b;
+	
+	double3 pos_b = prtcl_a.position + PeriodicDiff(prtcl_b.position - prtcl_a.position);
+	double3 new_pos_b = prtcl_a.new_pos + PeriodicDiff(prtcl_b.new_pos - prtcl_a.new_pos);
+	
+	prtcl_a.position = WrapPosition((prtcl_a.position * mass_a + pos_b * mass_b) / mass_sum);
+	prtcl_a.new_pos = WrapPosition((prtcl_a.new_pos * mass_a + new_pos_b * mass_b) / mass_sum);
+	prtcl_a.velocity = (prtcl_a.velocity * mass_a + prtcl_b.velocity * mass_b) / mass_sum;
+	prtcl_a.mass = mass_sum;
+	prtcl_a.radius = sqrt(fabs(prtcl_a.mass) / M_PI_F);
+	
+	StoreParticle(prtcl_buffer, pair.x, prtcl_a);
+}
+
+__kernel void FragsToFrame(__global FragData* frag_buffer,
+write_only image2d_t pix_buffer, const RenderInfo render_info)
 {
     uint pix_X = get_global_id(0);
 	uint pix_Y = get_global_id(1);
 	uint pix_index = (pix_Y * render_info.pixels_X) + pix_X;
 	
+#if defined(AA_TEMPORAL)
+	float3 sumColor = (frag_buffer[pix_index].data == TAA_EMPTY) ? (float3)(0.0f,0.0f,0.0f) :
+					  UnpackColor565(frag_buffer[pix_index].data) * 255.0f;
+#elif defined(AA_COVERAGE)
+	CFrags frags = frag_buffer[pix_index];
+	float3 sumColor = UnpackColor(frags.color) * popcount(frags.mask);
+#else
 	float3 sumColor = (float3)(0.0f,0.0f,0.0f);
 	PFrags frags = frag_buffer[pix_index];
 		
@@ -386,6 +1252,794 @@ write_only image2d_t pix_buffer, const RenderInfo render_info)
 		sumColor.y += frags.colors[r].green;
 		sumColor.z += frags.colors[r].blue;
 	}
+#endif
 	
 	write_imagef(pix_buffer, (int2)(pix_X, pix_Y), VectToColor(sumColor * render_info.aa_div));
 }
+
+__kernel void SplatParticles(__global StoredParticle* prtcl_buffer,
+__global uint* dens_buffer, const uint channel, const RenderInfo render_info)
+{
+    uint prtcl_index = get_global_id(0);
+	Particle prtcl = LoadParticle(prtcl_buffer, prtcl_index);
+	CommitParticle(prtcl_buffer, prtcl_index);
+	
+	float2 screen_coords;
+	float p_prad, p_depth;
+	
+	if (ProjectParticle(prtcl.new_pos, prtcl.radius, render_info, &screen_coords, &p_prad, &p_depth) <= CULL_DISC) {
+		SplatDensity(dens_buffer, screen_coords, channel, render_info);
+	}
+}
+
+__kernel void DensityHistogram(__global uint2* dens_buffer,
+__global uint* hist_buffer, const RenderInfo render_info)
+{
+    uint pix_X = get_global_id(0);
+	uint pix_Y = get_global_id(1);
+	uint pix_index = (pix_Y * render_info.pixels_X) + pix_X;
+	uint local_index = (get_local_id(1) * get_local_size(0)) + get_local_id(0);
+	uint local_count = get_local_size(0) * get_local_size(1);
+	
+	__local uint local_hist[DENS_BINS];
+	
+	for (uint b = local_index; b < DENS_BINS; b += local_count) { local_hist[b] = 0; }
+	barrier(CLK_LOCAL_MEM_FENCE);
+	
+	// only covered pixels count towards the exposure
+	uint2 density = dens_buffer[pix_index];
+	if (density.x + density.y > 0) {
+		float log_dens = log2(1.0f + (density.x + density.y) * DENS_SCALE);
+		atomic_inc(&local_hist[min((uint)(log_dens * DENS_BIN_RES), (uint)(DENS_BINS-1))]);
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+	
+	for (uint b = local_index; b < DENS_BINS; b += local_count) {
+		if (local_hist[b] > 0) { atomic_add(&hist_buffer[b], local_hist[b]); }
+	}
+}
+
+__kernel void DensityExposure(__global uint* hist_buffer, __global float* expo_buffer)
+{
+	uint total = 0;
+	uint count = 0;
+	uint bin = 0;
+	
+	for (uint b=0; b < DENS_BINS; ++b) { total += hist_buffer[b]; }
+	if (total == 0) { return; }
+	
+	// find the bin holding the chosen percentile of covered pixels
+	uint target = total * DENS_PERCENTILE;
+	for (; bin < DENS_BINS-1; ++bin) {
+		count += hist_buffer[bin];
+		if (count >= target) { break; }
+	}
+	
+	// adapt gradually so the exposure doesn't flicker between frames
+	float log_max = max((bin + 1) / DENS_BIN_RES, 1.0f);
+	expo_buffer[0] += (log_max - expo_buffer[0]) * DENS_ADAPT;
+}
+
+__kernel void DensityToFrame(__global uint2* dens_buffer, __global float* expo_buffer,
+write_only image2d_t pix_buffer, const RGB32 pos_color, const RGB32 neg_color, const RenderInfo render_info)
+{
+    uint pix_X = get_global_id(0);
+	uint pix_Y = get_global_id(1);
+	uint pix_index = (pix_Y * render_info.pixels_X) + pix_X;
+	
+	float inv_expo = 1.0f / expo_buffer[0];
+	uint2 density = dens_buffer[pix_index];
+	float pos_lum = clamp(log2(1.0f + density.x * DENS_SCALE) * inv_expo, 0.0f, 1.0f);
+	float neg_lum = clamp(log2(1.0f + density.y * DENS_SCALE) * inv_expo, 0.0f, 1.0f);
+	float3 color = (ColorToVect(pos_color) * pos_lum) + (ColorToVect(neg_color) * neg_lum);
+	
+	write_imagef(pix_buffer, (int2)(pix_X, pix_Y), (float4)(min(color, 1.0f), 1.0f));
+}
+
+__kernel void TemporalResolve(__global FragData* frag_buffer, __global float4* hist_in,
+__global float4* hist_out, write_only image2d_t pix_buffer, const CamInfo prev_cam, const RenderInfo render_info)
+{
+#ifdef AA_TEMPORAL
+    int pix_X = get_global_id(0);
+	int pix_Y = get_global_id(1);
+	uint pix_index = (pix_Y * render_info.pixels_X) + pix_X;
+	
+	// current sample plus the color range of its neighbourhood
+	uint cur_data = frag_buffer[pix_index].data;
+	float3 cur_color = (cur_data == TAA_EMPTY) ? (float3)(0.0f,0.0f,0.0f) : UnpackColor565(cur_data);
+	double cur_depth = (cur_data == TAA_EMPTY) ? TAA_FAR : UnpackDepth(cur_data);
+	float3 min_color = cur_color;
+	float3 max_color = cur_color;
+	
+	for (int y = max(pix_Y-1, 0); y <= min(pix_Y+1, (int)render_info.span_Y); ++y) {
+		for (int x = max(pix_X-1, 0); x <= min(pix_X+1, (int)render_info.span_X); ++x) {
+			uint n_data = frag_buffer[(y * render_info.pixels_X) + x].data;
+			float3 n_color = (n_data == TAA_EMPTY) ? (float3)(0.0f,0.0f,0.0f) : UnpackColor565(n_data);
+			min_color = min(min_color, n_color);
+			max_color = max(max_color, n_color);
+		}
+	}
+	
+	// rebuild the world position of this sample and project it with last frame's camera
+	double2 pix_offset = (double2)(pix_X + 0.5 - render_info.half_X, pix_Y + 0.5 - render_info.half_Y);
+	double3 world_pos = render_info.cam_pos + (render_info.cam_fwd * cur_depth)
+					  + (render_info.cam_rgt * (pix_offset.x * cur_depth / render_info.cam_set.x))
+					  + (render_info.cam_up * (pix_offset.y * cur_depth / render_info.cam_set.x));
+	double3 rel_pos = world_pos - prev_cam.cam_pos;
+	double3 prev_view = (double3)(dot(rel_pos, prev_cam.cam_rgt), dot(rel_pos, prev_cam.cam_up), dot(rel_pos, prev_cam.cam_fwd));
+	
+	float3 result = cur_color;
+	
+	if (prev_view.z > 0.0) {
+		float2 prev_coords;
+		prev_coords.x = render_info.half_X + (prev_view.x / prev_view.z) * prev_cam.cam_set.x;
+		prev_coords.y = render_info.half_Y + (prev_view.y / prev_view.z) * prev_cam.cam_set.x;
+		float2 motion = prev_coords - (float2)(pix_X + 0.5f, pix_Y + 0.5f);
+		int2 prev_pix = convert_int2(floor(prev_coords));
+		
+		// reject samples from off-screen, large motion or disocclusion
+		if (prev_pix.x >= 0 && prev_pix.y >= 0 && prev_pix.x < render_info.pixels_X
+		&& prev_pix.y < render_info.pixels_Y && length(motion) < TAA_MAX_MOTION) {
+			float4 history = hist_in[(prev_pix.y * render_info.pixels_X) + prev_pix.x];
+			if (cur_data == TAA_EMPTY || fabs(history.w - prev_view.z) < prev_view.z * TAA_DEPTH_TOL) {
+				float3 hist_color = clamp(history.xyz, min_color, max_color);
+				result = mix(hist_color, cur_color, TAA_BLEND);
+			}
+		}
+	}
+	
+	hist_out[pix_index] = (float4)(result, (float)cur_depth);
+	write_imagef(pix_buffer, (int2)(pix_X, pix_Y), (float4)(result, 1.0f));
+#endif
+}
+
+__kernel void GridMaxRadius(__global StoredParticle* prtcl_buffer, __global GridInfo* grid_info)
+{
+	// positive floats order the same as their bits
+	atomic_max(&grid_info->max_radius, as_uint(LoadRadius(prtcl_buffer, get_global_id(0))));
+}
+
+__kernel void GridSetup(__global GridInfo* grid_info)
+{
+	// cells must be at least as wide as the biggest overlap
+	float max_radius = as_float(grid_info->max_radius);
+	uint dim = (max_radius > 0.0f) ? (uint)(POS_MOD / (2.0f * max_radius)) : GRID_MAX_DIM;
+	dim = clamp(dim, (uint)1, (uint)GRID_MAX_DIM);
+	
+	grid_info->dim = dim;
+	grid_info->cell_size = (float)POS_MOD / dim;
+	grid_info->pair_count = 0;
+}
+
+__kernel void GridKeys(__global StoredParticle* prtcl_buffer, __global uint* cell_keys, __global uint* cell_vals,
+__global GridInfo* grid_info, const uint species_bit, const uint offset)
+{
+    uint prtcl_index = get_global_id(0);
+	uint dim = grid_info->dim;
+	double3 pos = LoadNewPos(prtcl_buffer, prtcl_index) - POS_MIN;
+	uint3 cell = min(convert_uint3(max(pos / grid_info->cell_size, 0.0)), (uint3)(dim-1));
+	
+	cell_keys[offset + prtcl_index] = cell.x + dim * (cell.y + dim * cell.z);
+	cell_vals[offset + prtcl_index] = prtcl_index | species_bit;
+}
+
+__kernel void GridCells(__global uint* cell_keys, __global uint2* cell_range, const uint count)
+{
+	uint index = get_global_id(0);
+	uint key = cell_keys[index];
+	
+	// sorted keys so each cell is one contiguous run
+	if (index == 0 || key != cell_keys[index-1]) cell_range[key].x = index;
+	if (index == count-1 || key != cell_keys[index+1]) cell_range[key].y = index + 1;
+}
+
+__kernel void CollideParticles(__global StoredParticle* pos_buffer, __global StoredParticle* neg_buffer,
+__global uint* cell_keys, __global uint* cell_vals, __global uint2* cell_range, __global GridInfo* grid_info,
+__global double3* vel_deltas, __global uint* partners, const uint collide_mode)
+{
+	uint sort_index = get_global_id(0);
+	uint code = cell_vals[sort_index];
+	uint key = cell_keys[sort_index];
+	uint udim = grid_info->dim;
+	int dim = (int)udim;
+	int3 cell = convert_int3((uint3)(key % udim, (key / udim) % udim, key / (udim * udim)));
+	
+	Particle prtcl = (code & GRID_NEG_BIT) ? LoadParticle(neg_buffer, code & GRID_INDEX_MASK) : LoadParticle(pos_buffer, code);
+	double3 vel_delta = (double3)(0.0, 0.0, 0.0);
+	double3 diff, normal;
+	double dist, approach, inertia;
+	double partner_dist = POS_MOD;
+	uint partner = GRID_EMPTY;
+	uint other_code;
+	Particle other;
+	
+	// small grids wrap onto themselves so only visit distinct neighbours
+	int lo = (dim > 2) ? -1 : 0;
+	int hi = min(1, dim - 1);
+	
+	for (int dz = lo; dz <= hi; ++dz) {
+		for (int dy = lo; dy <= hi; ++dy) {
+			for (int dx = lo; dx <= hi; ++dx) {
+				int3 ncell = (cell + (int3)(dx, dy, dz) + dim) % dim;
+				uint2 range = cell_range[ncell.x + dim * (ncell.y + dim * ncell.z)];
+				
+				for (uint j = range.x; j < range.y; ++j) {
+					if (j == sort_index) continue;
+					other_code = cell_vals[j];
+					other = (other_code & GRID_NEG_BIT) ? LoadParticle(neg_buffer, other_code & GRID_INDEX_MASK) : LoadParticle(pos_buffer, other_code);
+					
+					diff = PeriodicDiff(other.new_pos - prtcl.new_pos);
+					dist = length(diff);
+					if (dist >= prtcl.radius + other.radius || dist == 0.0) continue;
+					
+					if (collide_mode == COLLIDE_MERGE) {
+						// only like particles merge, each picks its closest overlap
+						if ((other_code & GRID_NEG_BIT) == (code & GRID_NEG_BIT) && dist < partner_dist) {
+							partner_dist = dist;
+							partner = j;
+						}
+					} else {
+						// elastic bounce using the size of the masses as inertia
+						normal = diff / dist;
+						approach = dot(prtcl.velocity - other.velocity, normal);
+						if (approach > 0.0) {
+							inertia = fabs(other.mass) / (fabs(prtcl.mass) + fabs(other.mass));
+							vel_delta -= normal * (2.0 * inertia * approach);
+						}
+					}
+				}
+			}
+		}
+	}
+	
+	vel_deltas[sort_index] = vel_delta;
+	partners[sort_index] = partner;
+}
+
+__kernel void ApplyCollisions(__global StoredParticle* pos_buffer, __global StoredParticle* neg_buffer,
+__global uint* cell_vals, __global double3* vel_deltas)
+{
+	uint sort_index = get_global_id(0);
+	uint code = cell_vals[sort_index];
+	__global StoredParticle* prtcl_buffer = (code & GRID_NEG_BIT) ? neg_buffer : pos_buffer;
+	uint prtcl_index = code & GRID_INDEX_MASK;
+	double3 vel_delta = vel_deltas[sort_index];
+	
+	if (vel_delta.x != 0.0 || vel_delta.y != 0.0 || vel_delta.z != 0.0) {
+		StoreVelocity(prtcl_buffer, prtcl_index, LoadVelocity(prtcl_buffer, prtcl_index) + vel_delta);
+		StoreNewPos(prtcl_buffer, prtcl_index, WrapPosition(LoadNewPos(prtcl_buffer, prtcl_index) + vel_delta * SPEED_MULT));
+	}
+}
+
+__kernel void MergePairs(__global uint* cell_vals, __global uint* partners,
+__global uint2* merge_pairs, __global GridInfo* grid_info)
+{
+	uint sort_index = get_global_id(0);
+	uint partner = partners[sort_index];
+	
+	// mutual closest pairs never overlap so they can all merge at once
+	if (partner != GRID_EMPTY && partner > sort_index && partners[partner] == sort_index) {
+		uint pair_index = atomic_inc(&grid_info->pair_count);
+		merge_pairs[pair_index] = (uint2)(cell_vals[sort_index], cell_vals[partner]);
+	}
+}
+
+__kernel void CurveKeys(__global StoredParticle* prtcl_buffer, __global uint* curve_keys,
+__global uint* curve_vals, const uint curve)
+{
+    uint prtcl_index = get_global_id(0);
+	double3 pos = (LoadPosition(prtcl_buffer, prtcl_index) - POS_MIN) * (CURVE_CELLS / (double)POS_MOD);
+	uint3 cell = convert_uint3(clamp(pos, 0.0, (double)(CURVE_CELLS-1)));
+	
+	curve_keys[prtcl_index] = (curve == CURVE_HILBERT) ? HilbertKey(cell) : MortonKey(cell);
+	curve_vals[prtcl_index] = prtcl_index;
+}
+
+__kernel void GatherParticles(__global StoredParticle* src_buffer, __global StoredParticle* dst_buffer, __global uint* curve_vals)
+{
+	// every per-particle attribute lives in the struct so one gather moves them all
+    uint prtcl_index = get_global_id(0);
+	dst_buffer[prtcl_index] = src_buffer[curve_vals[prtcl_index]];
+}
+
+__kernel __attribute__((reqd_work_group_size(SCAN_WG, 1, 1)))
+void DiagnosticTerms(__global StoredParticle* prtcl_buffer, __global double* partials, const uint count, const uint row)
+{
+	uint stride = get_global_size(0);
+	uint groups = get_num_groups(0);
+	double terms[DIAG_TERMS];
+	double3 momentum, ang_mom;
+	double mass;
+	Particle prtcl;
+	
+	__local double reduce_buffer[SCAN_WG];
+	
+	for (uint t=0; t < DIAG_TERMS; ++t) terms[t] = 0.0;
+	
+	// mass, kinetic energy, momentum, mass weighted position and angular momentum about the box centre
+	for (uint i = get_global_id(0); i < count; i += stride) {
+		prtcl = LoadParticle(prtcl_buffer, i);
+		mass = prtcl.mass;
+		momentum = prtcl.velocity * mass;
+		ang_mom = cross(prtcl.position - DIAG_CENTER, momentum);
+		
+		terms[0] += mass;
+		terms[1] += 0.5 * mass * dot(prtcl.velocity, prtcl.velocity);
+		terms[2] += momentum.x;
+		terms[3] += momentum.y;
+		terms[4] += momentum.z;
+		terms[5] += prtcl.position.x * mass;
+		terms[6] += prtcl.position.y * mass;
+		terms[7] += prtcl.position.z * mass;
+		terms[8] += ang_mom.x;
+		terms[9] += ang_mom.y;
+		terms[10] += ang_mom.z;
+	}
+	
+	// one partial per group and term, laid out term major for a segmented reduce
+	for (uint t=0; t < DIAG_TERMS; ++t) {
+		double value = ReduceGroup(reduce_buffer, terms[t], REDUCE_SUM);
+		if (get_local_id(0) == 0) partials[(row + t) * groups + get_group_id(0)] = value;
+	}
+}
+
+__kernel __attribute__((reqd_work_group_size(SCAN_WG, 1, 1)))
+void DiagnosticPotential(__global StoredParticle* pos_buffer, __global StoredParticle* neg_buffer, __global double* partials,
+const uint pos_count, const uint neg_count, const uint row)
+{
+	uint stride = get_global_size(0);
+	double energy = 0.0;
+	double dist;
+	Particle prtcl, other;
+	
+	__local double reduce_buffer[SCAN_WG];
+	
+	// each pair is counted once, with the same cut-offs the force kernel uses
+	for (uint i = get_global_id(0); i < pos_count + neg_count; i += stride) {
+		if (i < pos_count) {
+			prtcl = LoadParticle(pos_buffer, i);
+			for (uint j=i+1; j < pos_count; ++j) {
+				other = LoadParticle(pos_buffer, j);
+				dist = length(other.position - prtcl.position);
+				if (dist > (other.radius + prtcl.radius)) energy -= (G * other.mass * prtcl.mass) / dist;
+			}
+			for (uint j=0; j < neg_count; ++j) {
+				other = LoadParticle(neg_buffer, j);
+				dist = length(other.position - prtcl.position);
+				if (dist > prtcl.radius) energy += (G * other.mass * prtcl.mass) / dist;
+			}
+		} else {
+			prtcl = LoadParticle(neg_buffer, i - pos_count);
+			for (uint j=i-pos_count+1; j < neg_count; ++j) {
+				other = LoadParticle(neg_buffer, j);
+				dist = length(other.position - prtcl.position);
+				if (dist > prtcl.radius) energy -= (G * other.mass * prtcl.mass) / dist;
+			}
+		}
+	}
+	
+	// velocities step once per frame but positions step SPEED_MULT, so scale to match kinetic energy
+	energy = ReduceGroup(reduce_buffer, energy / SPEED_MULT, REDUCE_SUM);
+	if (get_local_id(0) == 0) partials[row * get_num_groups(0) + get_group_id(0)] = energy;
+}
+
+uint FindSystem(__global const SystemInfo* systems, const uint system_count, const uint index, const bool is_neg)
+{
+	// last system starting at or before the index, an empty system shares its successor's start
+	uint lo = 0;
+	uint hi = system_count - 1;
+	while (lo < hi) {
+		uint mid = (lo + hi + 1) / 2;
+		uint first = is_neg ? systems[mid].neg_first : systems[mid].pos_first;
+		if (first <= index) lo = mid; else hi = mid - 1;
+	}
+	return lo;
+}
+
+__kernel void EnsembleGenerate(__global StoredParticle* pos_buffer, __global StoredParticle* neg_buffer,
+__global const SystemInfo* systems, const uint system_count, const uint pos_total, const uint dist, const uint clumps)
+{
+	uint gid = get_global_id(0);
+	bool is_neg = gid >= pos_total;
+	uint index = is_neg ? gid - pos_total : gid;
+	SystemInfo sys = systems[FindSystem(systems, system_count, index, is_neg)];
+	uint first = is_neg ? sys.neg_first : sys.pos_first;
+	uint count = is_neg ? sys.neg_count : sys.pos_count;
+	
+	// each system draws from its own seed, and orbital speeds go as sqrt(G)
+	Particle prtcl = GenerateParticle((uint)is_neg, index - first, count, dist, sys.seed, clumps);
+	prtcl.velocity *= sqrt(sys.g / G);
+	StoreParticle(is_neg ? neg_buffer : pos_buffer, index, prtcl);
+}
+
+__kernel void EnsembleUpdate(__global StoredParticle* pos_buffer, __global StoredParticle* neg_buffer,
+__global const SystemInfo* systems, const uint system_count, const uint pos_total, const uint parity)
+{
+	// every particle of every system in one launch, each only sees the particles of its own system
+	uint gid = get_global_id(0);
+	bool is_neg = gid >= pos_total;
+	uint index = is_neg ? gid - pos_total : gid;
+	SystemInfo sys = systems[FindSystem(systems, system_count, index, is_neg)];
+	__global StoredParticle* buffer = is_neg ? neg_buffer : pos_buffer;
+	
+	double3 position = LoadCurrent(buffer, index, parity);
+	float mass = LoadMass(buffer, index);
+	float radius = LoadRadius(buffer, index);
+	double3 force = (double3)(0.0, 0.0, 0.0);
+	
+	for (uint j = sys.pos_first; j < sys.pos_first + sys.pos_count; ++j) {
+		if (!is_neg && j == index) continue;
+		force += PairForce(position, mass, radius, is_neg, LoadCurrent(pos_buffer, j, parity),
+						   LoadMass(pos_buffer, j), LoadRadius(pos_buffer, j), false);
+	}
+	for (uint j = sys.neg_first; j < sys.neg_first + sys.neg_count; ++j) {
+		if (is_neg && j == index) continue;
+		force += PairForce(position, mass, radius, is_neg, LoadCurrent(neg_buffer, j, parity),
+						   LoadMass(neg_buffer, j), LoadRadius(neg_buffer, j), true);
+	}
+	if (!is_neg) force += WallForce(position, mass);
+	force *= sys.g / G;
+	
+	// positions swap fields each step like the streamed mode, so there is no commit launch
+	double3 velocity = LoadVelocity(buffer, index) + force / mass;
+	double3 next_pos = WrapPosition(position + velocity * SPEED_MULT);
+	StoreVelocity(buffer, index, velocity);
+	if (parity) {
+		StorePosition(buffer, index, next_pos);
+	} else {
+		StoreNewPos(buffer, index, next_pos);
+	}
+}
+
+__kernel __attribute__((reqd_work_group_size(SCAN_WG, 1, 1)))
+void EnsembleDiagnostics(__global StoredParticle* pos_buffer, __global StoredParticle* neg_buffer,
+__global const SystemInfo* systems, __global double* results, const uint parity)
+{
+	// one group per system: both masses, kinetic and potential energy, then momentum
+	SystemInfo sys = systems[get_group_id(0)];
+	uint total = sys.pos_count + sys.neg_count;
+	double terms[ENS_TERMS];
+	
+	__local double reduce_buffer[SCAN_WG];
+	
+	for (uint t=0; t < ENS_TERMS; ++t) terms[t] = 0.0;
+	
+	for (uint i = get_local_id(0); i < total; i += SCAN_WG) {
+		bool is_neg = i >= sys.pos_count;
+		__global StoredParticle* buffer = is_neg ? neg_buffer : pos_buffer;
+		uint index = is_neg ? sys.neg_first + (i - sys.pos_count) : sys.pos_first + i;
+		double3 position = LoadCurrent(buffer, index, parity);
+		double3 velocity = LoadVelocity(buffer, index);
+		double mass = LoadMass(buffer, index);
+		float radius = LoadRadius(buffer, index);
+		
+		terms[is_neg ? 1 : 0] += mass;
+		terms[2] += 0.5 * mass * dot(velocity, velocity);
+		terms[4] += velocity.x * mass;
+		terms[5] += velocity.y * mass;
+		terms[6] += velocity.z * mass;
+		
+		// each pair once, positives come first so a mixed pair always cuts at the positive radius
+		for (uint k=i+1; k < total; ++k) {
+			bool other_neg = k >= sys.pos_count;
+			__global StoredParticle* other_buffer = other_neg ? neg_buffer : pos_buffer;
+			uint other = other_neg ? sys.neg_first + (k - sys.pos_count) : sys.pos_first + k;
+			double dist = length(LoadCurrent(other_buffer, other, parity) - position);
+			float cut = (!is_neg && !other_neg) ? (LoadRadius(other_buffer, other) + radius) : radius;
+			if (dist > cut) {
+				double energy = (sys.g * LoadMass(other_buffer, other) * mass) / dist;
+				terms[3] += (is_neg == other_neg) ? -energy : energy;
+			}
+		}
+	}
+	terms[3] /= SPEED_MULT;
+	
+	for (uint t=0; t < ENS_TERMS; ++t) {
+		double value = ReduceGroup(reduce_buffer, terms[t], REDUCE_SUM);
+		if (get_local_id(0) == 0) results[get_group_id(0) * ENS_TERMS + t] = value;
+	}
+}
+
+uint AnalysisBin(const double value, const double range)
+{
+	// the top bin also takes the maximum itself
+	return (range > 0.0) ? min((uint)(value / range * ANA_BINS), (uint)(ANA_BINS-1)) : 0;
+}
+
+__kernel __attribute__((reqd_work_group_size(SCAN_WG, 1, 1)))
+void AnalysisTerms(__global StoredParticle* prtcl_buffer, __global double* partials, const uint count,
+const uint sum_row, const uint max_row)
+{
+	// each axis is mapped onto a circle so the |m| weighted centre of a clump survives the wrap
+	uint stride = get_global_size(0);
+	uint groups = get_num_groups(0);
+	double sums[ANA_SUMS];
+	double maxes[ANA_MAXES];
+	
+	__local double reduce_buffer[SCAN_WG];
+	
+	for (uint t=0; t < ANA_SUMS; ++t) sums[t] = 0.0;
+	for (uint t=0; t < ANA_MAXES; ++t) maxes[t] = 0.0;
+	
+	for (uint i = get_global_id(0); i < count; i += stride) {
+		double mass = fabs(LoadMass(prtcl_buffer, i));
+		double3 angle = (LoadPosition(prtcl_buffer, i) - POS_MIN) * (2.0 * M_PI / POS_MOD);
+		double3 c, s;
+		s = sincos(angle, &c);
+		sums[0] += c.x * mass;
+		sums[1] += s.x * mass;
+		sums[2] += c.y * mass;
+		sums[3] += s.y * mass;
+		sums[4] += c.z * mass;
+		sums[5] += s.z * mass;
+		sums[6] += mass;
+		maxes[0] = max(maxes[0], length(LoadVelocity(prtcl_buffer, i)));
+		maxes[1] = max(maxes[1], mass);
+	}
+	
+	// one partial per group and term, term major for the segmented reduces
+	for (uint t=0; t < ANA_SUMS; ++t) {
+		double value = ReduceGroup(reduce_buffer, sums[t], REDUCE_SUM);
+		if (get_local_id(0) == 0) partials[(sum_row + t) * groups + get_group_id(0)] = value;
+	}
+	for (uint t=0; t < ANA_MAXES; ++t) {
+		double value = ReduceGroup(reduce_buffer, maxes[t], REDUCE_MAX);
+		if (get_local_id(0) == 0) partials[(max_row + t) * groups + get_group_id(0)] = value;
+	}
+}
+
+__kernel void AnalysisStats(__global const double* sums, __global const double* maxes, __global double* values)
+{
+	// one work-item per species turns the reduced terms into the centre and ranges the histograms bin over
+	uint species = get_global_id(0);
+	__global const double* sum = sums + species * ANA_SUMS;
+	__global double* out = values + species * ANA_VALUES;
+	
+	for (uint a=0; a < 3; ++a) {
+		double c = sum[2*a];
+		double s = sum[2*a + 1];
+		// a spread with no preferred phase has no centre, fall back to the middle of the box
+		double phase = (sqrt(c*c + s*s) > 1e-9 * sum[6]) ? atan2(s, c) : M_PI;
+		if (phase < 0.0) phase += 2.0 * M_PI;
+		out[a] = POS_MIN + phase * (POS_MOD / (2.0 * M_PI));
+	}
+	out[3] = sum[6];
+	out[4] = maxes[species * ANA_MAXES];
+	out[5] = maxes[species * ANA_MAXES + 1];
+}
+
+__kernel __attribute__((reqd_work_group_size(SCAN_WG, 1, 1)))
+void AnalysisHistograms(__global StoredParticle* prtcl_buffer, __global const double* values, __global uint* hist,
+__global uint* mesh, const uint count, const uint species)
+{
+	// radial profile about the species centre, speed and mass histograms, and the NGP mesh counts
+	uint local_index = get_local_id(0);
+	uint prtcl_index = get_global_id(0);
+	__global const double* stats = values + species * ANA_VALUES;
+	
+	__local uint local_hist[3 * ANA_BINS];
+	
+	for (uint b = local_index; b < 3 * ANA_BINS; b += SCAN_WG) { local_hist[b] = 0; }
+	barrier(CLK_LOCAL_MEM_FENCE);
+	
+	if (prtcl_index < count) {
+		double3 position = LoadPosition(prtcl_buffer, prtcl_index);
+		double radius = length(PeriodicDiff(position - (double3)(stats[0], stats[1], stats[2])));
+		if (radius < ANA_RADIUS_MAX) atomic_inc(&local_hist[AnalysisBin(radius, ANA_RADIUS_MAX)]);
+		atomic_inc(&local_hist[ANA_BINS + AnalysisBin(length(LoadVelocity(prtcl_buffer, prtcl_index)), stats[4])]);
+		atomic_inc(&local_hist[2 * ANA_BINS + AnalysisBin(fabs(LoadMass(prtcl_buffer, prtcl_index)), stats[5])]);
+		
+		uint3 cell = min(convert_uint3(max((position - POS_MIN) * (ANA_MESH / (double)POS_MOD), 0.0)), (uint3)(ANA_MESH-1));
+		atomic_inc(&mesh[cell.x + ANA_MESH * (cell.y + ANA_MESH * cell.z)]);
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+	
+	for (uint b = local_index; b < 3 * ANA_BINS; b += SCAN_WG) {
+		if (local_hist[b] > 0) { atomic_add(&hist[species * 3 * ANA_BINS + b], local_hist[b]); }
+	}
+}
+
+__kernel __attribute__((reqd_work_group_size(SCAN_WG, 1, 1)))
+void AnalysisPairs(__global StoredParticle* pos_buffer, __global StoredParticle* neg_buffer, __global uint* hist,
+const uint pos_count, const uint neg_count)
+{
+	// every positive against every negative across the wrap, so this costs about as much as a force step
+	uint local_index = get_local_id(0);
+	uint prtcl_index = get_global_id(0);
+	
+	__local uint local_hist[ANA_BINS];
+	
+	for (uint b = local_index; b < ANA_BINS; b += SCAN_WG) { local_hist[b] = 0; }
+	barrier(CLK_LOCAL_MEM_FENCE);
+	
+	if (prtcl_index < pos_count) {
+		double3 position = LoadPosition(pos_buffer, prtcl_index);
+		for (uint j=0; j < neg_count; ++j) {
+			double dist = length(PeriodicDiff(LoadPosition(neg_buffer, j) - position));
+			atomic_inc(&local_hist[AnalysisBin(dist, ANA_SEP_MAX)]);
+		}
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+	
+	for (uint b = local_index; b < ANA_BINS; b += SCAN_WG) {
+		if (local_hist[b] > 0) { atomic_add(&hist[6 * ANA_BINS + b], local_hist[b]); }
+	}
+}
+
+__kernel void MeshDelta(__global const uint* mesh, __global double2* modes, const uint count)
+{
+	// density contrast of the particle counts
+	uint cell = get_global_id(0);
+	double mean = count / (double)ANA_CELLS;
+	modes[cell] = (double2)((mean > 0.0) ? mesh[cell] / mean - 1.0 : 0.0, 0.0);
+}
+
+__kernel void MeshDFT(__global const double2* src, __global double2* dst, const uint axis)
+{
+	// one axis of the 3D transform, the mesh is small enough that a direct sum beats an FFT's bookkeeping
+	uint cell = get_global_id(0);
+	uint stride = (axis == 0) ? 1 : (axis == 1) ? ANA_MESH : ANA_MESH * ANA_MESH;
+	uint k = (cell / stride) % ANA_MESH;
+	uint base = cell - k * stride;
+	double2 sum = (double2)(0.0, 0.0);
+	double c, s;
+	
+	for (uint n=0; n < ANA_MESH; ++n) {
+		s = sincos(-2.0 * M_PI * (double)((k * n) % ANA_MESH) / ANA_MESH, &c);
+		double2 v = src[base + n * stride];
+		sum += (double2)(v.x * c - v.y * s, v.x * s + v.y * c);
+	}
+	dst[cell] = sum;
+}
+
+__kernel void MeshPower(__global const double2* modes, __global double* values, const uint species)
+{
+	// one work-item per shell, shell b averages the modes with |k| nearest b+1 fundamentals
+	uint shell = get_global_id(0);
+	double power = 0.0;
+	uint mode_count = 0;
+	
+	for (uint cell=0; cell < ANA_CELLS; ++cell) {
+		int3 k = (int3)(cell % ANA_MESH, (cell / ANA_MESH) % ANA_MESH, cell / (ANA_MESH * ANA_MESH));
+		k = select(k, k - ANA_MESH, k > ANA_MESH/2);
+		if ((uint)(length(convert_double3(k)) + 0.5) == shell + 1) {
+			power += dot(modes[cell], modes[cell]);
+			mode_count++;
+		}
+	}
+	
+	// P(k) = V |delta_k|^2 / N_cells^2 for the unnormalised transform
+	double volume = (double)POS_MOD * POS_MOD * POS_MOD;
+	__global double* out = values + species * ANA_VALUES + ANA_STATS;
+	out[shell] = (mode_count > 0) ? power / mode_count * volume / ((double)ANA_CELLS * ANA_CELLS) : 0.0;
+	out[ANA_K_BINS + shell] = mode_count;
+}
+
+uint FofFind(volatile __global uint* labels, uint x)
+{
+	// labels only ever point at smaller indices so the walk always ends at a root
+	uint parent = labels[x];
+	while (parent != x) {
+		x = parent;
+		parent = labels[x];
+	}
+	return x;
+}
+
+void FofUnion(volatile __global uint* labels, uint a, uint b)
+{
+	a = FofFind(labels, a);
+	b = FofFind(labels, b);
+	
+	// hook the larger root under the smaller, if another item got there first follow it and retry
+	while (a != b) {
+		uint hi = max(a, b);
+		uint lo = min(a, b);
+		uint old = atomic_min(&labels[hi], lo);
+		if (old == hi) return;
+		a = FofFind(labels, old);
+		b = FofFind(labels, lo);
+	}
+}
+
+__kernel void FofInit(__global uint* labels)
+{
+	uint sort_index = get_global_id(0);
+	labels[sort_index] = sort_index;
+}
+
+__kernel void FofLink(__global StoredParticle* prtcl_buffer, __global uint* cell_keys, __global uint* cell_vals,
+__global uint2* cell_range, __global GridInfo* grid_info, volatile __global uint* labels, const double link_length)
+{
+	uint sort_index = get_global_id(0);
+	uint key = cell_keys[sort_index];
+	uint udim = grid_info->dim;
+	int dim = (int)udim;
+	int3 cell = convert_int3((uint3)(key % udim, (key / udim) % udim, key / (udim * udim)));
+	double3 position = LoadNewPos(prtcl_buffer, cell_vals[sort_index]);
+	
+	// small grids wrap onto themselves so only visit distinct neighbours
+	int lo = (dim > 2) ? -1 : 0;
+	int hi = min(1, dim - 1);
+	
+	for (int dz = lo; dz <= hi; ++dz) {
+		for (int dy = lo; dy <= hi; ++dy) {
+			for (int dx = lo; dx <= hi; ++dx) {
+				int3 ncell = (cell + (int3)(dx, dy, dz) + dim) % dim;
+				uint2 range = cell_range[ncell.x + dim * (ncell.y + dim * ncell.z)];
+				
+				// each pair is linked once, from its lower sorted index
+				for (uint j = max(range.x, sort_index + 1); j < range.y; ++j) {
+					double dist = length(PeriodicDiff(LoadNewPos(prtcl_buffer, cell_vals[j]) - position));
+					if (dist < link_length) FofUnion(labels, sort_index, j);
+				}
+			}
+		}
+	}
+}
+
+__kernel void FofJump(volatile __global uint* labels)
+{
+	// point every item straight at its root so the labels can be sorted into groups
+	uint sort_index = get_global_id(0);
+	labels[sort_index] = FofFind(labels, sort_index);
+}
+
+__kernel void FofGroups(__global uint2* label_range, __global uint2* groups, __global GridInfo* grid_info, const uint min_members)
+{
+	// only roots have a range, the group count reuses the pair counter
+	uint2 range = label_range[get_global_id(0)];
+	if (range.y - range.x >= min_members) {
+		groups[atomic_inc(&grid_info->pair_count)] = range;
+	}
+}
+
+__kernel __attribute__((reqd_work_group_size(SCAN_WG, 1, 1)))
+void FofCatalogue(__global StoredParticle* prtcl_buffer, __global uint* members, __global uint2* groups, __global double* catalogue)
+{
+	// one group per catalogue entry, members are measured relative to the first so clumps can straddle the wrap
+	uint2 range = groups[get_group_id(0)];
+	double3 anchor = LoadNewPos(prtcl_buffer, members[range.x]);
+	double terms[FOF_TERMS];
+	
+	__local double reduce_buffer[SCAN_WG];
+	
+	for (uint t=0; t < FOF_TERMS; ++t) terms[t] = 0.0;
+	
+	for (uint i = range.x + get_local_id(0); i < range.y; i += SCAN_WG) {
+		uint prtcl_index = members[i];
+		double mass = LoadMass(prtcl_buffer, prtcl_index);
+		double weight = fabs(mass);
+		double3 offset = PeriodicDiff(LoadNewPos(prtcl_buffer, prtcl_index) - anchor);
+		double3 velocity = LoadVelocity(prtcl_buffer, prtcl_index);
+		terms[0] += mass;
+		terms[1] += weight;
+		terms[2] += offset.x * weight;
+		terms[3] += offset.y * weight;
+		terms[4] += offset.z * weight;
+		terms[5] += velocity.x * weight;
+		terms[6] += velocity.y * weight;
+		terms[7] += velocity.z * weight;
+		terms[8] += dot(velocity, velocity) * weight;
+	}
+	
+	for (uint t=0; t < FOF_TERMS; ++t) {
+		terms[t] = ReduceGroup(reduce_buffer, terms[t], REDUCE_SUM);
+	}
+	
+	if (get_local_id(0) == 0) {
+		__global double* out = catalogue + get_group_id(0) * FOF_TERMS;
+		double weight = (terms[1] > 0.0) ? terms[1] : 1.0;
+		double3 centre = WrapPosition(anchor + (double3)(terms[2], terms[3], terms[4]) / weight);
+		double3 velocity = (double3)(terms[5], terms[6], terms[7]) / weight;
+		out[0] = range.y - range.x;
+		out[1] = terms[0];
+		out[2] = centre.x;
+		out[3] = centre.y;
+		out[4] = centre.z;
+		out[5] = velocity.x;
+		out[6] = velocity.y;
+		out[7] = velocity.z;
+		out[8] = sqrt(max(terms[8] / weight - dot(velocity, velocity), 0.0));
+	}
+}
@@ -0,0 +1,223 @@
+// ------------------------------ //
+// ---- PARALLEL PRIMITIVES ----- //
+// ------------------------------ //
+
+#define SCAN_WG 256
+#define SCAN_BLOCK 512
+#define RADIX_BINS 16
+#define RADIX_ITEMS 16
+#define REDUCE_SUM 0
+#define REDUCE_MIN 1
+#define REDUCE_MAX 2
+
+double ReduceIdentity(const uint op)
+{
+	if (op == REDUCE_MIN) return INFINITY;
+	if (op == REDUCE_MAX) return -INFINITY;
+	return 0.0;
+}
+
+double ReduceOp(const double a, const double b, const uint op)
+{
+	if (op == REDUCE_MIN) return fmin(a, b);
+	if (op == REDUCE_MAX) return fmax(a, b);
+	return a + b;
+}
+
+double ReduceGroup(__local double* reduce_buffer, double value, const uint op)
+{
+	uint local_index = get_local_id(0);
+	reduce_buffer[local_index] = value;
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	for (uint stride = SCAN_WG/2; stride > 0; stride >>= 1) {
+		if (local_index < stride) {
+			reduce_buffer[local_index] = ReduceOp(reduce_buffer[local_index], reduce_buffer[local_index + stride], op);
+		}
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+
+	// wait for every read of the result so the buffer can be reused straight away
+	value = reduce_buffer[0];
+	barrier(CLK_LOCAL_MEM_FENCE);
+	return value;
+}
+
+__kernel __attribute__((reqd_work_group_size(SCAN_WG, 1, 1)))
+void ScanBlocks(__global uint* data, __global uint* block_sums, const uint count)
+{
+	uint local_index = get_local_id(0);
+	uint base = get_group_id(0) * SCAN_BLOCK;
+	uint a_index = local_index;
+	uint b_index = local_index + SCAN_WG;
+	uint offset = 1;
+	uint a, b, temp;
+
+	__local uint scan_buffer[SCAN_BLOCK];
+
+	// each item loads two values so the tree covers twice the group size
+	scan_buffer[a_index] = (base + a_index < count) ? data[base + a_index] : 0;
+	scan_buffer[b_index] = (base + b_index < count) ? data[base + b_index] : 0;
+
+	// Blelloch up-sweep leaves the block total in the last slot
+	for (uint d = SCAN_BLOCK >> 1; d > 0; d >>= 1) {
+		barrier(CLK_LOCAL_MEM_FENCE);
+		if (local_index < d) {
+			a = offset * (2 * local_index + 1) - 1;
+			b = offset * (2 * local_index + 2) - 1;
+			scan_buffer[b] += scan_buffer[a];
+		}
+		offset <<= 1;
+	}
+
+	if (local_index == 0) {
+		block_sums[get_group_id(0)] = scan_buffer[SCAN_BLOCK-1];
+		scan_buffer[SCAN_BLOCK-1] = 0;
+	}
+
+	// down-sweep turns the partial sums into an exclusive scan
+	for (uint d = 1; d < SCAN_BLOCK; d <<= 1) {
+		offset >>= 1;
+		barrier(CLK_LOCAL_MEM_FENCE);
+		if (local_index < d) {
+			a = offset * (2 * local_index + 1) - 1;
+			b = offset * (2 * local_index + 2) - 1;
+			temp = scan_buffer[a];
+			scan_buffer[a] = scan_buffer[b];
+			scan_buffer[b] += temp;
+		}
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	if (base + a_index < count) data[base + a_index] = scan_buffer[a_index];
+	if (base + b_index < count) data[base + b_index] = scan_buffer[b_index];
+}
+
+__kernel __attribute__((reqd_work_group_size(SCAN_WG, 1, 1)))
+void AddBlockSums(__global uint* data, __global uint* block_sums, const uint count)
+{
+	uint base = get_group_id(0) * SCAN_BLOCK + get_local_id(0);
+	uint block_sum = block_sums[get_group_id(0)];
+
+	if (base < count) data[base] += block_sum;
+	if (base + SCAN_WG < count) data[base + SCAN_WG] += block_sum;
+}
+
+__kernel void CompactValues(__global uint* values, __global uint* flags, __global uint* positions,
+__global uint* output, __global uint* out_count, const uint count)
+{
+	uint index = get_global_id(0);
+	uint flag = flags[index];
+	uint position = positions[index];
+
+	// the exclusive scan of the flags is each kept value's output slot
+	if (flag) output[position] = values[index];
+	if (index == count-1) out_count[0] = position + flag;
+}
+
+__kernel __attribute__((reqd_work_group_size(SCAN_WG, 1, 1)))
+void ReduceBlocks(__global double* values, __global double* partials, const uint count, const uint op)
+{
+	uint stride = get_global_size(0);
+	double value = ReduceIdentity(op);
+
+	__local double reduce_buffer[SCAN_WG];
+
+	// grid stride accumulation keeps the number of partials fixed
+	for (uint i = get_global_id(0); i < count; i += stride) {
+		value = ReduceOp(value, values[i], op);
+	}
+
+	value = ReduceGroup(reduce_buffer, value, op);
+	if (get_local_id(0) == 0) partials[get_group_id(0)] = value;
+}
+
+__kernel __attribute__((reqd_work_group_size(SCAN_WG, 1, 1)))
+void SegmentedReduce(__global double* values, __global uint* seg_offsets, __global double* results, const uint op)
+{
+	uint segment = get_group_id(0);
+	uint last = seg_offsets[segment + 1];
+	double value = ReduceIdentity(op);
+
+	__local double reduce_buffer[SCAN_WG];
+
+	// one group per segment, empty segments reduce to the identity
+	for (uint i = seg_offsets[segment] + get_local_id(0); i < last; i += SCAN_WG) {
+		value = ReduceOp(value, values[i], op);
+	}
+
+	value = ReduceGroup(reduce_buffer, value, op);
+	if (get_local_id(0) == 0) results[segment] = value;
+}
+
+__kernel void RadixCount(__global uint* keys, __global uint* hist, const uint count, const uint shift)
+{
+	uint thread = get_global_id(0);
+	uint threads = get_global_size(0);
+	uint first = thread * RADIX_ITEMS;
+	uint last = min(first + RADIX_ITEMS, count);
+	uint counts[RADIX_BINS];
+
+	for (uint d=0; d < RADIX_BINS; ++d) counts[d] = 0;
+	for (uint i=first; i < last; ++i) counts[(keys[i] >> shift) & (RADIX_BINS-1)]++;
+
+	// digit major so one scan gives every thread its output offsets
+	for (uint d=0; d < RADIX_BINS; ++d) hist[(d * threads) + thread] = counts[d];
+}
+
+__kernel void RadixScatter(__global uint* keys_in, __global uint* vals_in, __global uint* keys_out,
+__global uint* vals_out, __global uint* hist, const uint count, const uint shift)
+{
+	uint thread = get_global_id(0);
+	uint threads = get_global_size(0);
+	uint first = thread * RADIX_ITEMS;
+	uint last = min(first + RADIX_ITEMS, count);
+	uint offsets[RADIX_BINS];
+	uint key, out_index;
+
+	for (uint d=0; d < RADIX_BINS; ++d) offsets[d] = hist[(d * threads) + thread];
+
+	// walking the block in order keeps the sort stable
+	for (uint i=first; i < last; ++i) {
+		key = keys_in[i];
+		out_index = offsets[(key >> shift) & (RADIX_BINS-1)]++;
+		keys_out[out_index] = key;
+		vals_out[out_index] = vals_in[i];
+	}
+}
+
+__kernel void RadixCount64(__global ulong* keys, __global uint* hist, const uint count, const uint shift)
+{
+	uint thread = get_global_id(0);
+	uint threads = get_global_size(0);
+	uint first = thread * RADIX_ITEMS;
+	uint last = min(first + RADIX_ITEMS, count);
+	uint counts[RADIX_BINS];
+
+	for (uint d=0; d < RADIX_BINS; ++d) counts[d] = 0;
+	for (uint i=first; i < last; ++i) counts[(uint)(keys[i] >> shift) & (RADIX_BINS-1)]++;
+
+	for (uint d=0; d < RADIX_BINS; ++d) hist[(d * threads) + thread] = counts[d];
+}
+
+__kernel void RadixScatter64(__global ulong* keys_in, __global uint* vals_in, __global ulong* keys_out,
+__global uint* vals_out, __global uint* hist, const uint count, const uint shift)
+{
+	uint thread = get_global_id(0);
+	uint threads = get_global_size(0);
+	uint first = thread * RADIX_ITEMS;
+	uint last = min(first + RADIX_ITEMS, count);
+	uint offsets[RADIX_BINS];
+	uint out_index;
+	ulong key;
+
+	for (uint d=0; d < RADIX_BINS; ++d) offsets[d] = hist[(d * threads) + thread];
+
+	for (uint i=first; i < last; ++i) {
+		key = keys_in[i];
+		out_index = offsets[(uint)(key >> shift) & (RADIX_BINS-1)]++;
+		keys_out[out_index] = key;
+		vals_out[out_index] = vals_in[i];
+	}
+}
+
@@ -0,0 +1,13 @@
+#version 330 core
+
+in vec2 corner;
+
+uniform vec3 prtcl_color;
+
+out vec4 frag_color;
+
+void main()
+{
+	if (dot(corner, corner) > 1.0) discard;
+	frag_color = vec4(prtcl_color, 1.0);
+}
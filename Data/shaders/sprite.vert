@@ -0,0 +1,35 @@
+#version 330 core
+
+layout(location = 0) in vec3 prtcl_pos;
+layout(location = 1) in float prtcl_rad;
+
+uniform vec3 cam_pos;
+uniform vec3 cam_rgt;
+uniform vec3 cam_up;
+uniform vec3 cam_fwd;
+uniform float cam_foc;
+uniform vec2 half_res;
+uniform vec2 depth_rng;
+
+out vec2 corner;
+
+void main()
+{
+	// corners of a triangle strip quad from the vertex id
+	corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1)) * 2.0 - 1.0;
+
+	vec3 rel_pos = prtcl_pos - cam_pos;
+	vec3 view_pos = vec3(dot(rel_pos, cam_rgt), dot(rel_pos, cam_up), dot(rel_pos, cam_fwd));
+
+	// never let a sprite shrink below half a pixel so distant particles stay visible
+	float radius = max(prtcl_rad, (0.5 * view_pos.z) / cam_foc);
+	view_pos.xy += corner * radius;
+
+	float near = depth_rng.x;
+	float far = depth_rng.y;
+
+	gl_Position = vec4((view_pos.x * cam_foc) / half_res.x,
+					   (view_pos.y * cam_foc) / half_res.y,
+					   ((view_pos.z * (far + near)) - (2.0 * far * near)) / (far - near),
+					   view_pos.z);
+}
@@ -0,0 +1,125 @@
+#include "Diagnostics.h"
+#include <vector>
+#include <cmath>
+
+void Diagnostics::Initialize(CL* pOpenCL, uint32_t sampleSteps, bool withPotential)
+{
+	openCL = pOpenCL;
+	interval = sampleSteps;
+	potential = withPotential;
+	energyDrift = 0.0;
+	pending = false;
+	step = 0;
+	sampleStep = 0;
+	startEnergy = 0.0;
+	haveStart = false;
+
+	// each row of partials is one term of one species, reduced down to a single scalar
+	std::vector<cl_uint> rowOffsets(DIAG_ROWS+1);
+	for (uint32_t r=0; r <= DIAG_ROWS; ++r) rowOffsets[r] = r * DIAG_GROUPS;
+
+	partials = cl::Buffer(openCL->context, CL_MEM_READ_WRITE, sizeof(cl_double)*DIAG_ROWS*DIAG_GROUPS);
+	results = cl::Buffer(openCL->context, CL_MEM_READ_WRITE, sizeof(cl_double)*DIAG_ROWS);
+	offsets = cl::Buffer(openCL->context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(cl_uint)*rowOffsets.size(), rowOffsets.data());
+
+	logFile.open(GLOBALS::DATA_FOLDER+DIAG_LOG);
+	if (!logFile.is_open()) {
+		HandleFatalError(7, "Unable to open diagnostics log: "+GLOBALS::DATA_FOLDER+DIAG_LOG);
+	}
+
+	logFile.precision(12);
+	logFile << "step";
+	for (int s=0; s < 2; ++s) {
+		std::string sp = (s == 0) ? "pos_" : "neg_";
+		logFile << ',' << sp << "mass," << sp << "kinetic,"
+				<< sp << "px," << sp << "py," << sp << "pz,"
+				<< sp << "com_x," << sp << "com_y," << sp << "com_z,"
+				<< sp << "lx," << sp << "ly," << sp << "lz";
+	}
+	logFile << ",kinetic,potential,energy,momentum,ang_momentum,energy_drift\n";
+}
+
+void Diagnostics::Sample(ParticlePool& posPool, ParticlePool& negPool)
+{
+	Poll();
+	if (++step % interval != 0) return;
+
+	// only one sample in flight, a slow readback just skips the next one
+	if (pending) return;
+
+	openCL->DiagT_Kernel.setArg(0, posPool.buffer);
+	openCL->DiagT_Kernel.setArg(1, partials);
+	openCL->DiagT_Kernel.setArg(2, posPool.count);
+	openCL->DiagT_Kernel.setArg(3, (cl_uint)0);
+	openCL->DiagnosticTerms();
+
+	openCL->DiagT_Kernel.setArg(0, negPool.buffer);
+	openCL->DiagT_Kernel.setArg(2, negPool.count);
+	openCL->DiagT_Kernel.setArg(3, (cl_uint)DIAG_TERMS);
+	openCL->DiagnosticTerms();
+
+	if (potential) {
+		// all pairs, so this costs about as much as a force step
+		openCL->DiagP_Kernel.setArg(0, posPool.buffer);
+		openCL->DiagP_Kernel.setArg(1, negPool.buffer);
+		openCL->DiagP_Kernel.setArg(2, partials);
+		openCL->DiagP_Kernel.setArg(3, posPool.count);
+		openCL->DiagP_Kernel.setArg(4, negPool.count);
+		openCL->DiagP_Kernel.setArg(5, (cl_uint)(DIAG_ROWS-1));
+		openCL->DiagnosticPotential();
+	}
+
+	openCL->SegmentedReduce(partials, offsets, potential ? DIAG_ROWS : DIAG_ROWS-1, REDUCE_SUM, results);
+
+	// a handful of scalars come back without stalling the queue
+	openCL->queue.enqueueReadBuffer(results, CL_FALSE, 0, sizeof(hostResults), hostResults, NULL, &readEvent);
+	openCL->queue.flush();
+	sampleStep = step;
+	pending = true;
+}
+
+void Diagnostics::Poll()
+{
+	if (!pending || readEvent.getInfo<CL_EVENT_COMMAND_EXECUTION_STATUS>() != CL_COMPLETE) return;
+	pending = false;
+	if (!potential) hostResults[DIAG_ROWS-1] = 0.0;
+	WriteSample();
+}
+
+void Diagnostics::WriteSample()
+{
+	double kinetic = 0.0;
+	double momentum[3] = {0.0, 0.0, 0.0};
+	double angMomentum[3] = {0.0, 0.0, 0.0};
+
+	logFile << sampleStep;
+	for (int s=0; s < 2; ++s) {
+		const cl_double* terms = hostResults + s*DIAG_TERMS;
+		double mass = terms[0];
+		logFile << ',' << mass << ',' << terms[1];
+		logFile << ',' << terms[2] << ',' << terms[3] << ',' << terms[4];
+		for (int a=0; a < 3; ++a) {
+			logFile << ',' << ((mass != 0.0) ? terms[5+a] / mass : 0.0);
+		}
+		logFile << ',' << terms[8] << ',' << terms[9] << ',' << terms[10];
+
+		kinetic += terms[1];
+		for (int a=0; a < 3; ++a) {
+			momentum[a] += terms[2+a];
+			angMomentum[a] += terms[8+a];
+		}
+	}
+
+	// drift is measured against the first sample
+	double energy = kinetic + hostResults[DIAG_ROWS-1];
+	if (!haveStart) {
+		startEnergy = energy;
+		haveStart = true;
+	}
+	energyDrift = (startEnergy != 0.0) ? (energy - startEnergy) / std::abs(startEnergy) : 0.0;
+
+	logFile << ',' << kinetic << ',' << hostResults[DIAG_ROWS-1] << ',' << energy;
+	logFile << ',' << std::sqrt(momentum[0]*momentum[0] + momentum[1]*momentum[1] + momentum[2]*momentum[2]);
+	logFile << ',' << std::sqrt(angMomentum[0]*angMomentum[0] + angMomentum[1]*angMomentum[1] + angMomentum[2]*angMomentum[2]);
+	logFile << ',' << energyDrift << '\n';
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include "OpenCL.h"
+#include "ParticlePool.h"
+#include <fstream>
+
+class Diagnostics
+{
+public:
+	void Initialize(CL* pOpenCL, uint32_t sampleSteps, bool withPotential);
+	void Sample(ParticlePool& posPool, ParticlePool& negPool);
+	void Poll();
+private:
+	void WriteSample();
+public:
+	uint32_t interval;
+	bool potential;
+	double energyDrift;
+private:
+	CL* openCL;
+	cl::Buffer partials;
+	cl::Buffer offsets;
+	cl::Buffer results;
+	cl::Event readEvent;
+	cl_double hostResults[DIAG_ROWS];
+	bool pending;
+	uint64_t step;
+	uint64_t sampleStep;
+	double startEnergy;
+	bool haveStart;
+	std::ofstream logFile;
+};
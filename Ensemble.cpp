@@ -0,0 +1,166 @@
+#include "Ensemble.h"
+#include "Timer.h"
+#include <sstream>
+#include <iomanip>
+#include <cmath>
+
+void Ensemble::Initialize(CL* pOpenCL, uint32_t systemCount, uint32_t speciesCount, bool compactStorage,
+						  uint64_t seed, cl_uint dist, cl_uint clumps, uint32_t sampleSteps)
+{
+	openCL = pOpenCL;
+	interval = sampleSteps;
+	step = 0;
+
+	BuildSystems(systemCount, speciesCount, seed);
+	cl_uint systemTotal = systems.size();
+	size_t stride = compactStorage ? sizeof(cl_CompactParticle) : sizeof(cl_Particle);
+
+	// one pair of buffers for the whole ensemble, systems find their slice through the table
+	posBuff = cl::Buffer(openCL->context, CL_MEM_READ_WRITE, stride * std::max(posTotal, (uint32_t)1));
+	negBuff = cl::Buffer(openCL->context, CL_MEM_READ_WRITE, stride * std::max(negTotal, (uint32_t)1));
+	sysBuff = cl::Buffer(openCL->context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(cl_SystemInfo) * systemTotal, systems.data());
+	results = cl::Buffer(openCL->context, CL_MEM_READ_WRITE, sizeof(cl_double) * ENS_TERMS * systemTotal);
+	hostResults.resize(ENS_TERMS * systemTotal);
+	startEnergy.assign(systemTotal, 0.0);
+	energyDrift.assign(systemTotal, 0.0);
+
+	openCL->EnsG_Kernel.setArg(0, posBuff);
+	openCL->EnsG_Kernel.setArg(1, negBuff);
+	openCL->EnsG_Kernel.setArg(2, sysBuff);
+	openCL->EnsG_Kernel.setArg(3, systemTotal);
+	openCL->EnsG_Kernel.setArg(4, posTotal);
+	openCL->EnsG_Kernel.setArg(5, dist);
+	openCL->EnsG_Kernel.setArg(6, clumps);
+	openCL->EnsembleGenerate(posTotal + negTotal);
+
+	openCL->EnsU_Kernel.setArg(0, posBuff);
+	openCL->EnsU_Kernel.setArg(1, negBuff);
+	openCL->EnsU_Kernel.setArg(2, sysBuff);
+	openCL->EnsU_Kernel.setArg(3, systemTotal);
+	openCL->EnsU_Kernel.setArg(4, posTotal);
+
+	openCL->EnsD_Kernel.setArg(0, posBuff);
+	openCL->EnsD_Kernel.setArg(1, negBuff);
+	openCL->EnsD_Kernel.setArg(2, sysBuff);
+	openCL->EnsD_Kernel.setArg(3, results);
+
+	logFile.open(GLOBALS::DATA_FOLDER+ENSEMBLE_LOG);
+	if (!logFile.is_open()) {
+		HandleFatalError(7, "Unable to open ensemble log: "+GLOBALS::DATA_FOLDER+ENSEMBLE_LOG);
+	}
+	logFile.precision(12);
+	logFile << "step,system,g,pos_count,neg_count,seed,pos_mass,neg_mass,kinetic,potential,energy,px,py,pz,energy_drift\n";
+
+	PrintLine("Ensemble: "+VarToStr(systemTotal)+" systems, "+VarToStr(posTotal+negTotal)+" particles");
+}
+
+void Ensemble::BuildSystems(uint32_t systemCount, uint32_t speciesCount, uint64_t seed)
+{
+	systems.clear();
+
+	// a parameter file lists one system per line as g,pos_count,neg_count,seed
+	std::ifstream paramFile(GLOBALS::DATA_FOLDER+ENSEMBLE_PARAMS);
+	std::string line;
+	while (paramFile.is_open() && std::getline(paramFile, line)) {
+		if (line.empty() || line[0] < '0' || line[0] > '9') continue;
+		std::stringstream fields(line);
+		std::string g, pos, neg, sysSeed;
+		std::getline(fields, g, ',');
+		std::getline(fields, pos, ',');
+		std::getline(fields, neg, ',');
+		std::getline(fields, sysSeed, ',');
+
+		cl_SystemInfo sys;
+		sys.g = stod(g);
+		sys.pos_count = stoul(pos);
+		sys.neg_count = stoul(neg);
+		sys.seed = sysSeed.empty() ? seed + systems.size() : stoull(sysSeed);
+		systems.push_back(sys);
+	}
+
+	// otherwise sweep G across the systems around its usual value
+	if (systems.empty()) {
+		for (uint32_t e=0; e < systemCount; ++e) {
+			double t = (systemCount > 1) ? e / (double)(systemCount - 1) : 0.5;
+			cl_SystemInfo sys;
+			sys.g = SIM_G * (1.0 - ENS_G_SPREAD + 2.0 * ENS_G_SPREAD * t);
+			sys.pos_count = speciesCount;
+			sys.neg_count = speciesCount;
+			sys.seed = seed + e;
+			systems.push_back(sys);
+		}
+	}
+
+	posTotal = negTotal = 0;
+	for (size_t e=0; e < systems.size(); ++e) {
+		systems[e].pos_first = posTotal;
+		systems[e].neg_first = negTotal;
+		posTotal += systems[e].pos_count;
+		negTotal += systems[e].neg_count;
+	}
+}
+
+void Ensemble::Run(uint32_t steps)
+{
+	double interactions = 0.0;
+	for (size_t e=0; e < systems.size(); ++e) {
+		double count = (double)systems[e].pos_count + systems[e].neg_count;
+		interactions += count * count;
+	}
+
+	Sample();
+	Timer runTimer;
+	float sampleTime = 0.0f;
+
+	for (uint32_t s=0; s < steps; ++s) {
+		openCL->EnsU_Kernel.setArg(5, (cl_uint)(step & 1));
+		openCL->EnsembleUpdate(posTotal + negTotal);
+		step++;
+
+		if (interval > 0 && step % interval == 0) {
+			// let the queued updates finish first so only the sample itself is excluded
+			openCL->queue.finish();
+			Timer sampleTimer;
+			Sample();
+			sampleTime += sampleTimer.MilliCount();
+		}
+	}
+	openCL->queue.finish();
+
+	// worst drift over the systems is the quickest sign that a G or count is too aggressive
+	size_t worst = 0;
+	for (size_t e=1; e < systems.size(); ++e) {
+		if (std::abs(energyDrift[e]) > std::abs(energyDrift[worst])) worst = e;
+	}
+
+	double runTime = std::max(runTimer.MilliCount() - sampleTime, 0.001f);
+	std::stringstream report;
+	report << "Ensemble: " << steps << " steps of " << systems.size() << " systems in " << std::fixed << std::setprecision(1);
+	report << runTime << " ms | " << std::setprecision(3) << (runTime / std::max(steps, (uint32_t)1)) << " ms/step | ";
+	report << std::setprecision(2) << (interactions * steps / (runTime * 1e6)) << " G interactions/s";
+	if (!systems.empty()) {
+		report << " | worst energy drift " << std::scientific << energyDrift[worst] << " (system " << worst << ")";
+	}
+	PrintLine(report);
+}
+
+void Ensemble::Sample()
+{
+	// blocking, the ensemble runs headless on its own so nothing else is waiting
+	openCL->EnsD_Kernel.setArg(4, (cl_uint)(step & 1));
+	openCL->EnsembleDiagnostics(systems.size());
+	openCL->queue.enqueueReadBuffer(results, CL_TRUE, 0, sizeof(cl_double) * hostResults.size(), hostResults.data());
+
+	for (size_t e=0; e < systems.size(); ++e) {
+		const cl_double* terms = hostResults.data() + e*ENS_TERMS;
+		double energy = terms[2] + terms[3];
+		if (step == 0) startEnergy[e] = energy;
+		energyDrift[e] = (startEnergy[e] != 0.0) ? (energy - startEnergy[e]) / std::abs(startEnergy[e]) : 0.0;
+
+		logFile << step << ',' << e << ',' << systems[e].g << ',' << systems[e].pos_count << ',' << systems[e].neg_count;
+		logFile << ',' << systems[e].seed;
+		for (int t=0; t < 4; ++t) logFile << ',' << terms[t];
+		logFile << ',' << energy << ',' << terms[4] << ',' << terms[5] << ',' << terms[6];
+		logFile << ',' << energyDrift[e] << '\n';
+	}
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include "OpenCL.h"
+#include <fstream>
+#include <vector>
+
+// many small independent systems packed back to back in one pair of buffers, each with
+// its own G, counts and seed, all stepped by a single launch
+class Ensemble
+{
+public:
+	void Initialize(CL* pOpenCL, uint32_t systemCount, uint32_t speciesCount, bool compactStorage,
+					uint64_t seed, cl_uint dist, cl_uint clumps, uint32_t sampleSteps);
+	void Run(uint32_t steps);
+private:
+	void BuildSystems(uint32_t systemCount, uint32_t speciesCount, uint64_t seed);
+	void Sample();
+public:
+	std::vector<cl_SystemInfo> systems;
+	uint32_t posTotal;
+	uint32_t negTotal;
+	uint32_t interval;
+private:
+	CL* openCL;
+	cl::Buffer posBuff;
+	cl::Buffer negBuff;
+	cl::Buffer sysBuff;
+	cl::Buffer results;
+	std::vector<cl_double> hostResults;
+	std::vector<double> startEnergy;
+	std::vector<double> energyDrift;
+	uint64_t step;
+	std::ofstream logFile;
+};
@@ -0,0 +1,61 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// bounded single producer single consumer queue, the producer only moves head and the
+// consumer only moves tail so neither side ever takes a lock or waits on the other
+template <typename T, size_t N>
+class EventRing
+{
+	static_assert((N & (N - 1)) == 0, "ring size must be a power of two");
+public:
+	EventRing() : head(0), tail(0), dropped(0) {}
+
+	// producer side, a full ring drops the new item since only the consumer may move tail
+	bool Push(const T& item)
+	{
+		size_t h = head.load(std::memory_order_relaxed);
+		if (h - tail.load(std::memory_order_acquire) == N) {
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		items[h & (N - 1)] = item;
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+	// consumer side
+	bool Pop(T& item)
+	{
+		size_t t = tail.load(std::memory_order_relaxed);
+		if (t == head.load(std::memory_order_acquire)) return false;
+		item = items[t & (N - 1)];
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+	bool Peek(T& item) const
+	{
+		size_t t = tail.load(std::memory_order_relaxed);
+		if (t == head.load(std::memory_order_acquire)) return false;
+		item = items[t & (N - 1)];
+		return true;
+	}
+	bool Empty() const
+	{
+		return tail.load(std::memory_order_relaxed) == head.load(std::memory_order_acquire);
+	}
+	void Clear()
+	{
+		tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+	}
+	uint32_t Dropped() const
+	{
+		return dropped.load(std::memory_order_relaxed);
+	}
+private:
+	T items[N];
+	std::atomic<size_t> head;
+	std::atomic<size_t> tail;
+	std::atomic<uint32_t> dropped;
+};
@@ -1,100 +1,391 @@
-#include "GLGraphics.h"
-
-void GLGraphics::Initialize(GLFWwindow* pWindow, cl_context& context)
-{
-	window = pWindow;
-	cl_con = context;
-	cursorLocked = false;
-
-	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
-	glfwGetFramebufferSize(window, &windowWidth, &windowHeight);
-
-	widthHalf = windowWidth / 2;
-	heightHalf = windowHeight / 2;
-	widthSpan = windowWidth - 1;
-	heightSpan = windowHeight - 1;
-
-	glGenFramebuffers(1, &gl_fb_id);
-	glGenRenderbuffers(1, &gl_rb_id);
-	glGenTextures(1, &gl_tex_id);
-
-	glBindFramebuffer(GL_FRAMEBUFFER, gl_fb_id);
-	glBindRenderbuffer(GL_RENDERBUFFER, gl_rb_id);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA, windowWidth, windowHeight);
-	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, gl_rb_id);
-
-	glBindTexture(GL_TEXTURE_2D, gl_tex_id);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, windowWidth, windowHeight, 0, GL_RGBA, GL_FLOAT, NULL);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gl_tex_id, 0);
-
-	gl_status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-	if (gl_status != GL_FRAMEBUFFER_COMPLETE) {
-		std::cout << "Error: FrameBuffer is not complete.\n";
-		GLFW::error_exit(window);
-	}
-
-	//gl_backBuff = clCreateFromGLTexture2D(cl_con, CL_MEM_WRITE_ONLY, GL_TEXTURE_2D, 0, gl_tex_id, &cl_error);
-	gl_backBuff = clCreateFromGLTexture(cl_con, CL_MEM_WRITE_ONLY, GL_TEXTURE_2D, 0, gl_tex_id, &cl_error);
-
-	if (!gl_backBuff || cl_error != CL_SUCCESS)
-	{
-		std::cout << "Failed to create OpenGL texture reference!\n";
-		GLFW::error_exit(window);
-	}
-
-	glClearColor(0.0, 0.0, 0.0, 1.0);
-	glFinish();
-}
-
-void GLGraphics::ToggleCursorLock()
-{
-	if (cursorLocked) {
-		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
-	} else {
-		glfwSetCursorPos(window, 0.0, 0.0);
-		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-	}
-	cursorLocked = !cursorLocked;
-}
-
-void GLGraphics::GetWindowSize(int* width, int* height)
-{
-    glfwGetFramebufferSize(window, width, height);
-}
-
-void GLGraphics::AcquireBackBuff(cl_command_queue& queue)
-{
-	cl_error = clEnqueueAcquireGLObjects(queue, 1, &gl_backBuff, 0, NULL, NULL);
-	assert(cl_error == CL_SUCCESS);
-}
-
-void GLGraphics::ReleaseBackBuff(cl_command_queue& queue)
-{
-	cl_error = clEnqueueReleaseGLObjects(queue, 1, &gl_backBuff, 0, NULL, NULL);
-	assert(cl_error == CL_SUCCESS);
-}
-
-void GLGraphics::SetWindowSize(int width, int height)
-{
-	glViewport(0, 0, width, height);
-	windowWidth = width;
-	windowHeight = height;
-}
-
-void GLGraphics::BeginFrame()
-{
-	glBindFramebuffer(GL_FRAMEBUFFER, gl_fb_id);
-	glClear(GL_COLOR_BUFFER_BIT);
-	glFinish();
-}
-
-void GLGraphics::DisplayFrame()
-{
-	glBindFramebuffer(GL_READ_FRAMEBUFFER, gl_fb_id);
-	//glReadBuffer(GL_COLOR_ATTACHMENT0);
-	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-	glBlitFramebuffer(0, 0, windowWidth, windowHeight, 0, 0, windowWidth, windowHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
-
-	glFinish();
-	glfwSwapBuffers(window);
-}
+#include "GLGraphics.h"
+
+void GLGraphics::Initialize(GLFWwindow* pWindow, cl_context& context, CLEventFromGLsync eventFromGLsync)
+{
+	window = pWindow;
+	cl_con = context;
+	cursorLocked = false;
+	renderSlot = 0;
+	syncTime = 0.0f;
+
+	// use sync objects on the device when both APIs support them
+	clEventFromGLsync = eventFromGLsync;
+	glWaitsOnCL = GLEW_ARB_cl_event;
+
+	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+	glfwGetFramebufferSize(window, &windowWidth, &windowHeight);
+
+	widthHalf = windowWidth / 2;
+	heightHalf = windowHeight / 2;
+	widthSpan = windowWidth - 1;
+	heightSpan = windowHeight - 1;
+	renderWidth = windowWidth;
+	renderHeight = windowHeight;
+
+	// textures are sized for the biggest the window can get so resizing never reallocates
+	const GLFWvidmode* vidMode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+	maxWidth = std::max(windowWidth, vidMode->width);
+	maxHeight = std::max(windowHeight, vidMode->height);
+
+	glGenFramebuffers(FRAME_RING_SIZE, gl_fb_ids);
+	glGenTextures(FRAME_RING_SIZE, gl_tex_ids);
+
+	// ring of shared textures so OCL can render one while OGL shows another
+	for (int i=0; i < FRAME_RING_SIZE; ++i) {
+		glBindFramebuffer(GL_FRAMEBUFFER, gl_fb_ids[i]);
+		glBindTexture(GL_TEXTURE_2D, gl_tex_ids[i]);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, maxWidth, maxHeight, 0, GL_RGBA, GL_FLOAT, NULL);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gl_tex_ids[i], 0);
+
+		gl_status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+		if (gl_status != GL_FRAMEBUFFER_COMPLETE) {
+			std::cout << "Error: FrameBuffer is not complete.\n";
+			GLFW::error_exit(window);
+		}
+
+		gl_backBuffs[i] = clCreateFromGLTexture(cl_con, CL_MEM_WRITE_ONLY, GL_TEXTURE_2D, 0, gl_tex_ids[i], &cl_error);
+
+		if (!gl_backBuffs[i] || cl_error != CL_SUCCESS)
+		{
+			std::cout << "Failed to create OpenGL texture reference!\n";
+			GLFW::error_exit(window);
+		}
+
+		gl_fences[i] = NULL;
+		cl_fenceEvents[i] = NULL;
+		cl_releases[i] = NULL;
+	}
+
+	gl_backBuff = gl_backBuffs[renderSlot];
+
+	glClearColor(0.0, 0.0, 0.0, 1.0);
+	glFinish();
+}
+
+void GLGraphics::ToggleCursorLock()
+{
+	if (cursorLocked) {
+		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+	} else {
+		glfwSetCursorPos(window, 0.0, 0.0);
+		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+	}
+	cursorLocked = !cursorLocked;
+}
+
+void GLGraphics::GetWindowSize(int* width, int* height)
+{
+    glfwGetFramebufferSize(window, width, height);
+}
+
+void GLGraphics::WaitForSlot()
+{
+	// without GL event sharing the CPU has to see the slot's last blit finish before reuse
+	if (clEventFromGLsync != NULL || gl_fences[renderSlot] == NULL) return;
+	syncTimer.ResetTimer();
+	glClientWaitSync(gl_fences[renderSlot], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+	syncTime += syncTimer.MilliCount();
+	glDeleteSync(gl_fences[renderSlot]);
+	gl_fences[renderSlot] = NULL;
+}
+
+void GLGraphics::AcquireBackBuff(cl_command_queue& queue)
+{
+	// free the sync objects used the last time this slot came around
+	if (cl_fenceEvents[renderSlot] != NULL) {
+		clReleaseEvent(cl_fenceEvents[renderSlot]);
+		cl_fenceEvents[renderSlot] = NULL;
+	}
+
+	// the texture can't be written until OGL has finished blitting it
+	if (gl_fences[renderSlot] != NULL) {
+		if (clEventFromGLsync != NULL) {
+			cl_fenceEvents[renderSlot] = clEventFromGLsync(cl_con, (cl_GLsync)gl_fences[renderSlot], &cl_error);
+		} else {
+			WaitForSlot();
+		}
+	}
+
+	if (cl_fenceEvents[renderSlot] != NULL) {
+		cl_error = clEnqueueAcquireGLObjects(queue, 1, &gl_backBuff, 1, &cl_fenceEvents[renderSlot], NULL);
+	} else {
+		cl_error = clEnqueueAcquireGLObjects(queue, 1, &gl_backBuff, 0, NULL, NULL);
+	}
+	assert(cl_error == CL_SUCCESS);
+}
+
+void GLGraphics::ReleaseBackBuff(cl_command_queue& queue)
+{
+	cl_error = clEnqueueReleaseGLObjects(queue, 1, &gl_backBuff, 0, NULL, &cl_releases[renderSlot]);
+	assert(cl_error == CL_SUCCESS);
+
+	// start the work without waiting for it
+	clFlush(queue);
+}
+
+void GLGraphics::SetWindowSize(int width, int height)
+{
+	glViewport(0, 0, width, height);
+	windowWidth = width;
+	windowHeight = height;
+	widthHalf = windowWidth / 2;
+	heightHalf = windowHeight / 2;
+	widthSpan = windowWidth - 1;
+	heightSpan = windowHeight - 1;
+}
+
+void GLGraphics::SetRenderSize(int width, int height)
+{
+	renderWidth = std::min(width, maxWidth);
+	renderHeight = std::min(height, maxHeight);
+}
+
+void GLGraphics::BeginFrame()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, gl_fb_ids[renderSlot]);
+	glClear(GL_COLOR_BUFFER_BIT);
+	glFinish();
+}
+
+void GLGraphics::DisplayFrame()
+{
+	// make OGL wait until OCL has released the texture
+	if (cl_releases[renderSlot] != NULL) {
+		if (glWaitsOnCL) {
+			GLsync cl_sync = glCreateSyncFromCLeventARB(cl_con, cl_releases[renderSlot], 0);
+			glWaitSync(cl_sync, 0, GL_TIMEOUT_IGNORED);
+			glDeleteSync(cl_sync);
+		} else {
+			syncTimer.ResetTimer();
+			clWaitForEvents(1, &cl_releases[renderSlot]);
+			syncTime += syncTimer.MilliCount();
+		}
+		clReleaseEvent(cl_releases[renderSlot]);
+		cl_releases[renderSlot] = NULL;
+	}
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, gl_fb_ids[renderSlot]);
+	//glReadBuffer(GL_COLOR_ATTACHMENT0);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	// the frame only fills the corner of the texture when rendering below window size
+	GLenum filter = (renderWidth == windowWidth && renderHeight == windowHeight) ? GL_NEAREST : GL_LINEAR;
+	glBlitFramebuffer(0, 0, renderWidth, renderHeight, 0, 0, windowWidth, windowHeight, GL_COLOR_BUFFER_BIT, filter);
+
+	// fence the blit so OCL knows when the texture is free again
+	if (gl_fences[renderSlot] != NULL) {
+		glDeleteSync(gl_fences[renderSlot]);
+	}
+	gl_fences[renderSlot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	glfwSwapBuffers(window);
+
+	// move on to the next texture in the ring
+	renderSlot = (renderSlot + 1) % FRAME_RING_SIZE;
+	gl_backBuff = gl_backBuffs[renderSlot];
+}
+
+GLuint GLGraphics::LoadShader(GLenum type, const std::string& filename)
+{
+	std::string source = ReadFileStr(GLOBALS::DATA_FOLDER+filename);
+	const GLchar* src_ptr = source.c_str();
+	GLint compiled;
+
+	GLuint shader_id = glCreateShader(type);
+	glShaderSource(shader_id, 1, &src_ptr, NULL);
+	glCompileShader(shader_id);
+	glGetShaderiv(shader_id, GL_COMPILE_STATUS, &compiled);
+
+	if (compiled != GL_TRUE) {
+		GLchar info_log[1024];
+		glGetShaderInfoLog(shader_id, sizeof(info_log), NULL, info_log);
+		std::cout << "Error: failed to compile shader " << filename << "\n" << info_log << "\n";
+		GLFW::error_exit(window);
+	}
+
+	return shader_id;
+}
+
+void GLGraphics::InitSprites()
+{
+	GLint linked;
+	GLuint vs_id = LoadShader(GL_VERTEX_SHADER, SPRITE_VS_FILE);
+	GLuint fs_id = LoadShader(GL_FRAGMENT_SHADER, SPRITE_FS_FILE);
+
+	gl_prog_id = glCreateProgram();
+	glAttachShader(gl_prog_id, vs_id);
+	glAttachShader(gl_prog_id, fs_id);
+	glLinkProgram(gl_prog_id);
+	glGetProgramiv(gl_prog_id, GL_LINK_STATUS, &linked);
+	glDeleteShader(vs_id);
+	glDeleteShader(fs_id);
+
+	if (linked != GL_TRUE) {
+		GLchar info_log[1024];
+		glGetProgramInfoLog(gl_prog_id, sizeof(info_log), NULL, info_log);
+		std::cout << "Error: failed to link sprite program\n" << info_log << "\n";
+		GLFW::error_exit(window);
+	}
+
+	// depth buffer for hardware depth testing of sprites
+	glGenRenderbuffers(1, &gl_db_id);
+	glBindRenderbuffer(GL_RENDERBUFFER, gl_db_id);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, maxWidth, maxHeight);
+
+	for (int i=0; i < FRAME_RING_SIZE; ++i) {
+		glBindFramebuffer(GL_FRAMEBUFFER, gl_fb_ids[i]);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, gl_db_id);
+
+		gl_status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+		if (gl_status != GL_FRAMEBUFFER_COMPLETE) {
+			std::cout << "Error: Sprite FrameBuffer is not complete.\n";
+			GLFW::error_exit(window);
+		}
+	}
+
+	// one particle buffer per species, allocated by the particle pools
+	glGenVertexArrays(2, gl_vao_ids);
+	gl_vbo_ids[0] = 0;
+	gl_vbo_ids[1] = 0;
+	gl_spriteFence = NULL;
+	cl_spriteFenceEvent = NULL;
+	cl_spriteRelease = NULL;
+	glFinish();
+}
+
+void GLGraphics::ResizeSprites(int index, size_t buffSize, size_t keepSize)
+{
+	GLuint new_vbo_id;
+	glGenBuffers(1, &new_vbo_id);
+	glBindBuffer(GL_ARRAY_BUFFER, new_vbo_id);
+	glBufferData(GL_ARRAY_BUFFER, buffSize, NULL, GL_DYNAMIC_COPY);
+
+	// carry the live particles over without a round trip through the host
+	if (gl_vbo_ids[index] != 0) {
+		if (keepSize > 0) {
+			glBindBuffer(GL_COPY_READ_BUFFER, gl_vbo_ids[index]);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_ARRAY_BUFFER, 0, 0, keepSize);
+			glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		}
+		glDeleteBuffers(1, &gl_vbo_ids[index]);
+	}
+	gl_vbo_ids[index] = new_vbo_id;
+
+	// particles are read per instance straight from the CL layout
+	glBindVertexArray(gl_vao_ids[index]);
+
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_DOUBLE, GL_FALSE, sizeof(cl_Particle), (GLvoid*)offsetof(cl_Particle, new_pos));
+	glVertexAttribDivisor(0, 1);
+
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(cl_Particle), (GLvoid*)offsetof(cl_Particle, radius));
+	glVertexAttribDivisor(1, 1);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	// OCL waits on this before it next acquires the buffers, so the copy is done by then
+	FenceSprites();
+}
+
+void GLGraphics::FenceSprites()
+{
+	if (gl_spriteFence != NULL) {
+		glDeleteSync(gl_spriteFence);
+	}
+	gl_spriteFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	glFlush();
+}
+
+void GLGraphics::AcquireSprites(cl_command_queue& queue, const std::vector<cl::Memory>& buffers)
+{
+	cl_mem mems[2] = { buffers[0](), buffers[1]() };
+
+	if (cl_spriteFenceEvent != NULL) {
+		clReleaseEvent(cl_spriteFenceEvent);
+		cl_spriteFenceEvent = NULL;
+	}
+
+	// the vertex buffers can't be written until OGL has finished drawing from them
+	if (gl_spriteFence != NULL) {
+		if (clEventFromGLsync != NULL) {
+			cl_spriteFenceEvent = clEventFromGLsync(cl_con, (cl_GLsync)gl_spriteFence, &cl_error);
+		} else {
+			syncTimer.ResetTimer();
+			glClientWaitSync(gl_spriteFence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+			syncTime += syncTimer.MilliCount();
+		}
+	}
+
+	if (cl_spriteFenceEvent != NULL) {
+		cl_error = clEnqueueAcquireGLObjects(queue, 2, mems, 1, &cl_spriteFenceEvent, NULL);
+	} else {
+		cl_error = clEnqueueAcquireGLObjects(queue, 2, mems, 0, NULL, NULL);
+	}
+	assert(cl_error == CL_SUCCESS);
+}
+
+void GLGraphics::ReleaseSprites(cl_command_queue& queue, const std::vector<cl::Memory>& buffers)
+{
+	cl_mem mems[2] = { buffers[0](), buffers[1]() };
+
+	if (cl_spriteRelease != NULL) {
+		clReleaseEvent(cl_spriteRelease);
+	}
+	cl_error = clEnqueueReleaseGLObjects(queue, 2, mems, 0, NULL, &cl_spriteRelease);
+	assert(cl_error == CL_SUCCESS);
+
+	// start the work without waiting for it
+	clFlush(queue);
+}
+
+void GLGraphics::BeginSprites(const cl_CamInfo& camInfo)
+{
+	// make OGL wait until OCL has released the vertex buffers
+	if (cl_spriteRelease != NULL) {
+		if (glWaitsOnCL) {
+			GLsync cl_sync = glCreateSyncFromCLeventARB(cl_con, cl_spriteRelease, 0);
+			glWaitSync(cl_sync, 0, GL_TIMEOUT_IGNORED);
+			glDeleteSync(cl_sync);
+		} else {
+			syncTimer.ResetTimer();
+			clWaitForEvents(1, &cl_spriteRelease);
+			syncTime += syncTimer.MilliCount();
+		}
+		clReleaseEvent(cl_spriteRelease);
+		cl_spriteRelease = NULL;
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, gl_fb_ids[renderSlot]);
+	glViewport(0, 0, renderWidth, renderHeight);
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(GL_LESS);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	glUseProgram(gl_prog_id);
+	glUniform3f(glGetUniformLocation(gl_prog_id, "cam_pos"), camInfo.cam_pos.s[0], camInfo.cam_pos.s[1], camInfo.cam_pos.s[2]);
+	glUniform3f(glGetUniformLocation(gl_prog_id, "cam_rgt"), camInfo.cam_rgt.s[0], camInfo.cam_rgt.s[1], camInfo.cam_rgt.s[2]);
+	glUniform3f(glGetUniformLocation(gl_prog_id, "cam_up"), camInfo.cam_up.s[0], camInfo.cam_up.s[1], camInfo.cam_up.s[2]);
+	glUniform3f(glGetUniformLocation(gl_prog_id, "cam_fwd"), camInfo.cam_fwd.s[0], camInfo.cam_fwd.s[1], camInfo.cam_fwd.s[2]);
+	glUniform1f(glGetUniformLocation(gl_prog_id, "cam_foc"), camInfo.cam_foc);
+	glUniform2f(glGetUniformLocation(gl_prog_id, "half_res"), renderWidth / 2, renderHeight / 2);
+	glUniform2f(glGetUniformLocation(gl_prog_id, "depth_rng"), SPRITE_NEAR, SPRITE_FAR);
+}
+
+void GLGraphics::DrawSprites(int index, uint32_t count, const cl_RGB32& color)
+{
+	glUniform3f(glGetUniformLocation(gl_prog_id, "prtcl_color"), color.s[2] / 255.0f, color.s[1] / 255.0f, color.s[0] / 255.0f);
+	glBindVertexArray(gl_vao_ids[index]);
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+}
+
+void GLGraphics::EndSprites()
+{
+	glBindVertexArray(0);
+	glUseProgram(0);
+	glDisable(GL_DEPTH_TEST);
+	glViewport(0, 0, windowWidth, windowHeight);
+
+	// fence the draws so OCL knows when the vertex buffers are free again
+	FenceSprites();
+}
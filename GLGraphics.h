@@ -1,34 +1,68 @@
-#pragma once
-#include "GLFWFuncs.h"
-#include "OpenCL.h"
-#include <assert.h>
-
-class GLGraphics
-{
-public:
-	void Initialize(GLFWwindow* pWindow, cl_context& context);
-	void AcquireBackBuff(cl_command_queue& queue);
-	void ReleaseBackBuff(cl_command_queue& queue);
-	void ToggleCursorLock();
-	void GetWindowSize(int* width, int* height);
-	void SetWindowSize(int width, int height);
-	void BeginFrame();
-	void DisplayFrame();
-private:
-	GLuint		gl_fb_id;
-	GLuint		gl_rb_id;
-	GLuint		gl_tex_id;
-	GLenum		gl_status;
-	cl_int		cl_error;
-	cl_context	cl_con;
-public:
-	GLFWwindow*	window;
-	cl_mem		gl_backBuff;
-	int			windowWidth;
-	int			windowHeight;
-	int			widthHalf;
-	int			heightHalf;
-	int         widthSpan;
-	int         heightSpan;
-	bool		cursorLocked;
-};
+#pragma once
+#include "GLFWFuncs.h"
+#include "OpenCL.h"
+#include <assert.h>
+#include <cstddef>
+#include <algorithm>
+#include "Timer.h"
+
+class GLGraphics
+{
+public:
+	void Initialize(GLFWwindow* pWindow, cl_context& context, CLEventFromGLsync eventFromGLsync);
+	void WaitForSlot();
+	void AcquireBackBuff(cl_command_queue& queue);
+	void ReleaseBackBuff(cl_command_queue& queue);
+	void ToggleCursorLock();
+	void GetWindowSize(int* width, int* height);
+	void SetWindowSize(int width, int height);
+	void SetRenderSize(int width, int height);
+	void BeginFrame();
+	void DisplayFrame();
+	void InitSprites();
+	void ResizeSprites(int index, size_t buffSize, size_t keepSize);
+	void AcquireSprites(cl_command_queue& queue, const std::vector<cl::Memory>& buffers);
+	void ReleaseSprites(cl_command_queue& queue, const std::vector<cl::Memory>& buffers);
+	void BeginSprites(const cl_CamInfo& camInfo);
+	void DrawSprites(int index, uint32_t count, const cl_RGB32& color);
+	void EndSprites();
+private:
+	GLuint LoadShader(GLenum type, const std::string& filename);
+	void FenceSprites();
+private:
+	GLuint		gl_fb_ids[FRAME_RING_SIZE];
+	GLuint		gl_tex_ids[FRAME_RING_SIZE];
+	GLsync		gl_fences[FRAME_RING_SIZE];
+	cl_mem		gl_backBuffs[FRAME_RING_SIZE];
+	cl_event	cl_fenceEvents[FRAME_RING_SIZE];
+	cl_event	cl_releases[FRAME_RING_SIZE];
+	GLuint		gl_db_id;
+	GLuint		gl_prog_id;
+	GLuint		gl_vao_ids[2];
+	GLsync		gl_spriteFence;
+	cl_event	cl_spriteFenceEvent;
+	cl_event	cl_spriteRelease;
+	GLenum		gl_status;
+	cl_int		cl_error;
+	cl_context	cl_con;
+	int			renderSlot;
+	bool		glWaitsOnCL;
+	CLEventFromGLsync clEventFromGLsync;
+	Timer		syncTimer;
+public:
+	GLFWwindow*	window;
+	cl_mem		gl_backBuff;
+	GLuint		gl_vbo_ids[2];
+	int			windowWidth;
+	int			windowHeight;
+	int			renderWidth;
+	int			renderHeight;
+	int			maxWidth;
+	int			maxHeight;
+	int			widthHalf;
+	int			heightHalf;
+	int         widthSpan;
+	int         heightSpan;
+	bool		cursorLocked;
+	float		syncTime;
+};
@@ -1,272 +1,996 @@
-#include "Game.h"
-#include <time.h>
-#include <cstdlib>
-#include <string>
-#include <math.h>
-#include <iostream>
-#include <fstream>
-
-Game::Game(GLFWwindow* window, KeyboardServer& kServer, MouseServer& mServer)
-:
-	kbd( kServer ),
-	mouse( mServer )
-{
-	// ensure the compiler is playing nice
-	assert(sizeof(RGB32) == sizeof(cl_RGB32) && sizeof(RGB32) == 4);
-	assert(sizeof(Vec3) == sizeof(cl_float3) && sizeof(Vec3) == 16);
-	assert(sizeof(DVec3) == sizeof(cl_double3) && sizeof(DVec3) == 32);
-	assert(sizeof(cl_Particle) == 104);
-	assert(sizeof(cl_RenderInfo) == 256);
-
-	aa_level = stoi(GLOBALS::config_map["AA_LEVEL"]);
-
-	switch (aa_level) {
-		case 1: aaInfo = GLOBALS::AA_X1; break;
-		case 4: aaInfo = GLOBALS::AA_X4; break;
-		//case 9: aaInfo = GLOBALS::AA_X9; break;
-		//case 16: aaInfo = GLOBALS::AA_X16; break;
-		default:
-			HandleFatalError(1, "Invalid AA level detected: "+GLOBALS::config_map["AA_LEVEL"]);
-			break;
-	}
-
-	// Initialize OpenCL
-	openCL.Initialize();
-
-	// Initialize graphics manager
-	gfx.Initialize(window, openCL.context());
-
-	// Get window resolution profile
-    //resolution = SCREEN::GetProfile(gfx.windowWidth, gfx.windowHeight);
-
-	// set camera sensitivity and position with user settings
-	camera.sensitivity = stof(GLOBALS::config_map["MOUSE_SENSI"]);
-    camera.position.x = stof(GLOBALS::config_map["CAM_X_POS"]);
-    camera.position.y = stof(GLOBALS::config_map["CAM_Y_POS"]);
-    camera.position.z = stof(GLOBALS::config_map["CAM_Z_POS"]);
-	srand(time(NULL));
-
-	// calc useful screen info
-	widthHalf = gfx.windowWidth / 2;
-	heightHalf = gfx.windowHeight / 2;
-	widthRays = gfx.windowWidth * aaInfo.lvl;
-	heightRays = gfx.windowHeight * aaInfo.lvl;
-	widthSpan = gfx.windowWidth - 1;
-	heightSpan = gfx.windowHeight - 1;
-	pixCount = gfx.windowWidth * gfx.windowHeight;
-	fragCount = pixCount * aaInfo.lvl;
-
-	rInfo.aa_info = aaInfo;
-	rInfo.span_X = widthSpan;
-	rInfo.span_Y = heightSpan;
-	rInfo.pixels_X = gfx.windowWidth;
-	rInfo.pixels_Y = gfx.windowHeight;
-	rInfo.half_X = widthHalf;
-	rInfo.half_Y = heightHalf;
-	rInfo.particles = stoi(GLOBALS::config_map["PARTICLES"]);
-	rInfo.rand_int = rand();
-
-	// allocate memory on GPU for pixel fragment buffer
-	cl_fragBuff = cl::Buffer(openCL.context, CL_MEM_READ_WRITE, sizeof(cl_RGB32)*fragCount);
-
-	// allocate memory on GPU for positive particle buffer
-	cl_posBuff = cl::Buffer(openCL.context, CL_MEM_READ_WRITE, sizeof(cl_Particle)*rInfo.particles);
-
-	// allocate memory on GPU for positive particle buffer
-	cl_negBuff = cl::Buffer(openCL.context, CL_MEM_READ_WRITE, sizeof(cl_Particle)*rInfo.particles);
-
-	// generate random particles
-	char isNeg = 0;
-	openCL.Init_Kernel.setArg(0, cl_posBuff);
-	openCL.Init_Kernel.setArg(1, isNeg);
-	openCL.Init_Kernel.setArg(2, rInfo);
-	openCL.GenParticles(rInfo.particles);
-	openCL.queue.finish();
-
-	rInfo.rand_int = rand();
-	isNeg = 1;
-
-	openCL.Init_Kernel.setArg(0, cl_negBuff);
-	openCL.Init_Kernel.setArg(1, isNeg);
-	openCL.Init_Kernel.setArg(2, rInfo);
-	openCL.GenParticles(rInfo.particles);
-	openCL.queue.finish();
-
-	deltaTimer.ResetTimer();
-}
-
-Game::~Game(){}
-
-void Game::Go()
-{
-	deltaTime = deltaTimer.MilliCount();
-	deltaTimer.ResetTimer();
-	ComposeFrame();
-	gfx.DisplayFrame();
-}
-
-void Game::HandleInput()
-{
-	// keys for left and right tilt
-	if (kbd.KeyIsPressed(GLFW_KEY_E)) {
-		camera.orientation.z -= CAMSPIN_SPEED * deltaTime;
-	} else if (kbd.KeyIsPressed(GLFW_KEY_Q)) {
-		camera.orientation.z += CAMSPIN_SPEED * deltaTime;
-	}
-
-	KeyEvent ke = kbd.ReadKey();
-	if (ke.IsPress()) {
-		switch (ke.GetCode()) {
-		case GLFW_KEY_SCROLL_LOCK:
-			gfx.ToggleCursorLock();
-			break;
-		default: break;
-		}
-	}
-
-	// handle mouse events
-	MouseEvent me = mouse.ReadMouse();
-	switch (me.GetType()) {
-	case MouseEvent::Move:
-		if (gfx.cursorLocked) {
-			dX = me.GetX() * camera.sensitivity * deltaTime;
-			dY = me.GetY() * camera.sensitivity * deltaTime;
-			camera.orientation.x += dY;
-			camera.orientation.y -= dX;
-			glfwSetCursorPos(gfx.window, 0.0, 0.0);
-		}
-		break;
-	case MouseEvent::WheelUp:
-		camera.foclen += 10;
-		break;
-	case MouseEvent::WheelDown:
-		camera.foclen -= 10;
-		break;
-	case MouseEvent::LPress:
-		break;
-	case MouseEvent::RPress:
-		break;
-	case MouseEvent::LRelease:
-		break;
-	case MouseEvent::RRelease:
-		break;
-	case MouseEvent::Invalid:
-		break;
-	}
-
-	// update camera direction
-	camera.UpdateDirection();
-
-	// keys for up and down movement
-	if (kbd.KeyIsPressed(GLFW_KEY_PAGE_UP)) {
-		camera.position += camera.up * (CAMMOVE_SPEED * deltaTime);
-	} else if (kbd.KeyIsPressed(GLFW_KEY_PAGE_DOWN)) {
-		camera.position -= camera.up * (CAMMOVE_SPEED * deltaTime);
-	}
-
-	// keys for forward and backward movement
-	if (kbd.KeyIsPressed(GLFW_KEY_W)) {
-		camera.position += camera.forward * (CAMMOVE_SPEED * deltaTime);
-	} else if (kbd.KeyIsPressed(GLFW_KEY_S)) {
-		camera.position -= camera.forward * (CAMMOVE_SPEED * deltaTime);
-	}
-
-	// keys for right and left movement
-	if (kbd.KeyIsPressed(GLFW_KEY_D)) {
-		camera.position += camera.right * (CAMMOVE_SPEED * deltaTime);
-	} else if (kbd.KeyIsPressed(GLFW_KEY_A)) {
-		camera.position -= camera.right * (CAMMOVE_SPEED * deltaTime);
-	}
-}
-
-void Game::BeginActions()
-{
-	// calculate bottom left position of virtual screen
-	camera.bl_ray = (camera.forward * camera.foclen).
-					VectSub(camera.right * widthHalf).
-					VectSub(camera.up * heightHalf);
-
-	// save data to RenderInfo structure
-	rInfo.cam_info = camera.GetInfo();
-	rInfo.rand_int = rand();
-	rInfo.d_time = deltaTime;
-
-	openCL.FillF_Kernel.setArg(0, cl_fragBuff);
-	openCL.FillF_Kernel.setArg(1, rInfo);
-
-	openCL.FillFragBuff(gfx.windowWidth, gfx.windowHeight);
-	openCL.queue.finish();
-}
-
-void Game::ComputeStage1()
-{
-    // update particle positions
-
-	openCL.Update_Kernel.setArg(0, cl_posBuff);
-	openCL.Update_Kernel.setArg(1, cl_negBuff);
-	openCL.Update_Kernel.setArg(2, rInfo);
-
-	openCL.UpdateParticles(rInfo.particles);
-	openCL.queue.finish();
-}
-
-void Game::ComputeStage2()
-{
-	// compute final pixel colors
-
-	openCL.Draw_Kernel.setArg(0, cl_posBuff);
-	openCL.Draw_Kernel.setArg(1, cl_fragBuff);
-	openCL.Draw_Kernel.setArg(2, YELLOW.rgba);
-	openCL.Draw_Kernel.setArg(3, rInfo);
-	openCL.DrawParticles(rInfo.particles);
-
-	openCL.Draw_Kernel.setArg(0, cl_negBuff);
-	openCL.Draw_Kernel.setArg(1, cl_fragBuff);
-	openCL.Draw_Kernel.setArg(2, BLUE.rgba);
-	openCL.Draw_Kernel.setArg(3, rInfo);
-	openCL.DrawParticles(rInfo.particles);
-
-	openCL.queue.finish();
-}
-
-void Game::ComputeStage3()
-{
-	// write frag buffer to frame buffer
-
-	openCL.CopyF_Kernel.setArg(0, cl_fragBuff);
-	openCL.CopyF_Kernel.setArg(1, gfx.gl_backBuff);
-	openCL.CopyF_Kernel.setArg(2, rInfo);
-
-	openCL.FragsToFrame(gfx.windowWidth, gfx.windowHeight);
-	openCL.queue.finish();
-}
-
-void Game::RenderScene()
-{
-	// update particles
-	ComputeStage1();
-
-	// draw particles
-	ComputeStage2();
-
-	// write frame
-	ComputeStage3();
-}
-
-void Game::ComposeFrame()
-{
-	// handle keyboard/mouse actions
-	HandleInput();
-
-	// reset/update some stuff
-	BeginActions();
-
-	// give OCL control of OGL framebuffer
-	gfx.AcquireBackBuff(openCL.queue());
-
-	// render the 3D scene using OCL
-	RenderScene();
-
-	// make OCL release control of OGL memory
-	gfx.ReleaseBackBuff(openCL.queue());
-}
+#include "Game.h"
+#include <time.h>
+#include <cstdlib>
+#include <string>
+#include <math.h>
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <numeric>
+
+Game::Game(GLFWwindow* window, KeyboardServer& kServer, MouseServer& mServer)
+:
+	kbd( kServer ),
+	mouse( mServer )
+{
+	// ensure the compiler is playing nice
+	assert(sizeof(RGB32) == sizeof(cl_RGB32) && sizeof(RGB32) == 4);
+	assert(sizeof(Vec3) == sizeof(cl_float3) && sizeof(Vec3) == 16);
+	assert(sizeof(DVec3) == sizeof(cl_double3) && sizeof(DVec3) == 32);
+	assert(sizeof(cl_Particle) == 104);
+	assert(sizeof(cl_CompactParticle) == 40);
+	assert(sizeof(cl_RenderInfo) == 464);
+	assert(sizeof(cl_GridInfo) == 16);
+
+	aa_level = stoi(GLOBALS::config_map["AA_LEVEL"]);
+	aa_mode = stoi(GLOBALS::config_map["AA_MODE"]);
+
+	if (!SelectAALevel(aa_level)) {
+		HandleFatalError(1, "Invalid AA level detected: "+GLOBALS::config_map["AA_LEVEL"]);
+	}
+
+	// supersampled frags only have room for 4 samples
+	if (aa_level > 4 && aa_mode != AA_COVERAGE) {
+		HandleFatalError(1, "AA level "+GLOBALS::config_map["AA_LEVEL"]+" requires coverage AA (AA_MODE=1)");
+	}
+
+	switch (aa_mode) {
+		case AA_SUPERSAMPLE: break;
+		case AA_COVERAGE: clOptions += "-D AA_COVERAGE "; break;
+		case AA_TEMPORAL:
+			// temporal AA takes a single jittered sample per pixel
+			clOptions += "-D AA_TEMPORAL ";
+			SelectAALevel(1);
+			break;
+		default:
+			HandleFatalError(3, "Invalid AA mode detected: "+GLOBALS::config_map["AA_MODE"]);
+			break;
+	}
+
+	// camera-relative float projection is well under a pixel off, double is kept as a fallback
+	if (stoi(GLOBALS::config_map["FLOAT_PROJECTION"]) != 0) {
+		clOptions += "-D FLOAT_PROJECTION ";
+	}
+
+	renderMode = stoi(GLOBALS::config_map["RENDER_MODE"]);
+
+	switch (renderMode) {
+		case RENDER_COMPUTE: break;
+		case RENDER_SPRITES: break;
+		case RENDER_DENSITY: break;
+		default:
+			HandleFatalError(2, "Invalid render mode detected: "+GLOBALS::config_map["RENDER_MODE"]);
+			break;
+	}
+
+	// fixed-point positions and float velocities, the sprite shaders read the full layout directly
+	compactParticles = stoi(GLOBALS::config_map["COMPACT_PARTICLES"]) != 0;
+	if (compactParticles) {
+		if (renderMode == RENDER_SPRITES) {
+			HandleFatalError(10, "Compact particles (COMPACT_PARTICLES=1) cannot be drawn as sprites");
+		}
+		clOptions += "-D COMPACT_PARTICLES ";
+	}
+
+	cullParticles = stoi(GLOBALS::config_map["CULL_PARTICLES"]) != 0;
+	collideMode = stoi(GLOBALS::config_map["COLLISIONS"]);
+
+	if (collideMode < COLLIDE_OFF || collideMode > COLLIDE_MERGE) {
+		HandleFatalError(5, "Invalid collision mode detected: "+GLOBALS::config_map["COLLISIONS"]);
+	}
+
+	// the fused update fills the cull lists, so it needs them and nothing may move particles afterwards
+	fuseProject = stoi(GLOBALS::config_map["FUSED_PROJECT"]) != 0 && cullParticles
+				  && renderMode == RENDER_COMPUTE && collideMode == COLLIDE_OFF;
+	projected = false;
+	statsInterval = stoi(GLOBALS::config_map["STATS_FRAMES"]);
+	profileKernels = statsInterval > 0;
+	forceTime = 0.0f;
+	kernelTime = 0.0f;
+	substeps = std::max(stoi(GLOBALS::config_map["SUBSTEPS"]), 1);
+	stepsRun = 0;
+	persistentSteps = false;
+	reorderSteps = stoi(GLOBALS::config_map["REORDER_STEPS"]);
+	reorderCurve = stoi(GLOBALS::config_map["REORDER_CURVE"]);
+	stepIndex = 0;
+	reorders = 0;
+	inputTime = 0;
+	inputAge = 0.0f;
+	inputLatency = 0.0f;
+	inputFrames = 0;
+
+	if (reorderCurve != CURVE_MORTON && reorderCurve != CURVE_HILBERT) {
+		HandleFatalError(6, "Invalid reorder curve detected: "+GLOBALS::config_map["REORDER_CURVE"]);
+	}
+	statsFrames = 0;
+	frameTime = 0.0f;
+	drawTime = 0.0f;
+
+	// the render scale controller may lower the AA level but never raise it past the setting
+	maxAALevel = aa_level;
+	renderScale = 1.0f;
+	appliedScale = 1.0f;
+	minRenderScale = stoi(GLOBALS::config_map["MIN_RENDER_SCALE"]) / 100.0f;
+	frameBudget = stof(GLOBALS::config_map["FRAME_BUDGET"]);
+	scaleFrames = 0;
+	scaleTime = 0.0f;
+
+	if (minRenderScale <= 0.0f || minRenderScale > 1.0f) {
+		HandleFatalError(4, "Invalid minimum render scale detected: "+GLOBALS::config_map["MIN_RENDER_SCALE"]);
+	}
+
+	// Initialize OpenCL
+	openCL.Initialize(clOptions, profileKernels);
+
+	// Initialize graphics manager
+	gfx.Initialize(window, openCL.context(), openCL.EventFromGLsync);
+
+	// Get window resolution profile
+    //resolution = SCREEN::GetProfile(gfx.renderWidth, gfx.renderHeight);
+
+	// set camera sensitivity and position with user settings
+	camera.sensitivity = stof(GLOBALS::config_map["MOUSE_SENSI"]);
+    camera.position.x = stof(GLOBALS::config_map["CAM_X_POS"]);
+    camera.position.y = stof(GLOBALS::config_map["CAM_Y_POS"]);
+    camera.position.z = stof(GLOBALS::config_map["CAM_Z_POS"]);
+	srand(time(NULL));
+	killRand.seed(rand() ^ (uint32_t)time(NULL));
+
+	// pixel buffers are sized once for the largest render target
+	maxPixels = gfx.maxWidth * gfx.maxHeight;
+
+	rInfo.pos_count = stoi(GLOBALS::config_map["POS_PARTICLES"]);
+	rInfo.neg_count = stoi(GLOBALS::config_map["NEG_PARTICLES"]);
+	rInfo.padding = 0;
+	rInfo.rand_int = rand();
+	rInfo.jitter.s[0] = 0.0f;
+	rInfo.jitter.s[1] = 0.0f;
+	frameIndex = 0;
+	taaIndex = 0;
+
+	if (renderMode == RENDER_DENSITY) {
+		// allocate density accumulation buffer, histogram and exposure state
+		float initExpo = DENS_INIT_EXPO;
+		cl_densBuff = cl::Buffer(openCL.context, CL_MEM_READ_WRITE, sizeof(cl_uint2)*maxPixels);
+		cl_histBuff = cl::Buffer(openCL.context, CL_MEM_READ_WRITE, sizeof(cl_uint)*DENS_BINS);
+		cl_expoBuff = cl::Buffer(openCL.context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, sizeof(cl_float), &initExpo);
+	} else {
+		// allocate memory on GPU for pixel fragment buffer
+		if (aa_mode == AA_COVERAGE) {
+			cl_fragBuff = cl::Buffer(openCL.context, CL_MEM_READ_WRITE, sizeof(cl_CovFrags)*maxPixels);
+		} else if (aa_mode == AA_TEMPORAL) {
+			cl_fragBuff = cl::Buffer(openCL.context, CL_MEM_READ_WRITE, sizeof(cl_uint)*maxPixels);
+		} else {
+			// room for all 4 samples so the AA level can drop without reallocating
+			cl_fragBuff = cl::Buffer(openCL.context, CL_MEM_READ_WRITE, sizeof(cl_RGB32)*4*maxPixels);
+		}
+
+		if (aa_mode == AA_TEMPORAL) {
+			// allocate a pair of history buffers holding color and depth
+			for (int h=0; h < 2; ++h) {
+				cl_taaBuff[h] = cl::Buffer(openCL.context, CL_MEM_READ_WRITE, sizeof(cl_float4)*maxPixels);
+			}
+		}
+	}
+
+	pools[0] = &posPool;
+	pools[1] = &negPool;
+	spawnCount[0] = spawnCount[1] = 0;
+	killCount[0] = killCount[1] = 0;
+
+	if (renderMode == RENDER_SPRITES) {
+		// particle buffers are OGL vertex buffers shared with OCL
+		gfx.InitSprites();
+		posPool.Initialize(&openCL, rInfo.pos_count, false, &gfx, 0);
+		negPool.Initialize(&openCL, rInfo.neg_count, false, &gfx, 1);
+		glParticles.push_back(posPool.buffer);
+		glParticles.push_back(negPool.buffer);
+		openCL.queue.enqueueAcquireGLObjects(&glParticles);
+	} else {
+		// allocate pooled memory on GPU for each particle species
+		posPool.Initialize(&openCL, rInfo.pos_count, compactParticles);
+		negPool.Initialize(&openCL, rInfo.neg_count, compactParticles);
+	}
+	PrintLine("Particle storage: "+VarToStr(posPool.stride)+" bytes/particle ("+VarToStr(sizeof(cl_Particle))+" full, "+
+			  VarToStr(sizeof(cl_CompactParticle))+" compact)");
+
+	if (collideMode != COLLIDE_OFF) {
+		// uniform grid for finding overlapping neighbours
+		grid.Initialize(&openCL, collideMode);
+	}
+
+	uint32_t diagSteps = stoi(GLOBALS::config_map["DIAG_STEPS"]);
+	diag.interval = 0;
+	if (diagSteps > 0) {
+		// conserved quantities are reduced on the device every few steps and logged
+		diag.Initialize(&openCL, diagSteps, stoi(GLOBALS::config_map["DIAG_POTENTIAL"]) != 0);
+	}
+
+	uint32_t analysisSteps = stoi(GLOBALS::config_map["ANALYSIS_STEPS"]);
+	analysis.interval = 0;
+	if (analysisSteps > 0) {
+		// profiles, histograms and power spectra are binned on the device and logged
+		analysis.Initialize(&openCL, analysisSteps, stoi(GLOBALS::config_map["ANALYSIS_PAIRS"]) != 0);
+	}
+
+	uint32_t groupSteps = stoi(GLOBALS::config_map["FOF_STEPS"]);
+	groups.interval = 0;
+	if (groupSteps > 0) {
+		// friends-of-friends catalogues of each species are found on the device and logged
+		groups.Initialize(&openCL, groupSteps, stod(GLOBALS::config_map["FOF_LINK"]), stoi(GLOBALS::config_map["FOF_MIN_MEMBERS"]));
+	}
+
+	if (cullParticles) {
+		// allocate compact visible lists and cull counters for each species
+		for (int s=0; s < 2; ++s) {
+			visCapacity[s] = pools[s]->capacity;
+			cl_visBuff[s] = cl::Buffer(openCL.context, CL_MEM_READ_WRITE, sizeof(cl_VisParticle)*visCapacity[s]);
+			cl_cullBuff[s] = cl::Buffer(openCL.context, CL_MEM_READ_WRITE, sizeof(cl_CullStats));
+		}
+	}
+
+	// generate initial conditions, every particle is drawn independently from (seed, index)
+	uint32_t initDist[2];
+	initDist[0] = stoi(GLOBALS::config_map["INIT_POS_DIST"]);
+	initDist[1] = stoi(GLOBALS::config_map["INIT_NEG_DIST"]);
+	cl_uint initClumps = stoi(GLOBALS::config_map["INIT_CLUMPS"]);
+	cl_ulong initSeed = stoull(GLOBALS::config_map["INIT_SEED"]);
+
+	if (initSeed == 0) {
+		// no fixed seed so pick one and report it, the run can be repeated by putting it in the config
+		initSeed = ((cl_ulong)rand() << 32) ^ (cl_ulong)rand() ^ (cl_ulong)time(NULL);
+	}
+
+	Timer genTimer;
+	for (cl_char s=0; s < 2; ++s) {
+		if (initDist[s] > INIT_CLUMPS) {
+			HandleFatalError(9, "Invalid initial distribution detected: "+VarToStr(initDist[s]));
+		}
+		pools[s]->Generate(s, initDist[s], initSeed, initClumps);
+	}
+	openCL.queue.finish();
+	PrintLine("Generated "+VarToStr(posPool.count+negPool.count)+" particles in "+VarToStr(genTimer.MilliCount())+" ms (seed "+VarToStr(initSeed)+")");
+
+	if (renderMode == RENDER_SPRITES) {
+		openCL.queue.enqueueReleaseGLObjects(&glParticles);
+	}
+
+	// calc useful screen info for the starting render size
+	ApplyRenderSize();
+	openCL.queue.finish();
+
+	deltaTimer.ResetTimer();
+}
+
+Game::~Game(){}
+
+void Game::Go()
+{
+	deltaTime = deltaTimer.MilliCount();
+	deltaTimer.ResetTimer();
+	ComposeFrame();
+	gfx.DisplayFrame();
+
+	if (inputTime != 0) {
+		// the swap has returned so the frame that used this input is on its way to the display
+		inputLatency += (Timer::Now() - inputTime) * 1e-6f;
+		inputFrames++;
+		inputTime = 0;
+	}
+
+	frameTime += deltaTime;
+	if (statsInterval > 0 && ++statsFrames >= statsInterval) {
+		PrintStats();
+	}
+
+	// follow window resizes, ignoring a minimized window
+	int newWidth, newHeight;
+	gfx.GetWindowSize(&newWidth, &newHeight);
+	if (newWidth > 0 && newHeight > 0 && (newWidth != gfx.windowWidth || newHeight != gfx.windowHeight)) {
+		gfx.SetWindowSize(newWidth, newHeight);
+		ApplyRenderSize();
+	}
+
+	if (frameBudget > 0.0f) {
+		UpdateRenderScale();
+	}
+}
+
+bool Game::SelectAALevel(int32_t level)
+{
+	switch (level) {
+		case 1: aaInfo = GLOBALS::AA_X1; break;
+		case 4: aaInfo = GLOBALS::AA_X4; break;
+		case 9: aaInfo = GLOBALS::AA_X9; break;
+		case 16: aaInfo = GLOBALS::AA_X16; break;
+		default: return false;
+	}
+	aa_level = level;
+	return true;
+}
+
+void Game::UpdateRenderScale()
+{
+	static const int32_t aaLevels[] = { 1, 4, 9, 16 };
+	int32_t aaIndex = 0;
+	while (aaLevels[aaIndex] != aa_level) { ++aaIndex; }
+
+	// judge the average frame time over a window of frames
+	scaleTime += deltaTime;
+	if (++scaleFrames < SCALE_FRAMES) return;
+
+	float avgTime = scaleTime / scaleFrames;
+	scaleFrames = 0;
+	scaleTime = 0.0f;
+
+	if (avgTime > frameBudget) {
+		// shed AA samples first, then pixels
+		if (aa_level > 1) {
+			SelectAALevel(aaLevels[aaIndex-1]);
+		} else if (renderScale > minRenderScale) {
+			renderScale = std::max(renderScale - SCALE_STEP, minRenderScale);
+		} else {
+			return;
+		}
+	} else if (avgTime < frameBudget * SCALE_HEADROOM) {
+		// win back pixels first, then AA samples
+		if (renderScale < 1.0f) {
+			renderScale = std::min(renderScale + SCALE_STEP, 1.0f);
+		} else if (aa_level < maxAALevel) {
+			SelectAALevel(aaLevels[aaIndex+1]);
+		} else {
+			return;
+		}
+	} else {
+		return;
+	}
+
+	ApplyRenderSize();
+}
+
+void Game::ApplyRenderSize()
+{
+	// render at a fraction of the window and let the final blit upscale it, a window bigger than
+	// the render targets shrinks both axes together so the aspect and field of view are kept
+	appliedScale = std::min(renderScale, std::min(gfx.maxWidth / (float)gfx.windowWidth, gfx.maxHeight / (float)gfx.windowHeight));
+	int width = std::max(1, std::min((int)(gfx.windowWidth * appliedScale), gfx.maxWidth));
+	int height = std::max(1, std::min((int)(gfx.windowHeight * appliedScale), gfx.maxHeight));
+	gfx.SetRenderSize(width, height);
+
+	widthHalf = width / 2;
+	heightHalf = height / 2;
+	widthRays = width * aaInfo.lvl;
+	heightRays = height * aaInfo.lvl;
+	widthSpan = width - 1;
+	heightSpan = height - 1;
+	pixCount = width * height;
+	fragCount = pixCount * aaInfo.lvl;
+
+	rInfo.aa_info = aaInfo;
+	rInfo.span_X = widthSpan;
+	rInfo.span_Y = heightSpan;
+	rInfo.pixels_X = width;
+	rInfo.pixels_Y = height;
+	rInfo.half_X = widthHalf;
+	rInfo.half_Y = heightHalf;
+
+	if (aa_mode == AA_TEMPORAL && renderMode != RENDER_DENSITY) {
+		// old history no longer lines up with the pixels so start again
+		cl_float4 clearHist = {{0.0f, 0.0f, 0.0f, 0.0f}};
+		for (int h=0; h < 2; ++h) {
+			openCL.queue.enqueueFillBuffer(cl_taaBuff[h], clearHist, 0, sizeof(cl_float4)*pixCount);
+		}
+		frameIndex = 0;
+	}
+}
+
+void Game::EditParticles()
+{
+	for (int s=0; s < 2; ++s) {
+		if (spawnCount[s] > 0) {
+			pools[s]->Insert(EmitParticles(s, spawnCount[s]));
+			spawnCount[s] = 0;
+		}
+
+		if (killCount[s] > 0) {
+			// partial shuffle picks distinct random particles, the pool compacts the gaps
+			uint32_t kills = std::min(killCount[s], pools[s]->count);
+			std::vector<uint32_t> victims(pools[s]->count);
+			std::iota(victims.begin(), victims.end(), 0);
+			for (uint32_t i=0; i < kills; ++i) {
+				std::uniform_int_distribution<uint32_t> pick(i, victims.size() - 1);
+				std::swap(victims[i], victims[pick(killRand)]);
+			}
+			victims.resize(kills);
+			pools[s]->Remove(victims);
+			killCount[s] = 0;
+		}
+
+		// scratch lists only need to follow the pool capacity
+		if (cullParticles && visCapacity[s] < pools[s]->capacity) {
+			visCapacity[s] = pools[s]->capacity;
+			cl_visBuff[s] = cl::Buffer(openCL.context, CL_MEM_READ_WRITE, sizeof(cl_VisParticle)*visCapacity[s]);
+		}
+	}
+
+	rInfo.pos_count = posPool.count;
+	rInfo.neg_count = negPool.count;
+}
+
+std::vector<cl_Particle> Game::EmitParticles(int species, uint32_t amount)
+{
+	std::vector<cl_Particle> particles(amount);
+	DVec3 origin = camera.position.VectAdd(camera.forward * EMIT_DIST);
+
+	// scatter new particles at rest in a cube in front of the camera
+	for (uint32_t i=0; i < amount; ++i) {
+		cl_Particle& prtcl = particles[i];
+		DVec3 offset((rand() / (double)RAND_MAX - 0.5) * EMIT_SPREAD,
+					 (rand() / (double)RAND_MAX - 0.5) * EMIT_SPREAD,
+					 (rand() / (double)RAND_MAX - 0.5) * EMIT_SPREAD);
+		prtcl.position = origin.VectAdd(offset).vector;
+
+		// wrap into the periodic simulation box
+		for (int d=0; d < 3; ++d) {
+			double coord = fmod(prtcl.position.s[d] - SIM_POS_MIN, SIM_POS_MOD);
+			prtcl.position.s[d] = SIM_POS_MIN + ((coord < 0.0) ? coord + SIM_POS_MOD : coord);
+		}
+
+		prtcl.new_pos = prtcl.position;
+		prtcl.velocity = DV3_V0.vector;
+		prtcl.mass = (rand() % SIM_MASS_MOD) + SIM_MASS_MIN;
+		prtcl.radius = sqrt(prtcl.mass / PI);
+		if (species == 1) prtcl.mass = -prtcl.mass;
+	}
+
+	return particles;
+}
+
+cl::Event* Game::ProfileEvent(std::vector<cl::Event>& events)
+{
+	if (!profileKernels) return NULL;
+	events.push_back(cl::Event());
+	return &events.back();
+}
+
+void Game::SumKernelTimes()
+{
+	// the events have to finish before their times can be read
+	openCL.queue.finish();
+
+	for (size_t i=0; i < forceEvents.size(); ++i) {
+		forceTime += openCL.EventTime(forceEvents[i]);
+	}
+	for (size_t i=0; i < drawEvents.size(); ++i) {
+		kernelTime += openCL.EventTime(drawEvents[i]);
+	}
+
+	forceEvents.clear();
+	drawEvents.clear();
+}
+
+void Game::PrintStats()
+{
+	std::stringstream stats;
+	SumKernelTimes();
+	stats << "Particles: " << posPool.count << " + " << negPool.count;
+	if (collideMode == COLLIDE_MERGE) {
+		stats << " | Merges: " << grid.merges;
+		grid.merges = 0;
+	}
+	stats << " | Render mode: " << ((renderMode == RENDER_SPRITES) ? "sprites" :
+								  (renderMode == RENDER_DENSITY) ? "density" : "compute");
+	stats << " | Frame: " << (frameTime / statsFrames) << " ms";
+	stats << " | Draw: " << (drawTime / statsFrames) << " ms";
+	stats << " | Render: " << gfx.renderWidth << "x" << gfx.renderHeight << " AA x" << aa_level;
+	stats << " | Sync wait: " << (gfx.syncTime / statsFrames) << " ms";
+	stats << "\nForce kernel: " << (forceTime / statsFrames) << " ms";
+	if (substeps > 1) {
+		stats << " | Steps/s: " << (stepsRun * 1000.0f / frameTime) << (persistentSteps ? " (persistent)" : " (batched)");
+	}
+	stats << " | Draw kernels: " << (kernelTime / statsFrames) << " ms";
+	if (diag.interval > 0) {
+		stats << " | Energy drift: " << diag.energyDrift;
+	}
+	if (groups.interval > 0) {
+		stats << " | Groups: " << groups.groupCount[0] << "/" << groups.groupCount[1];
+		stats << " (largest " << groups.largest[0] << "/" << groups.largest[1] << ") in " << groups.findTime << " ms";
+	}
+	if (reorderSteps > 0) {
+		stats << " | Reorders: " << reorders << ((reorderCurve == CURVE_HILBERT) ? " (hilbert)" : " (morton)");
+	}
+	if (inputFrames > 0) {
+		stats << "\nInput age: " << (inputAge / inputFrames) << " ms";
+		stats << " | Input to present: " << (inputLatency / inputFrames) << " ms";
+		stats << " (" << inputFrames << " frames)";
+	}
+
+	if (cullParticles && renderMode == RENDER_COMPUTE) {
+		for (int s=0; s < 2; ++s) {
+			stats << ((s == 0) ? "\nPositive" : "\nNegative");
+			stats << " visible: " << (cullStats[s].points + cullStats[s].discs);
+			stats << " (points " << cullStats[s].points << ", discs " << cullStats[s].discs << ")";
+			stats << " | culled: " << (cullStats[s].behind + cullStats[s].offscreen);
+			stats << " (behind " << cullStats[s].behind << ", offscreen " << cullStats[s].offscreen << ")";
+		}
+	}
+
+	PrintLine(stats);
+
+	statsFrames = 0;
+	frameTime = 0.0f;
+	drawTime = 0.0f;
+	gfx.syncTime = 0.0f;
+	forceTime = 0.0f;
+	kernelTime = 0.0f;
+	reorders = 0;
+	inputAge = 0.0f;
+	inputLatency = 0.0f;
+	inputFrames = 0;
+	stepsRun = 0;
+}
+
+void Game::HandleInput()
+{
+	// keys for left and right tilt
+	if (kbd.KeyIsPressed(GLFW_KEY_E)) {
+		camera.orientation.z -= CAMSPIN_SPEED * deltaTime;
+	} else if (kbd.KeyIsPressed(GLFW_KEY_Q)) {
+		camera.orientation.z += CAMSPIN_SPEED * deltaTime;
+	}
+
+	// sample input now, after any wait on earlier frames, so the camera uses the freshest state
+	glfwPollEvents();
+	int64_t sampleTime = Timer::Now();
+	int64_t oldestEvent = sampleTime;
+
+	// drain every pending key event so none spill into later frames
+	for (KeyEvent ke = kbd.ReadKey(); ke.IsValid(); ke = kbd.ReadKey()) {
+		oldestEvent = std::min(oldestEvent, ke.GetTime());
+		if (!ke.IsPress()) continue;
+		switch (ke.GetCode()) {
+		case GLFW_KEY_SCROLL_LOCK:
+			gfx.ToggleCursorLock();
+			break;
+		case GLFW_KEY_INSERT:
+			// shift selects the negative species
+			spawnCount[kbd.KeyIsPressed(GLFW_KEY_LEFT_SHIFT) ? 1 : 0] += EMIT_COUNT;
+			break;
+		case GLFW_KEY_DELETE:
+			killCount[kbd.KeyIsPressed(GLFW_KEY_LEFT_SHIFT) ? 1 : 0] += EMIT_COUNT;
+			break;
+		default: break;
+		}
+	}
+
+	// drain mouse events, coalescing moves into one delta and summing wheel steps
+	bool moved = false;
+	float moveX = 0.0f, moveY = 0.0f;
+	int32_t wheelSteps = 0;
+	for (MouseEvent me = mouse.ReadMouse(); me.IsValid(); me = mouse.ReadMouse()) {
+		oldestEvent = std::min(oldestEvent, me.GetTime());
+		switch (me.GetType()) {
+		case MouseEvent::Move:
+			// the cursor is recentred once per frame so the last position is the summed motion
+			moveX = me.GetX();
+			moveY = me.GetY();
+			moved = true;
+			break;
+		case MouseEvent::WheelUp:
+			wheelSteps++;
+			break;
+		case MouseEvent::WheelDown:
+			wheelSteps--;
+			break;
+		default: break;
+		}
+	}
+
+	if (moved && gfx.cursorLocked) {
+		dX = moveX * camera.sensitivity * deltaTime;
+		dY = moveY * camera.sensitivity * deltaTime;
+		camera.orientation.x += dY;
+		camera.orientation.y -= dX;
+		glfwSetCursorPos(gfx.window, 0.0, 0.0);
+	}
+	camera.foclen += 10 * wheelSteps;
+
+	if (oldestEvent < sampleTime) {
+		// remembered until the frame is presented to time input to photon
+		inputTime = oldestEvent;
+		inputAge += (sampleTime - oldestEvent) * 1e-6f;
+	}
+
+	// update camera direction
+	camera.UpdateDirection();
+
+	// keys for up and down movement
+	if (kbd.KeyIsPressed(GLFW_KEY_PAGE_UP)) {
+		camera.position += camera.up * (CAMMOVE_SPEED * deltaTime);
+	} else if (kbd.KeyIsPressed(GLFW_KEY_PAGE_DOWN)) {
+		camera.position -= camera.up * (CAMMOVE_SPEED * deltaTime);
+	}
+
+	// keys for forward and backward movement
+	if (kbd.KeyIsPressed(GLFW_KEY_W)) {
+		camera.position += camera.forward * (CAMMOVE_SPEED * deltaTime);
+	} else if (kbd.KeyIsPressed(GLFW_KEY_S)) {
+		camera.position -= camera.forward * (CAMMOVE_SPEED * deltaTime);
+	}
+
+	// keys for right and left movement
+	if (kbd.KeyIsPressed(GLFW_KEY_D)) {
+		camera.position += camera.right * (CAMMOVE_SPEED * deltaTime);
+	} else if (kbd.KeyIsPressed(GLFW_KEY_A)) {
+		camera.position -= camera.right * (CAMMOVE_SPEED * deltaTime);
+	}
+}
+
+void Game::BeginActions()
+{
+	// calculate bottom left position of virtual screen
+	camera.bl_ray = (camera.forward * (camera.foclen * appliedScale)).
+					VectSub(camera.right * widthHalf).
+					VectSub(camera.up * heightHalf);
+
+	// keep last frame's camera for reprojection
+	prevCamInfo = rInfo.cam_info;
+
+	// save data to RenderInfo structure
+	rInfo.cam_info = camera.GetInfo();
+	rInfo.cam_info.cam_foc *= appliedScale;
+
+	// one view-projection per frame replaces the per-particle rotation in the draw kernels
+	DMat4 viewProj = camera.ViewProj(rInfo.cam_info.cam_foc, rInfo.half_X, rInfo.half_Y);
+	viewProj.ToRows(rInfo.view_proj);
+	viewProj.ToFloatRows(rInfo.view_rot);
+
+	if (frameIndex++ == 0) {
+		prevCamInfo = rInfo.cam_info;
+	}
+
+	rInfo.rand_int = rand();
+	rInfo.d_time = deltaTime;
+
+	if (aa_mode == AA_TEMPORAL) {
+		rInfo.jitter.s[0] = Halton(frameIndex % TAA_JITTER_FRAMES + 1, 2);
+		rInfo.jitter.s[1] = Halton(frameIndex % TAA_JITTER_FRAMES + 1, 3);
+	}
+
+	// sprites are drawn by OGL so there is no frag buffer to clear
+	if (renderMode == RENDER_SPRITES) return;
+
+	if (renderMode == RENDER_DENSITY) {
+		openCL.FillD_Kernel.setArg(0, cl_densBuff);
+		openCL.FillD_Kernel.setArg(1, cl_histBuff);
+		openCL.FillD_Kernel.setArg(2, rInfo);
+
+		openCL.FillDensBuff(gfx.renderWidth, gfx.renderHeight);
+		return;
+	}
+
+	openCL.FillF_Kernel.setArg(0, cl_fragBuff);
+	openCL.FillF_Kernel.setArg(1, rInfo);
+
+	openCL.FillFragBuff(gfx.renderWidth, gfx.renderHeight);
+}
+
+void Game::ComputeStage1()
+{
+	if (diag.interval > 0) {
+		// sample before the update so positions and velocities belong to the same step
+		diag.Sample(posPool, negPool);
+	}
+
+	if (analysis.interval > 0) {
+		analysis.Sample(posPool, negPool);
+	}
+
+	if (groups.interval > 0) {
+		groups.Sample(posPool, negPool);
+	}
+
+	if (reorderSteps > 0 && ++stepIndex >= reorderSteps) {
+		// restore spatial locality lost as the particles drift
+		posPool.Reorder(reorderCurve);
+		negPool.Reorder(reorderCurve);
+		stepIndex = 0;
+		reorders++;
+	}
+
+    // update particle positions
+
+	uint32_t updateCount = std::max(posPool.count, negPool.count);
+	size_t localBytes = (sizeof(cl_double4) + sizeof(cl_float2)) * (posPool.count + negPool.count);
+
+	if (substeps > 1 && updateCount <= openCL.substep_wg_size && localBytes <= openCL.local_mem_size) {
+		// small sets run every substep inside one launch with the particles in local memory
+		uint32_t groupSize = std::min(((updateCount + 63) / 64) * 64, openCL.substep_wg_size);
+		openCL.Substep_Kernel.setArg(0, posPool.buffer);
+		openCL.Substep_Kernel.setArg(1, negPool.buffer);
+		openCL.Substep_Kernel.setArg(2, rInfo);
+		openCL.Substep_Kernel.setArg(3, (cl_uint)substeps);
+		openCL.Substep_Kernel.setArg(4, cl::Local(sizeof(cl_double4) * std::max(posPool.count, 1u)));
+		openCL.Substep_Kernel.setArg(5, cl::Local(sizeof(cl_float2) * std::max(posPool.count, 1u)));
+		openCL.Substep_Kernel.setArg(6, cl::Local(sizeof(cl_double4) * std::max(negPool.count, 1u)));
+		openCL.Substep_Kernel.setArg(7, cl::Local(sizeof(cl_float2) * std::max(negPool.count, 1u)));
+		openCL.UpdateSubsteps(groupSize, ProfileEvent(forceEvents));
+		persistentSteps = true;
+	} else {
+		// larger sets queue the substeps back to back, committing between them, with no host wait
+		openCL.Update_Kernel.setArg(0, posPool.buffer);
+		openCL.Update_Kernel.setArg(1, negPool.buffer);
+		openCL.Update_Kernel.setArg(2, rInfo);
+
+		for (uint32_t s=0; s < substeps; ++s) {
+			if (s > 0) {
+				openCL.Commit_Kernel.setArg(0, posPool.buffer);
+				openCL.CommitParticles(posPool.count);
+				openCL.Commit_Kernel.setArg(0, negPool.buffer);
+				openCL.CommitParticles(negPool.count);
+			}
+			if (fuseProject && s+1 == substeps) {
+				UpdateAndProject(updateCount);
+			} else {
+				openCL.UpdateParticles(updateCount, ProfileEvent(forceEvents));
+			}
+		}
+		persistentSteps = false;
+	}
+	stepsRun += substeps;
+
+	if (collideMode != COLLIDE_OFF) {
+		// resolve overlaps left by the update, merging may shrink the pools
+		grid.Collide(posPool, negPool);
+		rInfo.pos_count = posPool.count;
+		rInfo.neg_count = negPool.count;
+	}
+
+	if (renderMode == RENDER_SPRITES) {
+		// no draw kernel will commit the new positions
+		openCL.Commit_Kernel.setArg(0, posPool.buffer);
+		openCL.CommitParticles(posPool.count);
+		openCL.Commit_Kernel.setArg(0, negPool.buffer);
+		openCL.CommitParticles(negPool.count);
+	}
+}
+
+void Game::ComputeStage2()
+{
+	// compute final pixel colors
+
+	if (renderMode == RENDER_DENSITY) {
+		SplatDensity();
+		return;
+	}
+
+	if (cullParticles) {
+		CullAndDraw();
+		return;
+	}
+
+	openCL.Draw_Kernel.setArg(0, posPool.buffer);
+	openCL.Draw_Kernel.setArg(1, cl_fragBuff);
+	openCL.Draw_Kernel.setArg(2, YELLOW.rgba);
+	openCL.Draw_Kernel.setArg(3, rInfo);
+	openCL.DrawParticles(posPool.count, ProfileEvent(drawEvents));
+
+	openCL.Draw_Kernel.setArg(0, negPool.buffer);
+	openCL.Draw_Kernel.setArg(1, cl_fragBuff);
+	openCL.Draw_Kernel.setArg(2, BLUE.rgba);
+	openCL.Draw_Kernel.setArg(3, rInfo);
+	openCL.DrawParticles(negPool.count, ProfileEvent(drawEvents));
+}
+
+void Game::UpdateAndProject(uint32_t updateCount)
+{
+	static const cl_CullStats clearStats = {0, 0, 0, 0};
+
+	// the last step of the frame also projects and compacts, so drawing skips the particle buffers
+	for (int s=0; s < 2; ++s) {
+		openCL.queue.enqueueWriteBuffer(cl_cullBuff[s], CL_FALSE, 0, sizeof(cl_CullStats), &clearStats);
+	}
+	openCL.Fused_Kernel.setArg(0, posPool.buffer);
+	openCL.Fused_Kernel.setArg(1, negPool.buffer);
+	openCL.Fused_Kernel.setArg(2, cl_visBuff[0]);
+	openCL.Fused_Kernel.setArg(3, cl_visBuff[1]);
+	openCL.Fused_Kernel.setArg(4, cl_cullBuff[0]);
+	openCL.Fused_Kernel.setArg(5, cl_cullBuff[1]);
+	openCL.Fused_Kernel.setArg(6, rInfo);
+	openCL.UpdateAndProject(updateCount, ProfileEvent(forceEvents));
+
+	// only the position field is touched to commit, nothing reads the rest of the particle again
+	for (int s=0; s < 2; ++s) {
+		openCL.Commit_Kernel.setArg(0, pools[s]->buffer);
+		openCL.CommitParticles(pools[s]->count);
+	}
+	projected = true;
+}
+
+void Game::CullAndDraw()
+{
+	static const cl_CullStats clearStats = {0, 0, 0, 0};
+	const cl_RGB32 colors[2] = { YELLOW.rgba, BLUE.rgba };
+
+	// cull and compact both species, unless the update already did, then read back the class counts
+	for (int s=0; s < 2; ++s) {
+		if (!projected) {
+			openCL.queue.enqueueWriteBuffer(cl_cullBuff[s], CL_FALSE, 0, sizeof(cl_CullStats), &clearStats);
+			openCL.Cull_Kernel.setArg(0, pools[s]->buffer);
+			openCL.Cull_Kernel.setArg(1, cl_visBuff[s]);
+			openCL.Cull_Kernel.setArg(2, cl_cullBuff[s]);
+			openCL.Cull_Kernel.setArg(3, (cl_uint)pools[s]->count);
+			openCL.Cull_Kernel.setArg(4, rInfo);
+			openCL.CullParticles(pools[s]->count, ProfileEvent(drawEvents));
+		}
+		openCL.queue.enqueueReadBuffer(cl_cullBuff[s], CL_FALSE, 0, sizeof(cl_CullStats), &cullStats[s]);
+	}
+	projected = false;
+
+	openCL.queue.finish();
+
+	// draw only the survivors, points from the front and discs from the back
+	for (int s=0; s < 2; ++s) {
+		openCL.DrawV_Kernel.setArg(0, cl_visBuff[s]);
+		openCL.DrawV_Kernel.setArg(1, cl_fragBuff);
+		openCL.DrawV_Kernel.setArg(2, colors[s]);
+		openCL.DrawV_Kernel.setArg(3, rInfo);
+
+		if (cullStats[s].points > 0) {
+			openCL.DrawVisible(0, cullStats[s].points, ProfileEvent(drawEvents));
+		}
+		if (cullStats[s].discs > 0) {
+			openCL.DrawVisible(pools[s]->count - cullStats[s].discs, cullStats[s].discs, ProfileEvent(drawEvents));
+		}
+	}
+}
+
+void Game::SplatDensity()
+{
+	// accumulate each species into its own density channel
+
+	openCL.Splat_Kernel.setArg(0, posPool.buffer);
+	openCL.Splat_Kernel.setArg(1, cl_densBuff);
+	openCL.Splat_Kernel.setArg(2, (cl_uint)0);
+	openCL.Splat_Kernel.setArg(3, rInfo);
+	openCL.SplatParticles(posPool.count, ProfileEvent(drawEvents));
+
+	openCL.Splat_Kernel.setArg(0, negPool.buffer);
+	openCL.Splat_Kernel.setArg(1, cl_densBuff);
+	openCL.Splat_Kernel.setArg(2, (cl_uint)1);
+	openCL.Splat_Kernel.setArg(3, rInfo);
+	openCL.SplatParticles(negPool.count, ProfileEvent(drawEvents));
+}
+
+void Game::ResolveDensity()
+{
+	// build log density histogram and adapt exposure on the device
+
+	openCL.Hist_Kernel.setArg(0, cl_densBuff);
+	openCL.Hist_Kernel.setArg(1, cl_histBuff);
+	openCL.Hist_Kernel.setArg(2, rInfo);
+	openCL.DensityHistogram(gfx.renderWidth, gfx.renderHeight);
+
+	openCL.Expo_Kernel.setArg(0, cl_histBuff);
+	openCL.Expo_Kernel.setArg(1, cl_expoBuff);
+	openCL.DensityExposure();
+
+	// tone map density buffer to frame buffer
+
+	openCL.CopyD_Kernel.setArg(0, cl_densBuff);
+	openCL.CopyD_Kernel.setArg(1, cl_expoBuff);
+	openCL.CopyD_Kernel.setArg(2, gfx.gl_backBuff);
+	openCL.CopyD_Kernel.setArg(3, YELLOW.rgba);
+	openCL.CopyD_Kernel.setArg(4, BLUE.rgba);
+	openCL.CopyD_Kernel.setArg(5, rInfo);
+	openCL.DensityToFrame(gfx.renderWidth, gfx.renderHeight);
+}
+
+void Game::ComputeStage3()
+{
+	// write frag buffer to frame buffer
+
+	if (renderMode == RENDER_DENSITY) {
+		ResolveDensity();
+		return;
+	}
+
+	if (aa_mode == AA_TEMPORAL) {
+		// blend with reprojected history, ping-ponging the history buffers
+		openCL.TAA_Kernel.setArg(0, cl_fragBuff);
+		openCL.TAA_Kernel.setArg(1, cl_taaBuff[taaIndex]);
+		openCL.TAA_Kernel.setArg(2, cl_taaBuff[1-taaIndex]);
+		openCL.TAA_Kernel.setArg(3, gfx.gl_backBuff);
+		openCL.TAA_Kernel.setArg(4, prevCamInfo);
+		openCL.TAA_Kernel.setArg(5, rInfo);
+
+		openCL.TemporalResolve(gfx.renderWidth, gfx.renderHeight);
+		taaIndex = 1 - taaIndex;
+		return;
+	}
+
+	openCL.CopyF_Kernel.setArg(0, cl_fragBuff);
+	openCL.CopyF_Kernel.setArg(1, gfx.gl_backBuff);
+	openCL.CopyF_Kernel.setArg(2, rInfo);
+
+	openCL.FragsToFrame(gfx.renderWidth, gfx.renderHeight);
+}
+
+void Game::RenderScene()
+{
+	// update particles
+	ComputeStage1();
+
+	drawTimer.ResetTimer();
+
+	// draw particles
+	ComputeStage2();
+
+	// write frame
+	ComputeStage3();
+
+	drawTime += drawTimer.MilliCount();
+}
+
+void Game::RenderSprites()
+{
+	drawTimer.ResetTimer();
+
+	// draw particles as instanced OGL sprites
+	gfx.BeginSprites(rInfo.cam_info);
+	gfx.DrawSprites(0, posPool.count, YELLOW.rgba);
+	gfx.DrawSprites(1, negPool.count, BLUE.rgba);
+	gfx.EndSprites();
+
+	drawTime += drawTimer.MilliCount();
+}
+
+void Game::ComposeFrame()
+{
+	// block on the frame ring before sampling input rather than after it
+	if (renderMode != RENDER_SPRITES) {
+		gfx.WaitForSlot();
+	}
+
+	// handle keyboard/mouse actions
+	HandleInput();
+
+	// reset/update some stuff
+	BeginActions();
+
+	if (renderMode == RENDER_SPRITES) {
+		// grow the shared pools while OGL still owns them
+		posPool.Reserve(posPool.count + spawnCount[0]);
+		negPool.Reserve(negPool.count + spawnCount[1]);
+		glParticles[0] = posPool.buffer;
+		glParticles[1] = negPool.buffer;
+
+		// give OCL control of the shared particle buffers once OGL's last draw from them is done
+		gfx.AcquireSprites(openCL.queue(), glParticles);
+
+		// add and remove particles
+		EditParticles();
+
+		// update particles using OCL
+		ComputeStage1();
+
+		// hand the particle buffers back to OGL, the draw waits on the release rather than the CPU
+		gfx.ReleaseSprites(openCL.queue(), glParticles);
+
+		// draw the particles using OGL
+		RenderSprites();
+		return;
+	}
+
+	// add and remove particles
+	EditParticles();
+
+	// give OCL control of OGL framebuffer
+	gfx.AcquireBackBuff(openCL.queue());
+
+	// render the 3D scene using OCL
+	RenderScene();
+
+	// make OCL release control of OGL memory
+	gfx.ReleaseBackBuff(openCL.queue());
+}
@@ -1,58 +1,133 @@
-#pragma once
-#include "GLGraphics.h"
-#include "CLTypes.h"
-#include "Keyboard.h"
-#include "Mouse.h"
-#include "Timer.h"
-#include "Camera.h"
-
-class Game
-{
-public:
-	Game(GLFWwindow* window, KeyboardServer& kServer, MouseServer& mServer);
-	~Game();
-	void Go();
-	void ComputeStage1();
-	void ComputeStage2();
-	void ComputeStage3();
-private:
-	void RenderScene();
-	void HandleInput();
-	void BeginActions();
-	void ComposeFrame();
-private:
-	KeyboardClient kbd;
-	MouseClient mouse;
-	GLGraphics gfx;
-
-	CL openCL;
-	cl_int cl_error;
-	cl_RenderInfo rInfo;
-
-	cl::Buffer cl_posBuff;
-	cl::Buffer cl_negBuff;
-	cl::Buffer cl_fragBuff;
-
-	//Scene scene;
-	Camera camera;
-	cl_AAInfo aaInfo;
-	//SCREEN::Resolution resolution;
-
-	int32_t aa_level;
-	uint32_t pixCount, fragCount;
-	uint32_t heightSpan, widthSpan;
-	uint32_t heightRays, widthRays;
-	uint32_t heightHalf, widthHalf;
-	float dX, dY;
-
-	float deltaTime;
-	Timer deltaTimer;
-};
-
-namespace GLOBALS {
-
-	static const cl_AAInfo AA_X1  {1,   1,   1.0,   1.0};
-	static const cl_AAInfo AA_X4  {4,   2,   0.5,   0.25};
-	static const cl_AAInfo AA_X9  {9,   3,   1./3,  1./6};
-	static const cl_AAInfo AA_X16 {16,  4,   0.25,  0.125};
-}
+#pragma once
+#include "GLGraphics.h"
+#include "ParticlePool.h"
+#include "SpatialGrid.h"
+#include "Diagnostics.h"
+#include "Analysis.h"
+#include "GroupFinder.h"
+#include "CLTypes.h"
+#include "Keyboard.h"
+#include "Mouse.h"
+#include "Timer.h"
+#include "Camera.h"
+#include <random>
+
+class Game
+{
+public:
+	Game(GLFWwindow* window, KeyboardServer& kServer, MouseServer& mServer);
+	~Game();
+	void Go();
+	void ComputeStage1();
+	void ComputeStage2();
+	void ComputeStage3();
+	void CullAndDraw();
+	void UpdateAndProject(uint32_t updateCount);
+	void SplatDensity();
+	void ResolveDensity();
+private:
+	void RenderScene();
+	void HandleInput();
+	void BeginActions();
+	void ComposeFrame();
+	void RenderSprites();
+	void PrintStats();
+	void SumKernelTimes();
+	cl::Event* ProfileEvent(std::vector<cl::Event>& events);
+	void EditParticles();
+	std::vector<cl_Particle> EmitParticles(int species, uint32_t amount);
+	bool SelectAALevel(int32_t level);
+	void UpdateRenderScale();
+	void ApplyRenderSize();
+private:
+	KeyboardClient kbd;
+	MouseClient mouse;
+	GLGraphics gfx;
+
+	CL openCL;
+	std::string clOptions;
+	cl_int cl_error;
+	cl_RenderInfo rInfo;
+
+	ParticlePool posPool;
+	ParticlePool negPool;
+	ParticlePool* pools[2];
+	SpatialGrid grid;
+	Diagnostics diag;
+	Analysis analysis;
+	GroupFinder groups;
+	uint32_t spawnCount[2];
+	uint32_t killCount[2];
+	std::mt19937 killRand;
+	cl::Buffer cl_fragBuff;
+	std::vector<cl::Memory> glParticles;
+	cl::Buffer cl_visBuff[2];
+	uint32_t visCapacity[2];
+	cl::Buffer cl_cullBuff[2];
+	cl_CullStats cullStats[2];
+	cl::Buffer cl_densBuff;
+	cl::Buffer cl_histBuff;
+	cl::Buffer cl_expoBuff;
+	cl::Buffer cl_taaBuff[2];
+	cl_CamInfo prevCamInfo;
+	uint32_t taaIndex;
+	uint32_t frameIndex;
+
+	//Scene scene;
+	Camera camera;
+	cl_AAInfo aaInfo;
+	//SCREEN::Resolution resolution;
+
+	int32_t aa_level;
+	int32_t maxAALevel;
+	int32_t aa_mode;
+	int32_t renderMode;
+	bool cullParticles;
+	bool fuseProject;
+	bool compactParticles;
+	bool projected;
+	int32_t collideMode;
+	uint32_t pixCount, fragCount, maxPixels;
+	uint32_t heightSpan, widthSpan;
+	uint32_t heightRays, widthRays;
+	uint32_t heightHalf, widthHalf;
+	float dX, dY;
+
+	float deltaTime;
+	Timer deltaTimer;
+
+	uint32_t statsInterval, statsFrames;
+	float frameTime, drawTime;
+	Timer drawTimer;
+
+	bool profileKernels;
+	std::vector<cl::Event> forceEvents;
+	std::vector<cl::Event> drawEvents;
+	float forceTime, kernelTime;
+
+	int64_t inputTime;
+	float inputAge, inputLatency;
+	uint32_t inputFrames;
+
+	uint32_t substeps;
+	uint32_t stepsRun;
+	bool persistentSteps;
+
+	int32_t reorderSteps;
+	cl_uint reorderCurve;
+	int32_t stepIndex;
+	uint32_t reorders;
+
+	float renderScale, minRenderScale;
+	float appliedScale;
+	float frameBudget, scaleTime;
+	uint32_t scaleFrames;
+};
+
+namespace GLOBALS {
+
+	static const cl_AAInfo AA_X1  {1,   1,   1.0,   1.0};
+	static const cl_AAInfo AA_X4  {4,   2,   0.5,   0.25};
+	static const cl_AAInfo AA_X9  {9,   3,   1./3,  1./9};
+	static const cl_AAInfo AA_X16 {16,  4,   0.25,  0.0625};
+}
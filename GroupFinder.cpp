@@ -0,0 +1,149 @@
+#include "GroupFinder.h"
+#include "Timer.h"
+#include <algorithm>
+#include <cmath>
+
+void GroupFinder::Initialize(CL* pOpenCL, uint32_t sampleSteps, double linkFactor, uint32_t minGroupSize)
+{
+	openCL = pOpenCL;
+	interval = sampleSteps;
+	linking = linkFactor;
+	minMembers = std::max(minGroupSize, (uint32_t)2);
+	groupCount[0] = groupCount[1] = 0;
+	largest[0] = largest[1] = 0;
+	findTime = 0.0f;
+	capacity = 0;
+	step = 0;
+
+	gridInfo = cl::Buffer(openCL->context, CL_MEM_READ_WRITE, sizeof(cl_GridInfo));
+	cellRange = cl::Buffer(openCL->context, CL_MEM_READ_WRITE, sizeof(cl_uint2)*GRID_MAX_DIM*GRID_MAX_DIM*GRID_MAX_DIM);
+
+	logFile.open(GLOBALS::DATA_FOLDER+GROUPS_LOG);
+	if (!logFile.is_open()) {
+		HandleFatalError(7, "Unable to open group log: "+GLOBALS::DATA_FOLDER+GROUPS_LOG);
+	}
+	logFile.precision(12);
+	logFile << "step,species,rank,members,mass,x,y,z,vx,vy,vz,sigma_v\n";
+}
+
+void GroupFinder::Reserve(uint32_t count)
+{
+	if (count <= capacity) return;
+	capacity = std::max(count, capacity * POOL_GROWTH);
+	uint32_t maxGroups = capacity / minMembers + 1;
+
+	cellKeys = cl::Buffer(openCL->context, CL_MEM_READ_WRITE, sizeof(cl_uint)*capacity);
+	cellVals = cl::Buffer(openCL->context, CL_MEM_READ_WRITE, sizeof(cl_uint)*capacity);
+	tmpKeys = cl::Buffer(openCL->context, CL_MEM_READ_WRITE, sizeof(cl_uint)*capacity);
+	tmpVals = cl::Buffer(openCL->context, CL_MEM_READ_WRITE, sizeof(cl_uint)*capacity);
+	labels = cl::Buffer(openCL->context, CL_MEM_READ_WRITE, sizeof(cl_uint)*capacity);
+	labelRange = cl::Buffer(openCL->context, CL_MEM_READ_WRITE, sizeof(cl_uint2)*capacity);
+	groups = cl::Buffer(openCL->context, CL_MEM_READ_WRITE, sizeof(cl_uint2)*maxGroups);
+	catalogue = cl::Buffer(openCL->context, CL_MEM_READ_WRITE, sizeof(cl_double)*FOF_TERMS*maxGroups);
+}
+
+void GroupFinder::Sample(ParticlePool& posPool, ParticlePool& negPool)
+{
+	if (++step % interval != 0) return;
+
+	Timer findTimer;
+	FindGroups(posPool, 0);
+	FindGroups(negPool, 1);
+	findTime = findTimer.MilliCount();
+}
+
+void GroupFinder::FindGroups(ParticlePool& pool, cl_uint species)
+{
+	uint32_t count = pool.count;
+	groupCount[species] = largest[species] = 0;
+	if (count == 0) return;
+	Reserve(count);
+
+	// linking length is a fraction of the mean spacing, cells are at least that wide
+	double link = linking * SIM_POS_MOD / std::cbrt((double)count);
+	cl_GridInfo info;
+	info.max_radius = 0;
+	info.dim = (uint32_t)std::min(std::max(SIM_POS_MOD / link, 1.0), (double)GRID_MAX_DIM);
+	info.cell_size = (cl_float)(SIM_POS_MOD / info.dim);
+	info.pair_count = 0;
+	openCL->queue.enqueueWriteBuffer(gridInfo, CL_FALSE, 0, sizeof(info), &info);
+
+	openCL->GridK_Kernel.setArg(0, pool.buffer);
+	openCL->GridK_Kernel.setArg(1, cellKeys);
+	openCL->GridK_Kernel.setArg(2, cellVals);
+	openCL->GridK_Kernel.setArg(3, gridInfo);
+	openCL->GridK_Kernel.setArg(4, (cl_uint)0);
+	openCL->GridK_Kernel.setArg(5, (cl_uint)0);
+	openCL->GridKeys(count);
+
+	openCL->RadixSort(cellKeys, cellVals, tmpKeys, tmpVals, count, GRID_KEY_BITS);
+
+	openCL->queue.enqueueFillBuffer(cellRange, (cl_uint)0, 0, sizeof(cl_uint2)*GRID_MAX_DIM*GRID_MAX_DIM*GRID_MAX_DIM);
+	openCL->GridC_Kernel.setArg(0, cellKeys);
+	openCL->GridC_Kernel.setArg(1, cellRange);
+	openCL->GridC_Kernel.setArg(2, count);
+	openCL->GridCells(count);
+
+	// union every linked pair in one pass, then flatten the trees
+	openCL->FofI_Kernel.setArg(0, labels);
+	openCL->FofInit(count);
+
+	openCL->FofL_Kernel.setArg(0, pool.buffer);
+	openCL->FofL_Kernel.setArg(1, cellKeys);
+	openCL->FofL_Kernel.setArg(2, cellVals);
+	openCL->FofL_Kernel.setArg(3, cellRange);
+	openCL->FofL_Kernel.setArg(4, gridInfo);
+	openCL->FofL_Kernel.setArg(5, labels);
+	openCL->FofL_Kernel.setArg(6, (cl_double)link);
+	openCL->FofLink(count);
+
+	openCL->FofJ_Kernel.setArg(0, labels);
+	openCL->FofJump(count);
+
+	// sorting by root makes each group one contiguous run of particle indices
+	uint32_t labelBits = 1;
+	while (labelBits < 32 && (1u << labelBits) < count) labelBits++;
+	openCL->RadixSort(labels, cellVals, tmpKeys, tmpVals, count, labelBits);
+
+	openCL->queue.enqueueFillBuffer(labelRange, (cl_uint)0, 0, sizeof(cl_uint2)*count);
+	openCL->GridC_Kernel.setArg(0, labels);
+	openCL->GridC_Kernel.setArg(1, labelRange);
+	openCL->GridC_Kernel.setArg(2, count);
+	openCL->GridCells(count);
+
+	openCL->FofG_Kernel.setArg(0, labelRange);
+	openCL->FofG_Kernel.setArg(1, groups);
+	openCL->FofG_Kernel.setArg(2, gridInfo);
+	openCL->FofG_Kernel.setArg(3, (cl_uint)minMembers);
+	openCL->FofGroups(count);
+
+	// the group count decides the catalogue launch so it has to come back first
+	openCL->queue.enqueueReadBuffer(gridInfo, CL_TRUE, 0, sizeof(info), &info);
+	uint32_t found = info.pair_count;
+	groupCount[species] = found;
+	if (found == 0) return;
+
+	openCL->FofC_Kernel.setArg(0, pool.buffer);
+	openCL->FofC_Kernel.setArg(1, cellVals);
+	openCL->FofC_Kernel.setArg(2, groups);
+	openCL->FofC_Kernel.setArg(3, catalogue);
+	openCL->FofCatalogue(found);
+
+	hostCatalogue.resize(FOF_TERMS * found);
+	openCL->queue.enqueueReadBuffer(catalogue, CL_TRUE, 0, sizeof(cl_double)*hostCatalogue.size(), hostCatalogue.data());
+
+	// groups arrive in atomic order, ranking by size keeps the log comparable between samples
+	std::vector<uint32_t> order(found);
+	for (uint32_t g=0; g < found; ++g) order[g] = g;
+	std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+		return hostCatalogue[a*FOF_TERMS] > hostCatalogue[b*FOF_TERMS];
+	});
+	largest[species] = (uint32_t)hostCatalogue[order[0]*FOF_TERMS];
+
+	for (uint32_t r=0; r < found; ++r) {
+		const cl_double* terms = hostCatalogue.data() + order[r]*FOF_TERMS;
+		logFile << step << ',' << (species == 0 ? "pos" : "neg") << ',' << r << ',' << (uint32_t)terms[0];
+		for (int t=1; t < FOF_TERMS; ++t) logFile << ',' << terms[t];
+		logFile << '\n';
+	}
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "OpenCL.h"
+#include "ParticlePool.h"
+#include <fstream>
+#include <vector>
+
+// friends-of-friends groups of each species, linked through a uniform grid and merged
+// with a parallel union-find, every few steps the catalogue is logged
+class GroupFinder
+{
+public:
+	void Initialize(CL* pOpenCL, uint32_t sampleSteps, double linkFactor, uint32_t minGroupSize);
+	void Sample(ParticlePool& posPool, ParticlePool& negPool);
+private:
+	void Reserve(uint32_t count);
+	void FindGroups(ParticlePool& pool, cl_uint species);
+public:
+	uint32_t interval;
+	double linking;
+	uint32_t minMembers;
+	uint32_t groupCount[2];
+	uint32_t largest[2];
+	float findTime;
+private:
+	CL* openCL;
+	cl::Buffer gridInfo;
+	cl::Buffer cellRange;
+	cl::Buffer cellKeys;
+	cl::Buffer cellVals;
+	cl::Buffer tmpKeys;
+	cl::Buffer tmpVals;
+	cl::Buffer labels;
+	cl::Buffer labelRange;
+	cl::Buffer groups;
+	cl::Buffer catalogue;
+	std::vector<cl_double> hostCatalogue;
+	uint32_t capacity;
+	uint64_t step;
+	std::ofstream logFile;
+};
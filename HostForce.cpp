@@ -0,0 +1,684 @@
+#include "HostForce.h"
+#include "ReadWrite.h"
+#include "Timer.h"
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+	#include <immintrin.h>
+	#define FORCE_X86
+#endif
+
+typedef void (*ForceFunc)(HostForce& hf, uint32_t first, uint32_t last);
+
+// negative particles store a negative mass and the force kernel's pre-division force is
+// attractive for every pair, so negating their mass gives every source weight |m| and both
+// species run through one loop
+static inline double TargetScale(const HostForce& hf, uint32_t i)
+{
+	return SIM_G * hf.srcMass[i];
+}
+
+// a target only adds the source radius to its cut-off when both are positive
+static inline double TargetCutScale(const HostForce& hf, uint32_t i)
+{
+	return hf.cutScale[i];
+}
+
+// one axis of WrapPosition in the kernels
+static inline double WrapPosition(double pos)
+{
+	pos -= (pos > SIM_POS_MAX) ? SIM_POS_MOD : 0.0;
+	pos += (pos < SIM_POS_MIN) ? SIM_POS_MOD : 0.0;
+	return pos;
+}
+
+static void ForceScalar(HostForce& hf, uint32_t first, uint32_t last)
+{
+	for (uint32_t i=first; i < last; ++i) {
+		double xi = hf.srcX[i], yi = hf.srcY[i], zi = hf.srcZ[i];
+		double ri = hf.radius[i];
+		double cutScale = TargetCutScale(hf, i);
+		double ax = 0.0, ay = 0.0, az = 0.0;
+
+		for (uint32_t j=0; j < hf.count; ++j) {
+			double dx = hf.srcX[j] - xi;
+			double dy = hf.srcY[j] - yi;
+			double dz = hf.srcZ[j] - zi;
+			double dist2 = dx*dx + dy*dy + dz*dz;
+			double cut = ri + cutScale * hf.srcCut[j];
+
+			if (dist2 > cut*cut) {
+				double dist = std::sqrt(dist2);
+				double s = hf.srcMass[j] / (dist2 * dist);
+				ax += dx * s;
+				ay += dy * s;
+				az += dz * s;
+			}
+		}
+
+		double scale = TargetScale(hf, i);
+		hf.forceX[i] = ax * scale;
+		hf.forceY[i] = ay * scale;
+		hf.forceZ[i] = az * scale;
+	}
+}
+
+// one tile of the triangular pair space, every pair is visited once and feeds both
+// particles, the cut-offs differ per side so each side keeps its own test
+static void TileScalar(const HostForce& hf, const UInt2& tile, double* ax, double* ay, double* az)
+{
+	uint32_t aLast = std::min(tile.x + FORCE_BLOCK, hf.padCount);
+	uint32_t bLast = std::min(tile.y + FORCE_BLOCK, hf.padCount);
+
+	for (uint32_t i=tile.x; i < aLast; ++i) {
+		double xi = hf.srcX[i], yi = hf.srcY[i], zi = hf.srcZ[i];
+		double mi = hf.srcMass[i], ri = hf.radius[i], csi = hf.cutScale[i], ci = hf.srcCut[i];
+		double fx = 0.0, fy = 0.0, fz = 0.0;
+
+		for (uint32_t j=(tile.x == tile.y) ? i+1 : tile.y; j < bLast; ++j) {
+			double dx = hf.srcX[j] - xi;
+			double dy = hf.srcY[j] - yi;
+			double dz = hf.srcZ[j] - zi;
+			double dist2 = dx*dx + dy*dy + dz*dz;
+			double cutI = ri + csi * hf.srcCut[j];
+			double cutJ = hf.radius[j] + hf.cutScale[j] * ci;
+			double inv = 1.0 / std::sqrt(dist2);
+			double s = mi * hf.srcMass[j] * inv * inv * inv;
+
+			if (dist2 > cutI*cutI) {
+				fx += dx * s;
+				fy += dy * s;
+				fz += dz * s;
+			}
+			if (dist2 > cutJ*cutJ) {
+				ax[j] -= dx * s;
+				ay[j] -= dy * s;
+				az[j] -= dz * s;
+			}
+		}
+
+		ax[i] += fx;
+		ay[i] += fy;
+		az[i] += fz;
+	}
+}
+
+#ifdef FORCE_X86
+
+__attribute__((target("sse4.1")))
+static inline __m128d RsqrtSSE4(__m128d x)
+{
+	// single precision estimate refined twice in double
+	__m128d y = _mm_cvtps_pd(_mm_rsqrt_ps(_mm_cvtpd_ps(x)));
+	__m128d half = _mm_set1_pd(0.5), three_half = _mm_set1_pd(1.5);
+	__m128d hx = _mm_mul_pd(half, x);
+	y = _mm_mul_pd(y, _mm_sub_pd(three_half, _mm_mul_pd(hx, _mm_mul_pd(y, y))));
+	y = _mm_mul_pd(y, _mm_sub_pd(three_half, _mm_mul_pd(hx, _mm_mul_pd(y, y))));
+	return y;
+}
+
+__attribute__((target("sse4.1")))
+static void ForceSSE4(HostForce& hf, uint32_t first, uint32_t last)
+{
+	const double* px = hf.srcX.data();
+	const double* py = hf.srcY.data();
+	const double* pz = hf.srcZ.data();
+	const double* pm = hf.srcMass.data();
+	const double* pc = hf.srcCut.data();
+
+	for (uint32_t i=first; i < last; ++i) {
+		__m128d xi = _mm_set1_pd(px[i]), yi = _mm_set1_pd(py[i]), zi = _mm_set1_pd(pz[i]);
+		__m128d ri = _mm_set1_pd(hf.radius[i]);
+		__m128d cutScale = _mm_set1_pd(TargetCutScale(hf, i));
+		__m128d ax = _mm_setzero_pd(), ay = _mm_setzero_pd(), az = _mm_setzero_pd();
+
+		for (uint32_t j=0; j < hf.padCount; j += 2) {
+			__m128d dx = _mm_sub_pd(_mm_loadu_pd(px+j), xi);
+			__m128d dy = _mm_sub_pd(_mm_loadu_pd(py+j), yi);
+			__m128d dz = _mm_sub_pd(_mm_loadu_pd(pz+j), zi);
+			__m128d dist2 = _mm_add_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)), _mm_mul_pd(dz, dz));
+			__m128d cut = _mm_add_pd(ri, _mm_mul_pd(cutScale, _mm_loadu_pd(pc+j)));
+			__m128d mask = _mm_cmpgt_pd(dist2, _mm_mul_pd(cut, cut));
+			__m128d inv = RsqrtSSE4(dist2);
+			__m128d s = _mm_and_pd(mask, _mm_mul_pd(_mm_loadu_pd(pm+j), _mm_mul_pd(inv, _mm_mul_pd(inv, inv))));
+			ax = _mm_add_pd(ax, _mm_mul_pd(dx, s));
+			ay = _mm_add_pd(ay, _mm_mul_pd(dy, s));
+			az = _mm_add_pd(az, _mm_mul_pd(dz, s));
+		}
+
+		double scale = TargetScale(hf, i);
+		hf.forceX[i] = _mm_cvtsd_f64(_mm_hadd_pd(ax, ax)) * scale;
+		hf.forceY[i] = _mm_cvtsd_f64(_mm_hadd_pd(ay, ay)) * scale;
+		hf.forceZ[i] = _mm_cvtsd_f64(_mm_hadd_pd(az, az)) * scale;
+	}
+}
+
+__attribute__((target("avx2,fma")))
+static inline __m256d RsqrtAVX2(__m256d x)
+{
+	__m256d y = _mm256_cvtps_pd(_mm_rsqrt_ps(_mm256_cvtpd_ps(x)));
+	__m256d hx = _mm256_mul_pd(_mm256_set1_pd(0.5), x);
+	__m256d three_half = _mm256_set1_pd(1.5);
+	y = _mm256_mul_pd(y, _mm256_fnmadd_pd(hx, _mm256_mul_pd(y, y), three_half));
+	y = _mm256_mul_pd(y, _mm256_fnmadd_pd(hx, _mm256_mul_pd(y, y), three_half));
+	return y;
+}
+
+__attribute__((target("avx2,fma")))
+static inline double SumAVX2(__m256d v)
+{
+	__m128d sum = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+	return _mm_cvtsd_f64(_mm_hadd_pd(sum, sum));
+}
+
+__attribute__((target("avx2,fma")))
+static void ForceAVX2(HostForce& hf, uint32_t first, uint32_t last)
+{
+	const double* px = hf.srcX.data();
+	const double* py = hf.srcY.data();
+	const double* pz = hf.srcZ.data();
+	const double* pm = hf.srcMass.data();
+	const double* pc = hf.srcCut.data();
+
+	for (uint32_t i=first; i < last; ++i) {
+		__m256d xi = _mm256_set1_pd(px[i]), yi = _mm256_set1_pd(py[i]), zi = _mm256_set1_pd(pz[i]);
+		__m256d ri = _mm256_set1_pd(hf.radius[i]);
+		__m256d cutScale = _mm256_set1_pd(TargetCutScale(hf, i));
+		__m256d ax = _mm256_setzero_pd(), ay = _mm256_setzero_pd(), az = _mm256_setzero_pd();
+
+		for (uint32_t j=0; j < hf.padCount; j += 4) {
+			__m256d dx = _mm256_sub_pd(_mm256_loadu_pd(px+j), xi);
+			__m256d dy = _mm256_sub_pd(_mm256_loadu_pd(py+j), yi);
+			__m256d dz = _mm256_sub_pd(_mm256_loadu_pd(pz+j), zi);
+			__m256d dist2 = _mm256_fmadd_pd(dx, dx, _mm256_fmadd_pd(dy, dy, _mm256_mul_pd(dz, dz)));
+			__m256d cut = _mm256_fmadd_pd(cutScale, _mm256_loadu_pd(pc+j), ri);
+			__m256d mask = _mm256_cmp_pd(dist2, _mm256_mul_pd(cut, cut), _CMP_GT_OQ);
+			__m256d inv = RsqrtAVX2(dist2);
+			__m256d s = _mm256_and_pd(mask, _mm256_mul_pd(_mm256_loadu_pd(pm+j), _mm256_mul_pd(inv, _mm256_mul_pd(inv, inv))));
+			ax = _mm256_fmadd_pd(dx, s, ax);
+			ay = _mm256_fmadd_pd(dy, s, ay);
+			az = _mm256_fmadd_pd(dz, s, az);
+		}
+
+		double scale = TargetScale(hf, i);
+		hf.forceX[i] = SumAVX2(ax) * scale;
+		hf.forceY[i] = SumAVX2(ay) * scale;
+		hf.forceZ[i] = SumAVX2(az) * scale;
+	}
+}
+
+__attribute__((target("avx2,fma")))
+static void TileAVX2(const HostForce& hf, const UInt2& tile, double* ax, double* ay, double* az)
+{
+	const double* px = hf.srcX.data();
+	const double* py = hf.srcY.data();
+	const double* pz = hf.srcZ.data();
+	const double* pm = hf.srcMass.data();
+	const double* pc = hf.srcCut.data();
+	const double* pr = hf.radius.data();
+	const double* ps = hf.cutScale.data();
+	uint32_t aLast = std::min(tile.x + FORCE_BLOCK, hf.padCount);
+	uint32_t bLast = std::min(tile.y + FORCE_BLOCK, hf.padCount);
+	__m256d laneOffset = _mm256_set_pd(3.0, 2.0, 1.0, 0.0);
+
+	for (uint32_t i=tile.x; i < aLast; ++i) {
+		__m256d xi = _mm256_set1_pd(px[i]), yi = _mm256_set1_pd(py[i]), zi = _mm256_set1_pd(pz[i]);
+		__m256d mi = _mm256_set1_pd(pm[i]), ri = _mm256_set1_pd(pr[i]);
+		__m256d csi = _mm256_set1_pd(ps[i]), ci = _mm256_set1_pd(pc[i]);
+		__m256d index = _mm256_set1_pd((double)i);
+		__m256d fx = _mm256_setzero_pd(), fy = _mm256_setzero_pd(), fz = _mm256_setzero_pd();
+
+		// diagonal tiles start at the vector holding i+1 and mask off j <= i
+		uint32_t jFirst = (tile.x == tile.y) ? ((i+1) & ~3u) : tile.y;
+
+		for (uint32_t j=jFirst; j < bLast; j += 4) {
+			__m256d dx = _mm256_sub_pd(_mm256_loadu_pd(px+j), xi);
+			__m256d dy = _mm256_sub_pd(_mm256_loadu_pd(py+j), yi);
+			__m256d dz = _mm256_sub_pd(_mm256_loadu_pd(pz+j), zi);
+			__m256d dist2 = _mm256_fmadd_pd(dx, dx, _mm256_fmadd_pd(dy, dy, _mm256_mul_pd(dz, dz)));
+			__m256d cutI = _mm256_fmadd_pd(csi, _mm256_loadu_pd(pc+j), ri);
+			__m256d cutJ = _mm256_fmadd_pd(_mm256_loadu_pd(ps+j), ci, _mm256_loadu_pd(pr+j));
+			__m256d after = _mm256_cmp_pd(_mm256_add_pd(_mm256_set1_pd((double)j), laneOffset), index, _CMP_GT_OQ);
+			__m256d maskI = _mm256_and_pd(after, _mm256_cmp_pd(dist2, _mm256_mul_pd(cutI, cutI), _CMP_GT_OQ));
+			__m256d maskJ = _mm256_and_pd(after, _mm256_cmp_pd(dist2, _mm256_mul_pd(cutJ, cutJ), _CMP_GT_OQ));
+			__m256d inv = RsqrtAVX2(dist2);
+			__m256d s = _mm256_mul_pd(_mm256_mul_pd(mi, _mm256_loadu_pd(pm+j)), _mm256_mul_pd(inv, _mm256_mul_pd(inv, inv)));
+			__m256d sI = _mm256_and_pd(maskI, s);
+			__m256d sJ = _mm256_and_pd(maskJ, s);
+
+			fx = _mm256_fmadd_pd(dx, sI, fx);
+			fy = _mm256_fmadd_pd(dy, sI, fy);
+			fz = _mm256_fmadd_pd(dz, sI, fz);
+			_mm256_storeu_pd(ax+j, _mm256_fnmadd_pd(dx, sJ, _mm256_loadu_pd(ax+j)));
+			_mm256_storeu_pd(ay+j, _mm256_fnmadd_pd(dy, sJ, _mm256_loadu_pd(ay+j)));
+			_mm256_storeu_pd(az+j, _mm256_fnmadd_pd(dz, sJ, _mm256_loadu_pd(az+j)));
+		}
+
+		ax[i] += SumAVX2(fx);
+		ay[i] += SumAVX2(fy);
+		az[i] += SumAVX2(fz);
+	}
+}
+
+__attribute__((target("avx512f")))
+static inline __m512d RsqrtAVX512(__m512d x)
+{
+	// 14 bit estimate, two refinements get close to full double precision
+	__m512d y = _mm512_rsqrt14_pd(x);
+	__m512d hx = _mm512_mul_pd(_mm512_set1_pd(0.5), x);
+	__m512d three_half = _mm512_set1_pd(1.5);
+	y = _mm512_mul_pd(y, _mm512_fnmadd_pd(hx, _mm512_mul_pd(y, y), three_half));
+	y = _mm512_mul_pd(y, _mm512_fnmadd_pd(hx, _mm512_mul_pd(y, y), three_half));
+	return y;
+}
+
+__attribute__((target("avx512f")))
+static void ForceAVX512(HostForce& hf, uint32_t first, uint32_t last)
+{
+	const double* px = hf.srcX.data();
+	const double* py = hf.srcY.data();
+	const double* pz = hf.srcZ.data();
+	const double* pm = hf.srcMass.data();
+	const double* pc = hf.srcCut.data();
+
+	for (uint32_t i=first; i < last; ++i) {
+		__m512d xi = _mm512_set1_pd(px[i]), yi = _mm512_set1_pd(py[i]), zi = _mm512_set1_pd(pz[i]);
+		__m512d ri = _mm512_set1_pd(hf.radius[i]);
+		__m512d cutScale = _mm512_set1_pd(TargetCutScale(hf, i));
+		__m512d ax = _mm512_setzero_pd(), ay = _mm512_setzero_pd(), az = _mm512_setzero_pd();
+
+		for (uint32_t j=0; j < hf.padCount; j += 8) {
+			__m512d dx = _mm512_sub_pd(_mm512_loadu_pd(px+j), xi);
+			__m512d dy = _mm512_sub_pd(_mm512_loadu_pd(py+j), yi);
+			__m512d dz = _mm512_sub_pd(_mm512_loadu_pd(pz+j), zi);
+			__m512d dist2 = _mm512_fmadd_pd(dx, dx, _mm512_fmadd_pd(dy, dy, _mm512_mul_pd(dz, dz)));
+			__m512d cut = _mm512_fmadd_pd(cutScale, _mm512_loadu_pd(pc+j), ri);
+			__mmask8 mask = _mm512_cmp_pd_mask(dist2, _mm512_mul_pd(cut, cut), _CMP_GT_OQ);
+			__m512d inv = RsqrtAVX512(dist2);
+			__m512d s = _mm512_maskz_mul_pd(mask, _mm512_loadu_pd(pm+j), _mm512_mul_pd(inv, _mm512_mul_pd(inv, inv)));
+			ax = _mm512_fmadd_pd(dx, s, ax);
+			ay = _mm512_fmadd_pd(dy, s, ay);
+			az = _mm512_fmadd_pd(dz, s, az);
+		}
+
+		double scale = TargetScale(hf, i);
+		hf.forceX[i] = _mm512_reduce_add_pd(ax) * scale;
+		hf.forceY[i] = _mm512_reduce_add_pd(ay) * scale;
+		hf.forceZ[i] = _mm512_reduce_add_pd(az) * scale;
+	}
+}
+
+#endif
+
+static ForceFunc GetForceFunc(int forceVariant)
+{
+#ifdef FORCE_X86
+	switch (forceVariant) {
+		case FORCE_SSE4: return ForceSSE4;
+		case FORCE_AVX2: return ForceAVX2;
+		case FORCE_AVX512: return ForceAVX512;
+	}
+#endif
+	return ForceScalar;
+}
+
+bool HostForce::Supported(int forceVariant)
+{
+#ifdef FORCE_X86
+	switch (forceVariant) {
+		case FORCE_SSE4: return __builtin_cpu_supports("sse4.1");
+		case FORCE_AVX2: return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+		case FORCE_AVX512: return __builtin_cpu_supports("avx512f");
+	}
+#endif
+	return forceVariant == FORCE_SCALAR;
+}
+
+const char* HostForce::VariantName(int forceVariant)
+{
+	switch (forceVariant) {
+		case FORCE_SSE4: return "SSE4";
+		case FORCE_AVX2: return "AVX2";
+		case FORCE_AVX512: return "AVX-512";
+	}
+	return "scalar";
+}
+
+void HostForce::Initialize(const HostTopology* hostTopology, bool pin, bool huge)
+{
+	// pick the widest variant the CPU can run
+	variant = FORCE_SCALAR;
+	for (int v=FORCE_AVX512; v > FORCE_SCALAR; --v) {
+		if (Supported(v)) {
+			variant = v;
+			break;
+		}
+	}
+	topology = hostTopology;
+	pinThreads = pin;
+	hugePages = huge;
+	posCount = 0;
+	count = 0;
+	padCount = 0;
+	accumSize = 0;
+}
+
+void HostForce::Load(const std::vector<cl_Particle>& posPrtcls, const std::vector<cl_Particle>& negPrtcls, TaskPool* pool)
+{
+	HostArray* arrays[] = { &srcX, &srcY, &srcZ, &srcMass, &srcCut, &radius, &cutScale, &forceX, &forceY, &forceZ,
+							&velX, &velY, &velZ };
+	uint32_t newPadCount = ((posPrtcls.size() + negPrtcls.size() + FORCE_LANES - 1) / FORCE_LANES) * FORCE_LANES;
+
+	posCount = posPrtcls.size();
+	count = posCount + negPrtcls.size();
+
+	if (newPadCount != padCount || pool != NULL) {
+		// fresh pages stay untouched until the fill below, a pool always gets fresh ones so its
+		// workers make the first touch even when the arrays were already filled on this thread
+		for (size_t a=0; a < sizeof(arrays)/sizeof(arrays[0]); ++a) {
+			arrays[a]->Allocate(newPadCount, hugePages);
+		}
+		padCount = newPadCount;
+	}
+
+	// each block is written by the worker that starts out owning it, placing its pages on that worker's node
+	uint32_t blocks = (padCount + FORCE_BLOCK - 1) / FORCE_BLOCK;
+	TaskPool::TaskFunc fill = [&](uint32_t task, uint32_t worker) {
+		uint32_t last = std::min((task+1) * FORCE_BLOCK, padCount);
+		for (uint32_t i=task * FORCE_BLOCK; i < last; ++i) {
+			// padding sources are massless so they add nothing
+			bool isPos = i < posCount;
+			if (i >= count) {
+				for (size_t a=0; a < sizeof(arrays)/sizeof(arrays[0]); ++a) (*arrays[a])[i] = 0.0;
+				continue;
+			}
+			const cl_Particle& prtcl = isPos ? posPrtcls[i] : negPrtcls[i - posCount];
+			srcX[i] = prtcl.position.s[0];
+			srcY[i] = prtcl.position.s[1];
+			srcZ[i] = prtcl.position.s[2];
+			srcMass[i] = isPos ? prtcl.mass : -prtcl.mass;
+			srcCut[i] = isPos ? prtcl.radius : 0.0;
+			radius[i] = prtcl.radius;
+			cutScale[i] = isPos ? 1.0 : 0.0;
+			forceX[i] = forceY[i] = forceZ[i] = 0.0;
+			velX[i] = prtcl.velocity.s[0];
+			velY[i] = prtcl.velocity.s[1];
+			velZ[i] = prtcl.velocity.s[2];
+		}
+	};
+
+	if (pool != NULL) {
+		pool->Run(blocks, fill);
+	} else {
+		for (uint32_t b=0; b < blocks; ++b) fill(b, 0);
+	}
+
+	// upper triangle of FORCE_BLOCK sized tiles, diagonal tiles included
+	tiles.clear();
+	for (uint32_t a=0; a < padCount; a += FORCE_BLOCK) {
+		for (uint32_t b=a; b < padCount; b += FORCE_BLOCK) {
+			UInt2 tile = {a, b};
+			tiles.push_back(tile);
+		}
+	}
+}
+
+void HostForce::Compute(uint32_t first, uint32_t last)
+{
+	ComputeWith(variant, first, last);
+}
+
+void HostForce::ComputeWith(int forceVariant, uint32_t first, uint32_t last)
+{
+	last = std::min(last, count);
+	if (first >= last) return;
+	GetForceFunc(forceVariant)(*this, first, last);
+	AddWallForces(first, last);
+}
+
+void HostForce::ComputeSymmetric(TaskPool& pool)
+{
+	if (count == 0) return;
+	uint32_t workerCount = pool.ThreadCount();
+	uint32_t blocks = (padCount + FORCE_BLOCK - 1) / FORCE_BLOCK;
+
+	if (accum.size() != workerCount || accumSize != padCount) {
+		accum.clear();
+		for (uint32_t w=0; w < workerCount; ++w) {
+			accum.push_back(std::unique_ptr<HostArray>(new HostArray()));
+		}
+		accumReady.assign(workerCount, 0);
+		accumSize = padCount;
+	}
+
+#ifdef FORCE_X86
+	bool useAVX2 = variant >= FORCE_AVX2;
+#else
+	bool useAVX2 = false;
+#endif
+
+	// each worker adds into its own stripes, so tiles never contend
+	pool.Run(tiles.size(), [this, useAVX2](uint32_t task, uint32_t worker) {
+		if (!accumReady[worker]) {
+			accum[worker]->Allocate(3*padCount, hugePages);
+			std::fill(accum[worker]->data(), accum[worker]->data() + 3*padCount, 0.0);
+			accumReady[worker] = 1;
+		}
+		double* ax = accum[worker]->data();
+		double* ay = ax + padCount;
+		double* az = ay + padCount;
+#ifdef FORCE_X86
+		if (useAVX2) {
+			TileAVX2(*this, tiles[task], ax, ay, az);
+			return;
+		}
+#endif
+		TileScalar(*this, tiles[task], ax, ay, az);
+	});
+
+	// fold the stripes block by block and clear them for the next step
+	pool.Run(blocks, [this](uint32_t task, uint32_t worker) {
+		uint32_t first = task * FORCE_BLOCK;
+		uint32_t last = std::min(first + FORCE_BLOCK, count);
+		for (uint32_t i=first; i < last; ++i) {
+			double fx = 0.0, fy = 0.0, fz = 0.0;
+			for (size_t w=0; w < accum.size(); ++w) {
+				if (!accumReady[w]) continue;
+				double* stripe = accum[w]->data();
+				fx += stripe[i];
+				fy += stripe[padCount + i];
+				fz += stripe[2*padCount + i];
+				stripe[i] = stripe[padCount + i] = stripe[2*padCount + i] = 0.0;
+			}
+			forceX[i] = fx * SIM_G;
+			forceY[i] = fy * SIM_G;
+			forceZ[i] = fz * SIM_G;
+		}
+		AddWallForces(first, last);
+	});
+}
+
+void HostForce::Step(TaskPool& pool)
+{
+	ComputeSymmetric(pool);
+
+	// the same update as UpdateParticles, negative particles divide by their stored negative mass
+	uint32_t blocks = (padCount + FORCE_BLOCK - 1) / FORCE_BLOCK;
+	pool.Run(blocks, [this](uint32_t task, uint32_t worker) {
+		uint32_t last = std::min((task+1) * FORCE_BLOCK, count);
+		for (uint32_t i=task * FORCE_BLOCK; i < last; ++i) {
+			double mass = (i < posCount) ? srcMass[i] : -srcMass[i];
+			velX[i] += forceX[i] / mass;
+			velY[i] += forceY[i] / mass;
+			velZ[i] += forceZ[i] / mass;
+			srcX[i] = WrapPosition(srcX[i] + velX[i] * SIM_SPEED_MULT);
+			srcY[i] = WrapPosition(srcY[i] + velY[i] * SIM_SPEED_MULT);
+			srcZ[i] = WrapPosition(srcZ[i] + velZ[i] * SIM_SPEED_MULT);
+		}
+	});
+}
+
+void HostForce::AddWallForces(uint32_t first, uint32_t last)
+{
+	// only the positive species feels the walls
+	for (uint32_t i=first; i < std::min(last, posCount); ++i) {
+		double gm = SIM_G * SIM_INV_MASS * srcMass[i];
+		forceX[i] += gm / ((SIM_IMP_MAX - srcX[i]) * (SIM_IMP_MAX - srcX[i])) - gm / ((srcX[i] - SIM_IMP_MIN) * (srcX[i] - SIM_IMP_MIN));
+		forceY[i] += gm / ((SIM_IMP_MAX - srcY[i]) * (SIM_IMP_MAX - srcY[i])) - gm / ((srcY[i] - SIM_IMP_MIN) * (srcY[i] - SIM_IMP_MIN));
+		forceZ[i] += gm / ((SIM_IMP_MAX - srcZ[i]) * (SIM_IMP_MAX - srcZ[i])) - gm / ((srcZ[i] - SIM_IMP_MIN) * (srcZ[i] - SIM_IMP_MIN));
+	}
+}
+
+static double MaxRelError(const HostForce& hf, const std::vector<double>& refX, const std::vector<double>& refY,
+						  const std::vector<double>& refZ)
+{
+	double maxError = 0.0;
+	for (size_t i=0; i < refX.size(); ++i) {
+		double refMag = std::sqrt(refX[i]*refX[i] + refY[i]*refY[i] + refZ[i]*refZ[i]);
+		double errX = hf.forceX[i] - refX[i], errY = hf.forceY[i] - refY[i], errZ = hf.forceZ[i] - refZ[i];
+		double err = std::sqrt(errX*errX + errY*errY + errZ*errZ);
+		if (refMag > 0.0) maxError = std::max(maxError, err / refMag);
+	}
+	return maxError;
+}
+
+void HostForce::Benchmark(const std::vector<cl_Particle>& posPrtcls, const std::vector<cl_Particle>& negPrtcls,
+						  uint32_t targets, uint32_t repeats, uint32_t maxThreads)
+{
+	Load(posPrtcls, negPrtcls);
+	targets = std::min(targets, count);
+	if (targets == 0) return;
+
+	// the scalar pass is the reference the vector variants are checked against
+	std::vector<double> refX, refY, refZ;
+	double interactions = (double)targets * count;
+	double scalarRate = 0.0;
+
+	PrintLine("Host force benchmark: "+VarToStr(targets)+" targets x "+VarToStr(count)+" sources, "+
+			  VarToStr(std::thread::hardware_concurrency())+" hardware threads, using "+VariantName(variant)+
+			  (srcX.onHugePages() ? ", huge pages" : ""));
+
+	for (int v=FORCE_SCALAR; v <= FORCE_AVX512; ++v) {
+		if (!Supported(v)) {
+			PrintLine(std::string(VariantName(v))+": not supported");
+			continue;
+		}
+
+		float best = 1e9f;
+		Timer timer;
+		for (uint32_t r=0; r < repeats; ++r) {
+			timer.ResetTimer();
+			ComputeWith(v, 0, targets);
+			best = std::min(best, timer.MilliCount());
+		}
+
+		double maxError = 0.0;
+		if (v == FORCE_SCALAR) {
+			refX.assign(forceX.data(), forceX.data()+targets);
+			refY.assign(forceY.data(), forceY.data()+targets);
+			refZ.assign(forceZ.data(), forceZ.data()+targets);
+		} else {
+			maxError = MaxRelError(*this, refX, refY, refZ);
+		}
+
+		// single threaded, so this is the per core rate
+		double rate = interactions / (std::max(best, 0.001f) * 0.001);
+		if (v == FORCE_SCALAR) scalarRate = rate;
+
+		std::stringstream line;
+		line << std::left << std::setw(8) << VariantName(v) << std::right << std::fixed;
+		line << std::setprecision(3) << best << " ms | ";
+		line << std::setprecision(1) << (rate / 1e6) << " M interactions/s/core | x";
+		line << std::setprecision(2) << (rate / scalarRate);
+		line << " | max rel error " << std::scientific << std::setprecision(2) << maxError;
+		PrintLine(line);
+	}
+
+	// the symmetric engine does half the pairs, rates are quoted as the full n^2 for comparison
+	double fullInteractions = (double)count * count;
+	double oneThreadTime = 0.0;
+	std::vector<uint32_t> threadCounts;
+	TaskPool pool;
+
+	// powers of two plus whole sockets, up to the full thread count
+	maxThreads = std::max(maxThreads, (uint32_t)1);
+	for (uint32_t threads=1; threads < maxThreads; threads *= 2) threadCounts.push_back(threads);
+	threadCounts.push_back(maxThreads);
+	if (topology != NULL) {
+		std::vector<uint32_t> socketCounts = topology->SocketThreadCounts();
+		for (size_t c=0; c < socketCounts.size(); ++c) {
+			if (socketCounts[c] < maxThreads) threadCounts.push_back(socketCounts[c]);
+		}
+	}
+	std::sort(threadCounts.begin(), threadCounts.end());
+	threadCounts.erase(std::unique(threadCounts.begin(), threadCounts.end()), threadCounts.end());
+
+	for (size_t t=0; t < threadCounts.size(); ++t) {
+		uint32_t threads = threadCounts[t];
+		pool.Initialize(threads, pinThreads ? topology : NULL);
+
+		// reallocate and refill so first touch matches this pool's layout
+		Load(posPrtcls, negPrtcls, &pool);
+		pool.steals = 0;
+
+		float best = 1e9f;
+		Timer timer;
+		for (uint32_t r=0; r < repeats; ++r) {
+			timer.ResetTimer();
+			ComputeSymmetric(pool);
+			best = std::min(best, timer.MilliCount());
+		}
+		if (threads == 1) oneThreadTime = best;
+
+		double maxError = MaxRelError(*this, refX, refY, refZ);
+		double rate = fullInteractions / (std::max(best, 0.001f) * 0.001);
+		double speedup = oneThreadTime / std::max(best, 0.001f);
+
+		std::vector<uint32_t> usedNodes;
+		for (uint32_t w=0; w < threads && topology != NULL; ++w) usedNodes.push_back(topology->WorkerNode(w));
+		std::sort(usedNodes.begin(), usedNodes.end());
+		usedNodes.erase(std::unique(usedNodes.begin(), usedNodes.end()), usedNodes.end());
+
+		std::stringstream line;
+		line << "symmetric x" << threads << " on " << std::max(usedNodes.size(), (size_t)1) << " node(s)" << std::fixed;
+		line << std::setprecision(3) << " " << best << " ms | ";
+		line << std::setprecision(1) << (rate / 1e6 / threads) << " M interactions/s/core | speedup x";
+		line << std::setprecision(2) << speedup << " (" << std::setprecision(0) << (100.0 * speedup / threads) << "% efficiency)";
+		line << " | steals " << (pool.steals / repeats);
+		line << " | max rel error " << std::scientific << std::setprecision(2) << maxError;
+		PrintLine(line);
+	}
+}
+
+void HostForce::CompareForces(const std::vector<cl_Particle>& posPrtcls, const std::vector<cl_Particle>& negPrtcls,
+							  const std::vector<cl_Particle>& posTest, const std::vector<cl_Particle>& negTest,
+							  uint32_t targets, const std::string& name)
+{
+	// scalar forces on both sets, the first one is the reference
+	Load(posPrtcls, negPrtcls);
+	targets = std::min(targets, count);
+	if (targets == 0) return;
+
+	ComputeWith(FORCE_SCALAR, 0, targets);
+	std::vector<double> refX(forceX.data(), forceX.data()+targets);
+	std::vector<double> refY(forceY.data(), forceY.data()+targets);
+	std::vector<double> refZ(forceZ.data(), forceZ.data()+targets);
+
+	Load(posTest, negTest);
+	ComputeWith(FORCE_SCALAR, 0, targets);
+
+	double sumSq = 0.0;
+	for (uint32_t i=0; i < targets; ++i) {
+		double refMag = std::sqrt(refX[i]*refX[i] + refY[i]*refY[i] + refZ[i]*refZ[i]);
+		double errX = forceX[i] - refX[i], errY = forceY[i] - refY[i], errZ = forceZ[i] - refZ[i];
+		if (refMag > 0.0) sumSq += (errX*errX + errY*errY + errZ*errZ) / (refMag*refMag);
+	}
+
+	std::stringstream line;
+	line << name << ": " << targets << " targets | max rel error " << std::scientific << std::setprecision(2);
+	line << MaxRelError(*this, refX, refY, refZ) << " | rms rel error " << std::sqrt(sumSq / targets);
+	PrintLine(line);
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include "CLTypes.h"
+#include "Resource.h"
+#include "MathExt.h"
+#include "TaskPool.h"
+#include "HostNuma.h"
+#include <memory>
+#include <vector>
+
+// host copy of both species in SoA form, evaluating the same forces as UpdateParticles
+class HostForce
+{
+public:
+	void Initialize(const HostTopology* hostTopology = NULL, bool pin = false, bool huge = false);
+	void Load(const std::vector<cl_Particle>& posPrtcls, const std::vector<cl_Particle>& negPrtcls, TaskPool* pool = NULL);
+	void Compute(uint32_t first, uint32_t last);
+	void ComputeWith(int forceVariant, uint32_t first, uint32_t last);
+	void ComputeSymmetric(TaskPool& pool);
+	void Step(TaskPool& pool);
+	void Benchmark(const std::vector<cl_Particle>& posPrtcls, const std::vector<cl_Particle>& negPrtcls,
+				   uint32_t targets, uint32_t repeats, uint32_t maxThreads);
+	void CompareForces(const std::vector<cl_Particle>& posPrtcls, const std::vector<cl_Particle>& negPrtcls,
+					   const std::vector<cl_Particle>& posTest, const std::vector<cl_Particle>& negTest,
+					   uint32_t targets, const std::string& name);
+	static bool Supported(int forceVariant);
+	static const char* VariantName(int forceVariant);
+private:
+	void AddWallForces(uint32_t first, uint32_t last);
+public:
+	int variant;
+	uint32_t posCount;
+	uint32_t count;
+	uint32_t padCount;
+	// sources are padded to a multiple of FORCE_LANES with massless entries
+	HostArray srcX, srcY, srcZ;
+	HostArray srcMass;
+	HostArray srcCut;
+	HostArray radius;
+	HostArray cutScale;
+	HostArray forceX, forceY, forceZ;
+	HostArray velX, velY, velZ;
+private:
+	const HostTopology* topology;
+	bool pinThreads;
+	bool hugePages;
+	// per worker x, y and z force stripes for the symmetric engine, first touched by their worker
+	std::vector<std::unique_ptr<HostArray>> accum;
+	std::vector<char> accumReady;
+	uint32_t accumSize;
+	std::vector<UInt2> tiles;
+};
@@ -0,0 +1,200 @@
+#include "HostNuma.h"
+#include "Resource.h"
+#include "ReadWrite.h"
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <algorithm>
+
+#ifdef _WIN32
+	#include <windows.h>
+#else
+	#include <sys/mman.h>
+	#include <pthread.h>
+	#include <sched.h>
+#endif
+
+// parses sysfs lists like "0-15,32-47"
+static std::vector<uint32_t> ParseCpuList(const std::string& list)
+{
+	std::vector<uint32_t> cpus;
+	std::stringstream stream(list);
+	std::string range;
+
+	while (std::getline(stream, range, ',')) {
+		if (range.empty() || range[0] < '0' || range[0] > '9') continue;
+		size_t dash = range.find('-');
+		uint32_t first = stoi(range.substr(0, dash));
+		uint32_t last = (dash == std::string::npos) ? first : stoi(range.substr(dash+1));
+		for (uint32_t c=first; c <= last; ++c) cpus.push_back(c);
+	}
+	return cpus;
+}
+
+static std::string FormatCpuList(const std::vector<uint32_t>& cpus)
+{
+	std::stringstream list;
+	for (size_t i=0; i < cpus.size(); ) {
+		size_t j = i;
+		while (j+1 < cpus.size() && cpus[j+1] == cpus[j]+1) ++j;
+		if (i > 0) list << ',';
+		list << cpus[i];
+		if (j > i) list << '-' << cpus[j];
+		i = j+1;
+	}
+	return list.str();
+}
+
+void HostTopology::Detect()
+{
+	nodes.clear();
+	hugePageMode = "unknown";
+
+#ifdef _WIN32
+	ULONG highestNode = 0;
+	if (GetNumaHighestNodeNumber(&highestNode)) {
+		for (ULONG n=0; n <= highestNode; ++n) {
+			ULONGLONG mask = 0;
+			if (!GetNumaNodeProcessorMask((UCHAR)n, &mask) || mask == 0) continue;
+			NumaNode node;
+			node.id = n;
+			for (uint32_t c=0; c < 64; ++c) {
+				if (mask & (1ull << c)) node.cpus.push_back(c);
+			}
+			nodes.push_back(node);
+		}
+	}
+	hugePageMode = (GetLargePageMinimum() > 0) ? "large pages (needs SeLockMemoryPrivilege)" : "unavailable";
+#else
+	for (uint32_t n=0; n < HOST_MAX_NODES; ++n) {
+		std::ifstream cpuList("/sys/devices/system/node/node"+VarToStr(n)+"/cpulist");
+		if (!cpuList.is_open()) continue;
+		std::string list;
+		std::getline(cpuList, list);
+		NumaNode node;
+		node.id = n;
+		node.cpus = ParseCpuList(list);
+		if (!node.cpus.empty()) nodes.push_back(node);
+	}
+
+	std::ifstream thpFile("/sys/kernel/mm/transparent_hugepage/enabled");
+	if (thpFile.is_open()) {
+		std::getline(thpFile, hugePageMode);
+		hugePageMode = "transparent huge pages " + hugePageMode;
+	}
+#endif
+
+	// no NUMA information means one node holding every CPU
+	if (nodes.empty()) {
+		NumaNode node;
+		node.id = 0;
+		uint32_t cpuCount = std::max(std::thread::hardware_concurrency(), 1u);
+		for (uint32_t c=0; c < cpuCount; ++c) node.cpus.push_back(c);
+		nodes.push_back(node);
+	}
+
+	cpuOrder.clear();
+	cpuNode.clear();
+	for (size_t n=0; n < nodes.size(); ++n) {
+		for (size_t c=0; c < nodes[n].cpus.size(); ++c) {
+			cpuOrder.push_back(nodes[n].cpus[c]);
+			cpuNode.push_back(nodes[n].id);
+		}
+	}
+}
+
+void HostTopology::Report() const
+{
+	std::stringstream report;
+	report << "Host topology: " << nodes.size() << " NUMA node(s), " << cpuOrder.size() << " CPUs";
+	for (size_t n=0; n < nodes.size(); ++n) {
+		report << "\n  node " << nodes[n].id << ": " << nodes[n].cpus.size() << " CPUs (" << FormatCpuList(nodes[n].cpus) << ")";
+	}
+	report << "\n  huge pages: " << hugePageMode;
+	PrintLine(report);
+}
+
+std::vector<uint32_t> HostTopology::SocketThreadCounts() const
+{
+	// workers fill node by node, so these counts cover one socket, two sockets and so on
+	std::vector<uint32_t> counts;
+	uint32_t total = 0;
+	for (size_t n=0; n < nodes.size(); ++n) {
+		total += nodes[n].cpus.size();
+		counts.push_back(total);
+	}
+	return counts;
+}
+
+bool HostTopology::PinThread(uint32_t cpu)
+{
+#ifdef _WIN32
+	if (cpu >= 64) return false;
+	return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) != 0;
+#else
+	cpu_set_t cpuSet;
+	CPU_ZERO(&cpuSet);
+	CPU_SET(cpu, &cpuSet);
+	return pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) == 0;
+#endif
+}
+
+HostArray::HostArray() : ptr(NULL), length(0), bytes(0), huge(false) {}
+
+HostArray::~HostArray()
+{
+	Release();
+}
+
+void HostArray::Allocate(size_t count, bool hugePages)
+{
+	Release();
+	if (count == 0) return;
+	length = count;
+	bytes = sizeof(double) * count;
+
+#ifdef _WIN32
+	if (hugePages && GetLargePageMinimum() > 0) {
+		// large pages are committed up front and fail without the lock memory privilege
+		size_t large = GetLargePageMinimum();
+		size_t largeBytes = ((bytes + large - 1) / large) * large;
+		ptr = (double*)VirtualAlloc(NULL, largeBytes, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+		if (ptr != NULL) {
+			bytes = largeBytes;
+			huge = true;
+			return;
+		}
+	}
+	ptr = (double*)VirtualAlloc(NULL, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+	if (hugePages) {
+		// round up to whole huge pages so the kernel can back the range with them
+		bytes = ((bytes + HOST_HUGE_PAGE - 1) / HOST_HUGE_PAGE) * HOST_HUGE_PAGE;
+	}
+	void* mem = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	ptr = (mem == MAP_FAILED) ? NULL : (double*)mem;
+	#ifdef MADV_HUGEPAGE
+	if (ptr != NULL && hugePages) {
+		huge = madvise(ptr, bytes, MADV_HUGEPAGE) == 0;
+	}
+	#endif
+#endif
+
+	if (ptr == NULL) {
+		HandleFatalError(8, "Failed to allocate "+VarToStr(bytes)+" bytes of host memory");
+	}
+}
+
+void HostArray::Release()
+{
+	if (ptr == NULL) return;
+#ifdef _WIN32
+	VirtualFree(ptr, 0, MEM_RELEASE);
+#else
+	munmap(ptr, bytes);
+#endif
+	ptr = NULL;
+	length = 0;
+	bytes = 0;
+	huge = false;
+}
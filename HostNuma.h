@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <string>
+
+struct NumaNode
+{
+	uint32_t id;
+	std::vector<uint32_t> cpus;
+};
+
+// NUMA nodes and their CPUs, workers are placed node by node so a contiguous
+// run of workers shares a socket and its memory controller
+class HostTopology
+{
+public:
+	void Detect();
+	void Report() const;
+	uint32_t CpuCount() const { return cpuOrder.size(); }
+	uint32_t WorkerCpu(uint32_t worker) const { return cpuOrder[worker % cpuOrder.size()]; }
+	uint32_t WorkerNode(uint32_t worker) const { return cpuNode[worker % cpuNode.size()]; }
+	std::vector<uint32_t> SocketThreadCounts() const;
+	static bool PinThread(uint32_t cpu);
+public:
+	std::vector<NumaNode> nodes;
+	std::string hugePageMode;
+private:
+	std::vector<uint32_t> cpuOrder;
+	std::vector<uint32_t> cpuNode;
+};
+
+// page aligned host array that is left untouched on allocation, so the pages land on
+// the node of whichever thread first writes them
+class HostArray
+{
+public:
+	HostArray();
+	~HostArray();
+	void Allocate(size_t count, bool hugePages);
+	void Release();
+	double* data() { return ptr; }
+	const double* data() const { return ptr; }
+	double& operator[](size_t i) { return ptr[i]; }
+	const double& operator[](size_t i) const { return ptr[i]; }
+	size_t size() const { return length; }
+	bool onHugePages() const { return huge; }
+private:
+	HostArray(const HostArray&);
+	HostArray& operator=(const HostArray&);
+private:
+	double* ptr;
+	size_t length;
+	size_t bytes;
+	bool huge;
+};
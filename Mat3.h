@@ -0,0 +1,42 @@
+#pragma once
+#include "Vec3.h"
+
+// row major 3x3 matrix, each row is a vector so transforming a point is three dot products
+class DMat3 {
+public:
+	DVec3 row[3];
+public:
+	DMat3()
+	{
+		row[0] = DV3_X1;
+		row[1] = DV3_Y1;
+		row[2] = DV3_Z1;
+	}
+	DMat3(const DVec3& r0, const DVec3& r1, const DVec3& r2)
+	{
+		row[0] = r0;
+		row[1] = r1;
+		row[2] = r2;
+	}
+	inline DVec3 Column(const int c) const
+	{
+		return DVec3(row[0].vector.s[c], row[1].vector.s[c], row[2].vector.s[c]);
+	}
+	inline DMat3 Transpose() const
+	{
+		return DMat3(Column(0), Column(1), Column(2));
+	}
+	inline DVec3 operator*(const DVec3& v) const
+	{
+		return DVec3(row[0].VectDot(v), row[1].VectDot(v), row[2].VectDot(v));
+	}
+	inline DMat3 operator*(const DMat3& m) const
+	{
+		DMat3 t = m.Transpose();
+		return DMat3(t * row[0], t * row[1], t * row[2]);
+	}
+	inline DMat3 operator*(const double& scalar) const
+	{
+		return DMat3(row[0] * scalar, row[1] * scalar, row[2] * scalar);
+	}
+};
@@ -0,0 +1,49 @@
+#pragma once
+#include "Mat3.h"
+
+// row major 4x4 matrix for affine and projective transforms of points
+class DMat4 {
+public:
+	double m[4][4];
+public:
+	DMat4()
+	{
+		for (int r=0; r < 4; ++r) {
+			for (int c=0; c < 4; ++c) m[r][c] = (r == c) ? 1.0 : 0.0;
+		}
+	}
+	DMat4(const DMat3& rot, const DVec3& trans)
+	{
+		// rotation in the upper left, translation in the last column
+		for (int r=0; r < 3; ++r) {
+			for (int c=0; c < 3; ++c) m[r][c] = rot.row[r].vector.s[c];
+			m[r][3] = trans.vector.s[r];
+			m[3][r] = 0.0;
+		}
+		m[3][3] = 1.0;
+	}
+	inline DMat4 operator*(const DMat4& b) const
+	{
+		DMat4 result;
+		for (int r=0; r < 4; ++r) {
+			for (int c=0; c < 4; ++c) {
+				result.m[r][c] = m[r][0]*b.m[0][c] + m[r][1]*b.m[1][c] + m[r][2]*b.m[2][c] + m[r][3]*b.m[3][c];
+			}
+		}
+		return result;
+	}
+	inline void ToRows(cl_double4* rows) const
+	{
+		for (int r=0; r < 4; ++r) {
+			for (int c=0; c < 4; ++c) rows[r].s[c] = m[r][c];
+		}
+	}
+	inline void ToFloatRows(cl_float4* rows) const
+	{
+		// only meaningful for points already taken relative to the translation
+		for (int r=0; r < 4; ++r) {
+			for (int c=0; c < 3; ++c) rows[r].s[c] = (float)m[r][c];
+			rows[r].s[3] = 0.0f;
+		}
+	}
+};
@@ -0,0 +1,162 @@
+#include "Modes.h"
+#include "Timer.h"
+#include <sstream>
+#include <iomanip>
+#include <time.h>
+#include <cstdlib>
+
+bool StartupModes::Initialize()
+{
+	primBench = stoi(GLOBALS::config_map["PRIM_BENCH"]);
+	hostBench = stoi(GLOBALS::config_map["HOST_BENCH"]);
+	hostSteps = stoi(GLOBALS::config_map["HOST_STEPS"]);
+	oocCount = stoull(GLOBALS::config_map["OOC_PARTICLES"]);
+	ensembleSystems = stoi(GLOBALS::config_map["ENSEMBLE_SYSTEMS"]);
+
+	return primBench > 0 || hostBench > 0 || hostSteps > 0 || oocCount > 0 || ensembleSystems > 0;
+}
+
+void StartupModes::Run()
+{
+	// only the particle layout changes what the batch kernels compute
+	std::string clOptions;
+	compactParticles = stoi(GLOBALS::config_map["COMPACT_PARTICLES"]) != 0;
+	if (compactParticles) {
+		clOptions += "-D COMPACT_PARTICLES ";
+	}
+	openCL.Initialize(clOptions, false, false);
+
+	initDist[0] = stoi(GLOBALS::config_map["INIT_POS_DIST"]);
+	initDist[1] = stoi(GLOBALS::config_map["INIT_NEG_DIST"]);
+	initClumps = stoi(GLOBALS::config_map["INIT_CLUMPS"]);
+	initSeed = stoull(GLOBALS::config_map["INIT_SEED"]);
+
+	if (initSeed == 0) {
+		// no fixed seed so pick one and report it, the run can be repeated by putting it in the config
+		srand(time(NULL));
+		initSeed = ((cl_ulong)rand() << 32) ^ (cl_ulong)rand() ^ (cl_ulong)time(NULL);
+	}
+
+	// host force engine threads, 0 uses every CPU the topology reports
+	topology.Detect();
+	hostThreads = stoi(GLOBALS::config_map["HOST_THREADS"]);
+	if (hostThreads == 0) hostThreads = topology.CpuCount();
+	pinThreads = stoi(GLOBALS::config_map["HOST_PIN_THREADS"]) != 0;
+	hugePages = stoi(GLOBALS::config_map["HOST_HUGE_PAGES"]) != 0;
+
+	if (primBench > 0) {
+		// check the device primitives against the host
+		PrimBench bench;
+		bench.Run(&openCL, primBench);
+	}
+
+	if (hostBench > 0) {
+		// time the host force variants on the configured starting particles
+		topology.Report();
+		GenerateParticles();
+		RunHostBench();
+	}
+
+	if (hostSteps > 0) {
+		// the starting particles advanced on the CPU alone
+		topology.Report();
+		GenerateParticles();
+		RunHostSteps();
+	}
+
+	if (oocCount > 0) {
+		// direct sum over a store too big for the device, streamed through it in tiles
+		OutOfCore outOfCore;
+		outOfCore.Initialize(&openCL, oocCount, stoi(GLOBALS::config_map["OOC_TILE"]), compactParticles, initSeed);
+		outOfCore.Run(stoi(GLOBALS::config_map["OOC_STEPS"]));
+	}
+
+	if (ensembleSystems > 0) {
+		// a parameter sweep of small systems, its log and summary are the only results
+		Ensemble ensemble;
+		ensemble.Initialize(&openCL, ensembleSystems, stoi(GLOBALS::config_map["ENSEMBLE_PARTICLES"]), compactParticles,
+							initSeed, initDist[0], initClumps, stoi(GLOBALS::config_map["ENSEMBLE_DIAG"]));
+		ensemble.Run(stoi(GLOBALS::config_map["ENSEMBLE_STEPS"]));
+	}
+
+	openCL.queue.finish();
+}
+
+void StartupModes::GenerateParticles()
+{
+	if (!posPrtcls.empty() || !negPrtcls.empty()) return;
+
+	// the same initial conditions the interactive run would start from
+	ParticlePool posPool, negPool;
+	posPool.Initialize(&openCL, stoi(GLOBALS::config_map["POS_PARTICLES"]), compactParticles);
+	negPool.Initialize(&openCL, stoi(GLOBALS::config_map["NEG_PARTICLES"]), compactParticles);
+	ParticlePool* pools[2] = { &posPool, &negPool };
+
+	Timer genTimer;
+	for (cl_char s=0; s < 2; ++s) {
+		if (initDist[s] > INIT_CLUMPS) {
+			HandleFatalError(9, "Invalid initial distribution detected: "+VarToStr(initDist[s]));
+		}
+		pools[s]->Generate(s, initDist[s], initSeed, initClumps);
+	}
+	posPool.Read(posPrtcls);
+	negPool.Read(negPrtcls);
+	PrintLine("Generated "+VarToStr(posPrtcls.size()+negPrtcls.size())+" particles in "+VarToStr(genTimer.MilliCount())+" ms (seed "+VarToStr(initSeed)+")");
+}
+
+void StartupModes::RunHostBench()
+{
+	HostForce hostForce;
+	hostForce.Initialize(&topology, pinThreads, hugePages);
+	hostForce.Benchmark(posPrtcls, negPrtcls, hostBench, BENCH_REPEATS, hostThreads);
+
+	if (compactParticles) {
+		PrintLine("Compact storage error: particles are already quantized, run with COMPACT_PARTICLES=0 to measure it");
+		return;
+	}
+
+	// what the compact layout would cost on these particles, the cut-offs use the rebuilt radii
+	std::vector<cl_Particle> posPacked(posPrtcls.size()), negPacked(negPrtcls.size());
+	for (size_t i=0; i < posPrtcls.size(); ++i) posPacked[i] = ParticlePool::Unpack(ParticlePool::Pack(posPrtcls[i]));
+	for (size_t i=0; i < negPrtcls.size(); ++i) negPacked[i] = ParticlePool::Unpack(ParticlePool::Pack(negPrtcls[i]));
+	hostForce.CompareForces(posPrtcls, negPrtcls, posPacked, negPacked, hostBench, "Compact storage");
+}
+
+void StartupModes::RunHostSteps()
+{
+	// symmetric pair forces and the update both run as blocks on the task pool
+	TaskPool pool;
+	pool.Initialize(hostThreads, pinThreads ? &topology : NULL);
+
+	// the pool fills the arrays, so each block's pages land on the node of the worker that
+	// starts out owning it, and the fold and update walk the blocks with the same ownership
+	HostForce hostForce;
+	hostForce.Initialize(&topology, pinThreads, hugePages);
+	hostForce.Load(posPrtcls, negPrtcls, &pool);
+	if (hostForce.count == 0) return;
+	pool.steals = 0;
+
+	std::vector<uint32_t> usedNodes;
+	for (uint32_t w=0; w < pool.ThreadCount() && pinThreads; ++w) usedNodes.push_back(topology.WorkerNode(w));
+	std::sort(usedNodes.begin(), usedNodes.end());
+	usedNodes.erase(std::unique(usedNodes.begin(), usedNodes.end()), usedNodes.end());
+
+	Timer timer;
+	for (uint32_t s=0; s < hostSteps; ++s) {
+		hostForce.Step(pool);
+	}
+	float total = timer.MilliCount();
+
+	// rates are quoted as the full n^2 like the benchmark, the engine only visits half the pairs
+	double perStep = total / hostSteps;
+	double rate = (double)hostForce.count * hostForce.count / (std::max(perStep, 0.001) * 0.001);
+
+	std::stringstream line;
+	line << "Host steps: " << hostSteps << " steps of " << hostForce.count << " particles on " << pool.ThreadCount();
+	line << " threads";
+	if (pinThreads) line << " pinned on " << usedNodes.size() << " node(s)";
+	if (hostForce.srcX.onHugePages()) line << ", huge pages";
+	line << std::fixed << std::setprecision(3) << " | " << perStep << " ms/step | ";
+	line << std::setprecision(1) << (rate / 1e6) << " M interactions/s | steals " << (pool.steals / hostSteps);
+	PrintLine(line);
+}
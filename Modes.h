@@ -0,0 +1,39 @@
+#pragma once
+#include "OpenCL.h"
+#include "ParticlePool.h"
+#include "PrimBench.h"
+#include "HostForce.h"
+#include "OutOfCore.h"
+#include "Ensemble.h"
+#include <vector>
+
+// benchmarks and batch runs picked from the config before any window exists, they share
+// one headless OpenCL context and the program exits once the enabled ones are done
+class StartupModes
+{
+public:
+	bool Initialize();
+	void Run();
+private:
+	void GenerateParticles();
+	void RunHostBench();
+	void RunHostSteps();
+public:
+	uint32_t primBench;
+	uint32_t hostBench;
+	uint32_t hostSteps;
+	uint64_t oocCount;
+	uint32_t ensembleSystems;
+private:
+	CL openCL;
+	bool compactParticles;
+	uint32_t initDist[2];
+	cl_uint initClumps;
+	cl_ulong initSeed;
+	std::vector<cl_Particle> posPrtcls;
+	std::vector<cl_Particle> negPrtcls;
+	HostTopology topology;
+	uint32_t hostThreads;
+	bool pinThreads;
+	bool hugePages;
+};
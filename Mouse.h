@@ -1,87 +1,104 @@
-#pragma once
-#include <queue>
-#include <cstdlib>
-
-class MouseServer;
-
-class MouseEvent
-{
-public:
-	enum Type
-	{
-		LPress,
-		LRelease,
-		RPress,
-		RRelease,
-		WheelUp,
-		WheelDown,
-		Move,
-		Invalid
-	};
-private:
-	const Type type;
-	const float x;
-	const float y;
-public:
-	MouseEvent( Type type,float x,float y )
-		:
-		type( type ),
-		x( x ),
-		y( y )
-	{}
-	bool IsValid() const
-	{
-		return type != Invalid;
-	}
-	Type GetType() const
-	{
-		return type;
-	}
-	float GetX() const
-	{
-		return x;
-	}
-	float GetY() const
-	{
-		return y;
-	}
-};
-
-class MouseClient
-{
-public:
-	MouseClient( MouseServer& server );
-	float GetMouseX() const;
-	float GetMouseY() const;
-	bool LeftIsPressed() const;
-	bool RightIsPressed() const;
-	bool IsInWindow() const;
-	MouseEvent ReadMouse();
-	bool MouseEmpty() const;
-private:
-	MouseServer& server;
-};
-
-class MouseServer
-{
-	friend MouseClient;
-public:
-	MouseServer();
-	void OnMouseMove( float x,float y );
-	void OnMouseLeave();
-	void OnMouseEnter();
-	void OnLeftPressed();
-	void OnLeftReleased();
-	void OnRightPressed();
-	void OnRightReleased();
-	void OnWheelUp( float x,float y );
-	void OnWheelDown( float x,float y );
-	bool IsInWindow() const;
-private:
-	bool isInWindow;
-	bool leftIsPressed;
-	bool rightIsPressed;
-	float x, y;
-	static const int bufferSize = 4;
-	std::queue<MouseEvent> buffer;
-};
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include "EventRing.h"
+
+class MouseServer;
+
+class MouseEvent
+{
+public:
+	enum Type
+	{
+		LPress,
+		LRelease,
+		RPress,
+		RRelease,
+		WheelUp,
+		WheelDown,
+		Move,
+		Invalid
+	};
+private:
+	Type type;
+	float x;
+	float y;
+	int64_t time;
+public:
+	MouseEvent()
+		:
+		type( Invalid ),
+		x( 0 ),
+		y( 0 ),
+		time( 0 )
+	{}
+	MouseEvent( Type type,float x,float y,int64_t time = 0 )
+		:
+		type( type ),
+		x( x ),
+		y( y ),
+		time( time )
+	{}
+	bool IsValid() const
+	{
+		return type != Invalid;
+	}
+	Type GetType() const
+	{
+		return type;
+	}
+	float GetX() const
+	{
+		return x;
+	}
+	float GetY() const
+	{
+		return y;
+	}
+	int64_t GetTime() const
+	{
+		return time;
+	}
+};
+
+class MouseClient
+{
+public:
+	MouseClient( MouseServer& server );
+	float GetMouseX() const;
+	float GetMouseY() const;
+	bool LeftIsPressed() const;
+	bool RightIsPressed() const;
+	bool IsInWindow() const;
+	MouseEvent ReadMouse();
+	bool MouseEmpty() const;
+private:
+	MouseServer& server;
+};
+
+class MouseServer
+{
+	friend MouseClient;
+public:
+	MouseServer();
+	void OnMouseMove( float x,float y );
+	void OnMouseLeave();
+	void OnMouseEnter();
+	void OnLeftPressed();
+	void OnLeftReleased();
+	void OnRightPressed();
+	void OnRightReleased();
+	void OnWheelUp( float x,float y );
+	void OnWheelDown( float x,float y );
+	bool IsInWindow() const;
+private:
+	void Push( MouseEvent::Type type );
+private:
+	std::atomic<bool> isInWindow;
+	std::atomic<bool> leftIsPressed;
+	std::atomic<bool> rightIsPressed;
+	std::atomic<float> x, y;
+	static const size_t bufferSize = 256;
+	EventRing<MouseEvent,bufferSize> buffer;
+};
@@ -1,171 +1,627 @@
-#pragma once
-#define __CL_ENABLE_EXCEPTIONS
-#include <CL/cl.hpp>
-#include "CLTypes.h"
-#include "ReadWrite.h"
-#include <stdio.h>
-#include <cstdlib>
-#include <string>
-#include <iostream>
-
-#ifdef linux
-    #include <GL/glx.h>
-#endif
-
-class CL
-{
-private:
-	cl::Platform platform;
-	cl::Device device;
-	cl::Program program;
-public:
-	cl::CommandQueue queue;
-	cl::Context context;
-	cl::Kernel Init_Kernel;
-	cl::Kernel Update_Kernel;
-	cl::Kernel Draw_Kernel;
-	cl::Kernel FillF_Kernel;
-	cl::Kernel CopyF_Kernel;
-	uint32_t max_wg_size;
-public:
-	void Initialize()
-	{
-		std::cout << "Initializing OpenCL ... ";
-
-		// get all platforms (drivers)
-		std::vector<cl::Platform> platforms;
-		cl::Platform::get(&platforms);
-
-		if (platforms.size() == 0) {
-			HandleFatalError(30, "No OpenCL platforms found");
-		}
-		// select default platform
-		platform = platforms[0];
-
-		#ifdef linux
-			cl_context_properties props[] = {
-			CL_GL_CONTEXT_KHR, (cl_context_properties) glXGetCurrentContext(),
-			CL_GLX_DISPLAY_KHR, (cl_context_properties) glXGetCurrentDisplay(),
-			CL_CONTEXT_PLATFORM, (cl_context_properties)(platform)(), 0};
-		#elif defined WIN32 || defined _WIN32
-			cl_context_properties props[] = {
-			CL_GL_CONTEXT_KHR, (cl_context_properties) wglGetCurrentContext(),
-			CL_WGL_HDC_KHR, (cl_context_properties) wglGetCurrentDC(),
-			CL_CONTEXT_PLATFORM, (cl_context_properties)(platform)(), 0};
-		#elif defined(__APPLE__) || defined(MACOSX)
-			CGLContextObj glContext = CGLGetCurrentContext();
-			CGLShareGroupObj shareGroup = CGLGetShareGroup(glContext);
-			cl_context_properties props[] = {
-			CL_CONTEXT_PROPERTY_USE_CGL_SHAREGROUP_APPLE,
-			(cl_context_properties)shareGroup, 0};
-		#endif
-
-		context = cl::Context(CL_DEVICE_TYPE_GPU, props);
-
-		// get compute devices on default platform
-		std::vector<cl::Device> gpu_devices = context.getInfo<CL_CONTEXT_DEVICES>();
-		if (gpu_devices.size() == 0) {
-			HandleFatalError(31, "No supported GPU devices found");
-		}
-
-		// select a compute device
-        std::string gpu_index = GLOBALS::config_map["GPU_INDEX"];
-        if (gpu_index == "primary") {
-            device = gpu_devices[0];
-        } else {
-            size_t gi = stoi(gpu_index);
-            if (gi < platforms.size()) {
-                device = gpu_devices[gi];
-            } else {
-                HandleFatalError(32, "Invalid GPU_INDEX, check settings");
-            }
-        }
-
-		// veryify CL/GL sharing is supported on device
-		std::string dev_exts = device.getInfo<CL_DEVICE_EXTENSIONS>();
-		if (dev_exts.find(CL_GL_SHARING_EXT) == std::string::npos) {
-			HandleFatalError(35, "Device does not support CL/GL sharing");
-		} else if (device.getInfo<CL_DEVICE_IMAGE_SUPPORT>()!=CL_TRUE) {
-			HandleFatalError(36, "Device does not support OpenCL images");
-		} else {
-			std::cout << "Success!\n";
-		}
-
-		// Read kernel source file
-		cl::Program::Sources sources;
-		std::string sourceCode = ReadFileStr(GLOBALS::DATA_FOLDER+"kernels/compute.cl");
-		sources.push_back(std::make_pair(sourceCode.c_str(), sourceCode.length()+1));
-
-		// Set program source code and context
-		program = cl::Program(context, sources);
-
-		// build kernel program and check for errors
-		std::cout << "Building OpenCL kernels ... ";
-		try {
-            if (program.build(gpu_devices) != CL_SUCCESS) {
-                std::cout << "Failed!\n";
-                CLBLog("Build log: "+program.getBuildInfo<CL_PROGRAM_BUILD_LOG>(device));
-                HandleFatalError(33, "Failed building kernel program.");
-            } else {
-                std::cout << "Success!\n";
-                CLBLog("Build log: "+program.getBuildInfo<CL_PROGRAM_BUILD_LOG>(device));
-            }
-		} catch (...) {
-            std::cout << "Failed!\n";
-            CLBLog("Build log: "+program.getBuildInfo<CL_PROGRAM_BUILD_LOG>(device));
-            HandleFatalError(34, "Failed building kernel program.");
-		}
-
-		// initialize kernel objects
-		Init_Kernel = cl::Kernel(program, "GenParticles");
-		Update_Kernel = cl::Kernel(program, "UpdateParticles");
-		Draw_Kernel = cl::Kernel(program, "DrawParticles");
-		FillF_Kernel = cl::Kernel(program, "FillFragBuff");
-		CopyF_Kernel = cl::Kernel(program, "FragsToFrame");
-
-		// create queue to which we will push commands for the device
-		queue = cl::CommandQueue(context, device);
-
-		// get maximum workgroup size for device
-		max_wg_size = (cl_uint)device.getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>();
-
-		// print OpenCL info to console
-		PrintCLInfo();
-	}
-	void PrintCLInfo()
-	{
-		std::string device_name = device.getInfo<CL_DEVICE_NAME>();
-		std::string device_vendor = device.getInfo<CL_DEVICE_VENDOR>();
-		device_name.pop_back(); device_vendor.pop_back();
-
-		std::cout << "\nUsing platform: "+platform.getInfo<CL_PLATFORM_NAME>() + "\n";
-		std::cout << "Using device: "+device_name+" ("+device_vendor+")\n";
-		std::cout << "OpenCL version: "+device.getInfo<CL_DEVICE_VERSION>() + "\n";
-		std::cout << "Max parameter size: "+VarToStr((cl_uint)device.getInfo<CL_DEVICE_MAX_PARAMETER_SIZE>())+" KB\n";
-		std::cout << "Constant buffer size: "+VarToStr((cl_ulong)device.getInfo<CL_DEVICE_MAX_CONSTANT_BUFFER_SIZE>()/1024)+" KB\n";
-		std::cout << "Local memory size: "+VarToStr((cl_ulong)device.getInfo<CL_DEVICE_LOCAL_MEM_SIZE>()/1024)+" KB\n";
-		std::cout << "Global memory size: "+VarToStr((cl_ulong)device.getInfo<CL_DEVICE_GLOBAL_MEM_SIZE>()/1024/1024)+" MB\n";
-		std::cout << "Max compute units: "+VarToStr((cl_uint)device.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>()) + "\n";
-		std::cout << "Max workgroup size: "+VarToStr(max_wg_size) + "\n\n";
-	}
-	void GenParticles(uint32_t particles)
-	{
-		queue.enqueueNDRangeKernel(Init_Kernel, cl::NullRange, cl::NDRange(particles));
-	}
-	void UpdateParticles(uint32_t particles)
-	{
-		queue.enqueueNDRangeKernel(Update_Kernel, cl::NullRange, cl::NDRange(particles));
-	}
-	void DrawParticles(uint32_t particles)
-	{
-		queue.enqueueNDRangeKernel(Draw_Kernel, cl::NullRange, cl::NDRange(particles));
-	}
-	void FillFragBuff(uint32_t ww, uint32_t wh)
-	{
-		queue.enqueueNDRangeKernel(FillF_Kernel, cl::NullRange, cl::NDRange(ww, wh));
-	}
-	void FragsToFrame(uint32_t ww, uint32_t wh)
-	{
-		queue.enqueueNDRangeKernel(CopyF_Kernel, cl::NullRange, cl::NDRange(ww, wh));
-	}
-};
+#pragma once
+#define __CL_ENABLE_EXCEPTIONS
+#include <CL/cl.hpp>
+#include "CLTypes.h"
+#include "ReadWrite.h"
+#include <stdio.h>
+#include <cstdlib>
+#include <string>
+#include <iostream>
+#include <algorithm>
+
+#ifdef linux
+    #include <GL/glx.h>
+#endif
+
+typedef cl_event (CL_API_CALL *CLEventFromGLsync)(cl_context, cl_GLsync, cl_int*);
+
+class CL
+{
+private:
+	cl::Platform platform;
+	cl::Device device;
+	cl::Program program;
+	std::vector<cl::Buffer> scan_sums;
+	std::vector<uint32_t> scan_sizes;
+	cl::Buffer radix_hist;
+	uint32_t radix_size;
+	cl::Buffer compact_pos;
+	cl::Buffer compact_count;
+	uint32_t compact_size;
+	cl::Buffer reduce_parts;
+public:
+	cl::CommandQueue queue;
+	cl::CommandQueue transfer_queue;
+	cl::Context context;
+	cl::Kernel Init_Kernel;
+	cl::Kernel Update_Kernel;
+	cl::Kernel Substep_Kernel;
+	cl::Kernel Fused_Kernel;
+	cl::Kernel Draw_Kernel;
+	cl::Kernel FillF_Kernel;
+	cl::Kernel CopyF_Kernel;
+	cl::Kernel Commit_Kernel;
+	cl::Kernel Cull_Kernel;
+	cl::Kernel DrawV_Kernel;
+	cl::Kernel FillD_Kernel;
+	cl::Kernel Splat_Kernel;
+	cl::Kernel Hist_Kernel;
+	cl::Kernel Expo_Kernel;
+	cl::Kernel CopyD_Kernel;
+	cl::Kernel TAA_Kernel;
+	cl::Kernel Move_Kernel;
+	cl::Kernel Merge_Kernel;
+	cl::Kernel ScanB_Kernel;
+	cl::Kernel AddB_Kernel;
+	cl::Kernel RadixC_Kernel;
+	cl::Kernel RadixS_Kernel;
+	cl::Kernel RadixC64_Kernel;
+	cl::Kernel RadixS64_Kernel;
+	cl::Kernel Compact_Kernel;
+	cl::Kernel Reduce_Kernel;
+	cl::Kernel SegRed_Kernel;
+	cl::Kernel GridR_Kernel;
+	cl::Kernel GridS_Kernel;
+	cl::Kernel GridK_Kernel;
+	cl::Kernel GridC_Kernel;
+	cl::Kernel Collide_Kernel;
+	cl::Kernel Bounce_Kernel;
+	cl::Kernel Pairs_Kernel;
+	cl::Kernel Curve_Kernel;
+	cl::Kernel Gather_Kernel;
+	cl::Kernel DiagT_Kernel;
+	cl::Kernel DiagP_Kernel;
+	cl::Kernel StreamF_Kernel;
+	cl::Kernel StreamI_Kernel;
+	cl::Kernel EnsG_Kernel;
+	cl::Kernel EnsU_Kernel;
+	cl::Kernel EnsD_Kernel;
+	cl::Kernel AnaT_Kernel;
+	cl::Kernel AnaS_Kernel;
+	cl::Kernel AnaH_Kernel;
+	cl::Kernel AnaP_Kernel;
+	cl::Kernel MeshD_Kernel;
+	cl::Kernel MeshF_Kernel;
+	cl::Kernel MeshP_Kernel;
+	cl::Kernel FofI_Kernel;
+	cl::Kernel FofL_Kernel;
+	cl::Kernel FofJ_Kernel;
+	cl::Kernel FofG_Kernel;
+	cl::Kernel FofC_Kernel;
+	uint32_t max_wg_size;
+	uint32_t substep_wg_size;
+	cl_ulong local_mem_size;
+	CLEventFromGLsync EventFromGLsync;
+public:
+	void Initialize(const std::string& build_opts, bool profiling, bool glSharing = true)
+	{
+		std::cout << "Initializing OpenCL ... ";
+
+		// get all platforms (drivers)
+		std::vector<cl::Platform> platforms;
+		cl::Platform::get(&platforms);
+
+		if (platforms.size() == 0) {
+			HandleFatalError(30, "No OpenCL platforms found");
+		}
+		// select default platform
+		platform = platforms[0];
+
+		// batch modes run before any window exists, their context only names the platform
+		cl_context_properties headless[] = {CL_CONTEXT_PLATFORM, (cl_context_properties)(platform)(), 0};
+
+		#ifdef linux
+			cl_context_properties props[] = {
+			CL_GL_CONTEXT_KHR, (cl_context_properties) glXGetCurrentContext(),
+			CL_GLX_DISPLAY_KHR, (cl_context_properties) glXGetCurrentDisplay(),
+			CL_CONTEXT_PLATFORM, (cl_context_properties)(platform)(), 0};
+		#elif defined WIN32 || defined _WIN32
+			cl_context_properties props[] = {
+			CL_GL_CONTEXT_KHR, (cl_context_properties) wglGetCurrentContext(),
+			CL_WGL_HDC_KHR, (cl_context_properties) wglGetCurrentDC(),
+			CL_CONTEXT_PLATFORM, (cl_context_properties)(platform)(), 0};
+		#elif defined(__APPLE__) || defined(MACOSX)
+			CGLContextObj glContext = CGLGetCurrentContext();
+			CGLShareGroupObj shareGroup = CGLGetShareGroup(glContext);
+			cl_context_properties props[] = {
+			CL_CONTEXT_PROPERTY_USE_CGL_SHAREGROUP_APPLE,
+			(cl_context_properties)shareGroup, 0};
+		#endif
+
+		context = cl::Context(CL_DEVICE_TYPE_GPU, glSharing ? props : headless);
+
+		// get compute devices on default platform
+		std::vector<cl::Device> gpu_devices = context.getInfo<CL_CONTEXT_DEVICES>();
+		if (gpu_devices.size() == 0) {
+			HandleFatalError(31, "No supported GPU devices found");
+		}
+
+		// select a compute device
+        std::string gpu_index = GLOBALS::config_map["GPU_INDEX"];
+        if (gpu_index == "primary") {
+            device = gpu_devices[0];
+        } else {
+            size_t gi = stoi(gpu_index);
+            if (gi < platforms.size()) {
+                device = gpu_devices[gi];
+            } else {
+                HandleFatalError(32, "Invalid GPU_INDEX, check settings");
+            }
+        }
+
+		// veryify CL/GL sharing is supported on device
+		std::string dev_exts = device.getInfo<CL_DEVICE_EXTENSIONS>();
+		if (!glSharing) {
+			std::cout << "Success!\n";
+		} else if (dev_exts.find(CL_GL_SHARING_EXT) == std::string::npos) {
+			HandleFatalError(35, "Device does not support CL/GL sharing");
+		} else if (device.getInfo<CL_DEVICE_IMAGE_SUPPORT>()!=CL_TRUE) {
+			HandleFatalError(36, "Device does not support OpenCL images");
+		} else {
+			std::cout << "Success!\n";
+		}
+
+		// CL can wait on GL fences directly if cl_khr_gl_event is supported
+		EventFromGLsync = NULL;
+		if (glSharing && dev_exts.find("cl_khr_gl_event") != std::string::npos) {
+			EventFromGLsync = (CLEventFromGLsync)clGetExtensionFunctionAddressForPlatform(platform(), "clCreateEventFromGLsyncKHR");
+		}
+
+		// Read kernel source files, the primitives come first so compute.cl can use them
+		cl::Program::Sources sources;
+		std::string primsCode = ReadFileStr(GLOBALS::DATA_FOLDER+"kernels/primitives.cl");
+		std::string sourceCode = ReadFileStr(GLOBALS::DATA_FOLDER+"kernels/compute.cl");
+		sources.push_back(std::make_pair(primsCode.c_str(), primsCode.length()));
+		sources.push_back(std::make_pair(sourceCode.c_str(), sourceCode.length()+1));
+
+		// Set program source code and context
+		program = cl::Program(context, sources);
+
+		// build kernel program and check for errors
+		std::cout << "Building OpenCL kernels ... ";
+		try {
+            if (program.build(gpu_devices, build_opts.c_str()) != CL_SUCCESS) {
+                std::cout << "Failed!\n";
+                CLBLog("Build log: "+program.getBuildInfo<CL_PROGRAM_BUILD_LOG>(device));
+                HandleFatalError(33, "Failed building kernel program.");
+            } else {
+                std::cout << "Success!\n";
+                CLBLog("Build log: "+program.getBuildInfo<CL_PROGRAM_BUILD_LOG>(device));
+            }
+		} catch (...) {
+            std::cout << "Failed!\n";
+            CLBLog("Build log: "+program.getBuildInfo<CL_PROGRAM_BUILD_LOG>(device));
+            HandleFatalError(34, "Failed building kernel program.");
+		}
+
+		// initialize kernel objects
+		Init_Kernel = cl::Kernel(program, "GenParticles");
+		Update_Kernel = cl::Kernel(program, "UpdateParticles");
+		Substep_Kernel = cl::Kernel(program, "UpdateSubsteps");
+		Fused_Kernel = cl::Kernel(program, "UpdateAndProject");
+		Draw_Kernel = cl::Kernel(program, "DrawParticles");
+		FillF_Kernel = cl::Kernel(program, "FillFragBuff");
+		CopyF_Kernel = cl::Kernel(program, "FragsToFrame");
+		Commit_Kernel = cl::Kernel(program, "CommitParticles");
+		Cull_Kernel = cl::Kernel(program, "CullParticles");
+		DrawV_Kernel = cl::Kernel(program, "DrawVisible");
+		FillD_Kernel = cl::Kernel(program, "FillDensBuff");
+		Splat_Kernel = cl::Kernel(program, "SplatParticles");
+		Hist_Kernel = cl::Kernel(program, "DensityHistogram");
+		Expo_Kernel = cl::Kernel(program, "DensityExposure");
+		CopyD_Kernel = cl::Kernel(program, "DensityToFrame");
+		TAA_Kernel = cl::Kernel(program, "TemporalResolve");
+		Move_Kernel = cl::Kernel(program, "MoveParticles");
+		Merge_Kernel = cl::Kernel(program, "MergeParticles");
+		ScanB_Kernel = cl::Kernel(program, "ScanBlocks");
+		AddB_Kernel = cl::Kernel(program, "AddBlockSums");
+		RadixC_Kernel = cl::Kernel(program, "RadixCount");
+		RadixS_Kernel = cl::Kernel(program, "RadixScatter");
+		RadixC64_Kernel = cl::Kernel(program, "RadixCount64");
+		RadixS64_Kernel = cl::Kernel(program, "RadixScatter64");
+		Compact_Kernel = cl::Kernel(program, "CompactValues");
+		Reduce_Kernel = cl::Kernel(program, "ReduceBlocks");
+		SegRed_Kernel = cl::Kernel(program, "SegmentedReduce");
+		GridR_Kernel = cl::Kernel(program, "GridMaxRadius");
+		GridS_Kernel = cl::Kernel(program, "GridSetup");
+		GridK_Kernel = cl::Kernel(program, "GridKeys");
+		GridC_Kernel = cl::Kernel(program, "GridCells");
+		Collide_Kernel = cl::Kernel(program, "CollideParticles");
+		Bounce_Kernel = cl::Kernel(program, "ApplyCollisions");
+		Pairs_Kernel = cl::Kernel(program, "MergePairs");
+		Curve_Kernel = cl::Kernel(program, "CurveKeys");
+		Gather_Kernel = cl::Kernel(program, "GatherParticles");
+		DiagT_Kernel = cl::Kernel(program, "DiagnosticTerms");
+		DiagP_Kernel = cl::Kernel(program, "DiagnosticPotential");
+		StreamF_Kernel = cl::Kernel(program, "StreamForces");
+		StreamI_Kernel = cl::Kernel(program, "StreamIntegrate");
+		EnsG_Kernel = cl::Kernel(program, "EnsembleGenerate");
+		EnsU_Kernel = cl::Kernel(program, "EnsembleUpdate");
+		EnsD_Kernel = cl::Kernel(program, "EnsembleDiagnostics");
+		AnaT_Kernel = cl::Kernel(program, "AnalysisTerms");
+		AnaS_Kernel = cl::Kernel(program, "AnalysisStats");
+		AnaH_Kernel = cl::Kernel(program, "AnalysisHistograms");
+		AnaP_Kernel = cl::Kernel(program, "AnalysisPairs");
+		MeshD_Kernel = cl::Kernel(program, "MeshDelta");
+		MeshF_Kernel = cl::Kernel(program, "MeshDFT");
+		MeshP_Kernel = cl::Kernel(program, "MeshPower");
+		FofI_Kernel = cl::Kernel(program, "FofInit");
+		FofL_Kernel = cl::Kernel(program, "FofLink");
+		FofJ_Kernel = cl::Kernel(program, "FofJump");
+		FofG_Kernel = cl::Kernel(program, "FofGroups");
+		FofC_Kernel = cl::Kernel(program, "FofCatalogue");
+
+		// create queue to which we will push commands for the device
+		// profiling lets the stats report time spent in individual kernels
+		queue = cl::CommandQueue(context, device, profiling ? CL_QUEUE_PROFILING_ENABLE : 0);
+		// separate in-order queue so streamed copies can overlap kernels, always profiled for the bandwidth report
+		transfer_queue = cl::CommandQueue(context, device, CL_QUEUE_PROFILING_ENABLE);
+
+		// get maximum workgroup size for device
+		max_wg_size = (cl_uint)device.getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>();
+		// the substep kernel holds the whole set in one group so its own limits decide when it can run
+		substep_wg_size = (cl_uint)Substep_Kernel.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device);
+		local_mem_size = device.getInfo<CL_DEVICE_LOCAL_MEM_SIZE>();
+		radix_size = 0;
+		compact_size = 0;
+		compact_count = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(cl_uint));
+		reduce_parts = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(cl_double)*REDUCE_GROUPS);
+
+		// print OpenCL info to console
+		PrintCLInfo();
+	}
+	void PrintCLInfo()
+	{
+		std::string device_name = device.getInfo<CL_DEVICE_NAME>();
+		std::string device_vendor = device.getInfo<CL_DEVICE_VENDOR>();
+		device_name.pop_back(); device_vendor.pop_back();
+
+		std::cout << "\nUsing platform: "+platform.getInfo<CL_PLATFORM_NAME>() + "\n";
+		std::cout << "Using device: "+device_name+" ("+device_vendor+")\n";
+		std::cout << "OpenCL version: "+device.getInfo<CL_DEVICE_VERSION>() + "\n";
+		std::cout << "Max parameter size: "+VarToStr((cl_uint)device.getInfo<CL_DEVICE_MAX_PARAMETER_SIZE>())+" KB\n";
+		std::cout << "Constant buffer size: "+VarToStr((cl_ulong)device.getInfo<CL_DEVICE_MAX_CONSTANT_BUFFER_SIZE>()/1024)+" KB\n";
+		std::cout << "Local memory size: "+VarToStr((cl_ulong)device.getInfo<CL_DEVICE_LOCAL_MEM_SIZE>()/1024)+" KB\n";
+		std::cout << "Global memory size: "+VarToStr((cl_ulong)device.getInfo<CL_DEVICE_GLOBAL_MEM_SIZE>()/1024/1024)+" MB\n";
+		std::cout << "Max compute units: "+VarToStr((cl_uint)device.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>()) + "\n";
+		std::cout << "Max workgroup size: "+VarToStr(max_wg_size) + "\n\n";
+	}
+	void GenParticles(uint32_t particles)
+	{
+		if (particles == 0) return;
+		queue.enqueueNDRangeKernel(Init_Kernel, cl::NullRange, cl::NDRange(particles));
+	}
+	void UpdateParticles(uint32_t particles, cl::Event* event = NULL)
+	{
+		if (particles == 0) return;
+		queue.enqueueNDRangeKernel(Update_Kernel, cl::NullRange, cl::NDRange(particles), cl::NullRange, NULL, event);
+	}
+	void UpdateSubsteps(uint32_t groupSize, cl::Event* event = NULL)
+	{
+		if (groupSize == 0) return;
+		queue.enqueueNDRangeKernel(Substep_Kernel, cl::NullRange, cl::NDRange(groupSize), cl::NDRange(groupSize), NULL, event);
+	}
+	void DrawParticles(uint32_t particles, cl::Event* event = NULL)
+	{
+		if (particles == 0) return;
+		queue.enqueueNDRangeKernel(Draw_Kernel, cl::NullRange, cl::NDRange(particles), cl::NullRange, NULL, event);
+	}
+	void CullParticles(uint32_t particles, cl::Event* event = NULL)
+	{
+		if (particles == 0) return;
+		uint32_t groups = (particles + CULL_WG_SIZE - 1) / CULL_WG_SIZE;
+		queue.enqueueNDRangeKernel(Cull_Kernel, cl::NullRange, cl::NDRange(groups * CULL_WG_SIZE), cl::NDRange(CULL_WG_SIZE), NULL, event);
+	}
+	void UpdateAndProject(uint32_t particles, cl::Event* event = NULL)
+	{
+		if (particles == 0) return;
+		uint32_t groups = (particles + CULL_WG_SIZE - 1) / CULL_WG_SIZE;
+		queue.enqueueNDRangeKernel(Fused_Kernel, cl::NullRange, cl::NDRange(groups * CULL_WG_SIZE), cl::NDRange(CULL_WG_SIZE), NULL, event);
+	}
+	void DrawVisible(uint32_t first, uint32_t count, cl::Event* event = NULL)
+	{
+		queue.enqueueNDRangeKernel(DrawV_Kernel, cl::NDRange(first), cl::NDRange(count), cl::NullRange, NULL, event);
+	}
+	void CommitParticles(uint32_t particles)
+	{
+		if (particles == 0) return;
+		queue.enqueueNDRangeKernel(Commit_Kernel, cl::NullRange, cl::NDRange(particles));
+	}
+	void CurveKeys(uint32_t particles)
+	{
+		if (particles == 0) return;
+		queue.enqueueNDRangeKernel(Curve_Kernel, cl::NullRange, cl::NDRange(particles));
+	}
+	void GatherParticles(uint32_t particles)
+	{
+		if (particles == 0) return;
+		queue.enqueueNDRangeKernel(Gather_Kernel, cl::NullRange, cl::NDRange(particles));
+	}
+	void DiagnosticTerms()
+	{
+		queue.enqueueNDRangeKernel(DiagT_Kernel, cl::NullRange, cl::NDRange(DIAG_GROUPS * SCAN_WG), cl::NDRange(SCAN_WG));
+	}
+	void DiagnosticPotential()
+	{
+		queue.enqueueNDRangeKernel(DiagP_Kernel, cl::NullRange, cl::NDRange(DIAG_GROUPS * SCAN_WG), cl::NDRange(SCAN_WG));
+	}
+	void StreamForces(uint32_t targets, const std::vector<cl::Event>* waits, cl::Event* event)
+	{
+		uint32_t groups = (targets + SCAN_WG - 1) / SCAN_WG;
+		queue.enqueueNDRangeKernel(StreamF_Kernel, cl::NullRange, cl::NDRange(groups * SCAN_WG), cl::NDRange(SCAN_WG), waits, event);
+	}
+	void StreamIntegrate(uint32_t targets, cl::Event* event)
+	{
+		uint32_t groups = (targets + SCAN_WG - 1) / SCAN_WG;
+		queue.enqueueNDRangeKernel(StreamI_Kernel, cl::NullRange, cl::NDRange(groups * SCAN_WG), cl::NDRange(SCAN_WG), NULL, event);
+	}
+	void EnsembleGenerate(uint32_t particles)
+	{
+		if (particles == 0) return;
+		queue.enqueueNDRangeKernel(EnsG_Kernel, cl::NullRange, cl::NDRange(particles));
+	}
+	void EnsembleUpdate(uint32_t particles)
+	{
+		if (particles == 0) return;
+		queue.enqueueNDRangeKernel(EnsU_Kernel, cl::NullRange, cl::NDRange(particles));
+	}
+	void EnsembleDiagnostics(uint32_t systems)
+	{
+		queue.enqueueNDRangeKernel(EnsD_Kernel, cl::NullRange, cl::NDRange(systems * SCAN_WG), cl::NDRange(SCAN_WG));
+	}
+	void AnalysisTerms()
+	{
+		queue.enqueueNDRangeKernel(AnaT_Kernel, cl::NullRange, cl::NDRange(ANA_GROUPS * SCAN_WG), cl::NDRange(SCAN_WG));
+	}
+	void AnalysisStats()
+	{
+		queue.enqueueNDRangeKernel(AnaS_Kernel, cl::NullRange, cl::NDRange(2));
+	}
+	void AnalysisHistograms(uint32_t particles)
+	{
+		if (particles == 0) return;
+		uint32_t groups = (particles + SCAN_WG - 1) / SCAN_WG;
+		queue.enqueueNDRangeKernel(AnaH_Kernel, cl::NullRange, cl::NDRange(groups * SCAN_WG), cl::NDRange(SCAN_WG));
+	}
+	void AnalysisPairs(uint32_t particles)
+	{
+		if (particles == 0) return;
+		uint32_t groups = (particles + SCAN_WG - 1) / SCAN_WG;
+		queue.enqueueNDRangeKernel(AnaP_Kernel, cl::NullRange, cl::NDRange(groups * SCAN_WG), cl::NDRange(SCAN_WG));
+	}
+	void MeshDelta()
+	{
+		queue.enqueueNDRangeKernel(MeshD_Kernel, cl::NullRange, cl::NDRange(ANA_CELLS));
+	}
+	void MeshDFT()
+	{
+		queue.enqueueNDRangeKernel(MeshF_Kernel, cl::NullRange, cl::NDRange(ANA_CELLS));
+	}
+	void MeshPower()
+	{
+		queue.enqueueNDRangeKernel(MeshP_Kernel, cl::NullRange, cl::NDRange(ANA_K_BINS));
+	}
+	void FofInit(uint32_t particles)
+	{
+		queue.enqueueNDRangeKernel(FofI_Kernel, cl::NullRange, cl::NDRange(particles));
+	}
+	void FofLink(uint32_t particles)
+	{
+		queue.enqueueNDRangeKernel(FofL_Kernel, cl::NullRange, cl::NDRange(particles));
+	}
+	void FofJump(uint32_t particles)
+	{
+		queue.enqueueNDRangeKernel(FofJ_Kernel, cl::NullRange, cl::NDRange(particles));
+	}
+	void FofGroups(uint32_t particles)
+	{
+		queue.enqueueNDRangeKernel(FofG_Kernel, cl::NullRange, cl::NDRange(particles));
+	}
+	void FofCatalogue(uint32_t groups)
+	{
+		if (groups == 0) return;
+		queue.enqueueNDRangeKernel(FofC_Kernel, cl::NullRange, cl::NDRange(groups * SCAN_WG), cl::NDRange(SCAN_WG));
+	}
+	float EventTime(const cl::Event& event)
+	{
+		cl_ulong start = event.getProfilingInfo<CL_PROFILING_COMMAND_START>();
+		cl_ulong end = event.getProfilingInfo<CL_PROFILING_COMMAND_END>();
+		return (end - start) * 0.000001f;
+	}
+	void MoveParticles(uint32_t moves)
+	{
+		queue.enqueueNDRangeKernel(Move_Kernel, cl::NullRange, cl::NDRange(moves));
+	}
+	void MergeParticles(uint32_t merges)
+	{
+		queue.enqueueNDRangeKernel(Merge_Kernel, cl::NullRange, cl::NDRange(merges));
+	}
+	void ScanExclusive(cl::Buffer data, uint32_t count, uint32_t level = 0)
+	{
+		// data is held by value, the recursion passes a scan_sums entry that a deeper level may reallocate
+		if (count == 0) return;
+		uint32_t groups = (count + SCAN_BLOCK - 1) / SCAN_BLOCK;
+
+		// one block sum buffer per level, kept between calls
+		if (scan_sums.size() <= level) {
+			scan_sums.resize(level+1);
+			scan_sizes.resize(level+1, 0);
+		}
+		if (scan_sizes[level] < groups) {
+			scan_sums[level] = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(cl_uint)*groups);
+			scan_sizes[level] = groups;
+		}
+
+		ScanB_Kernel.setArg(0, data);
+		ScanB_Kernel.setArg(1, scan_sums[level]);
+		ScanB_Kernel.setArg(2, count);
+		queue.enqueueNDRangeKernel(ScanB_Kernel, cl::NullRange, cl::NDRange(groups * SCAN_WG), cl::NDRange(SCAN_WG));
+
+		// scan the block sums then add them back to each block
+		if (groups > 1) {
+			ScanExclusive(scan_sums[level], groups, level+1);
+			AddB_Kernel.setArg(0, data);
+			AddB_Kernel.setArg(1, scan_sums[level]);
+			AddB_Kernel.setArg(2, count);
+			queue.enqueueNDRangeKernel(AddB_Kernel, cl::NullRange, cl::NDRange(groups * SCAN_WG), cl::NDRange(SCAN_WG));
+		}
+	}
+	uint32_t Compact(const cl::Buffer& values, const cl::Buffer& flags, const cl::Buffer& output, uint32_t count)
+	{
+		if (count == 0) return 0;
+		cl_uint kept = 0;
+
+		if (compact_size < count) {
+			compact_pos = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(cl_uint)*count);
+			compact_size = count;
+		}
+
+		// scan a copy of the 0/1 flags into output slots then scatter the kept values
+		queue.enqueueCopyBuffer(flags, compact_pos, 0, 0, sizeof(cl_uint)*count);
+		ScanExclusive(compact_pos, count);
+
+		Compact_Kernel.setArg(0, values);
+		Compact_Kernel.setArg(1, flags);
+		Compact_Kernel.setArg(2, compact_pos);
+		Compact_Kernel.setArg(3, output);
+		Compact_Kernel.setArg(4, compact_count);
+		Compact_Kernel.setArg(5, count);
+		queue.enqueueNDRangeKernel(Compact_Kernel, cl::NullRange, cl::NDRange(count));
+
+		queue.enqueueReadBuffer(compact_count, CL_TRUE, 0, sizeof(cl_uint), &kept);
+		return kept;
+	}
+	void Reduce(const cl::Buffer& values, uint32_t count, cl_uint op, const cl::Buffer& result)
+	{
+		uint32_t groups = std::min((count + SCAN_WG - 1) / SCAN_WG, (uint32_t)REDUCE_GROUPS);
+		groups = std::max(groups, (uint32_t)1);
+
+		// fixed number of partials so a single group can always finish the job
+		Reduce_Kernel.setArg(0, values);
+		Reduce_Kernel.setArg(1, reduce_parts);
+		Reduce_Kernel.setArg(2, count);
+		Reduce_Kernel.setArg(3, op);
+		queue.enqueueNDRangeKernel(Reduce_Kernel, cl::NullRange, cl::NDRange(groups * SCAN_WG), cl::NDRange(SCAN_WG));
+
+		Reduce_Kernel.setArg(0, reduce_parts);
+		Reduce_Kernel.setArg(1, result);
+		Reduce_Kernel.setArg(2, groups);
+		queue.enqueueNDRangeKernel(Reduce_Kernel, cl::NullRange, cl::NDRange(SCAN_WG), cl::NDRange(SCAN_WG));
+	}
+	void SegmentedReduce(const cl::Buffer& values, const cl::Buffer& seg_offsets, uint32_t segments, cl_uint op, const cl::Buffer& results)
+	{
+		if (segments == 0) return;
+
+		// seg_offsets holds segments+1 entries, segment s covers [offsets[s], offsets[s+1])
+		SegRed_Kernel.setArg(0, values);
+		SegRed_Kernel.setArg(1, seg_offsets);
+		SegRed_Kernel.setArg(2, results);
+		SegRed_Kernel.setArg(3, op);
+		queue.enqueueNDRangeKernel(SegRed_Kernel, cl::NullRange, cl::NDRange(segments * SCAN_WG), cl::NDRange(SCAN_WG));
+	}
+	void RadixSort(cl::Buffer& keys, cl::Buffer& vals, cl::Buffer& tmp_keys, cl::Buffer& tmp_vals, uint32_t count, uint32_t key_bits)
+	{
+		RadixPasses(RadixC_Kernel, RadixS_Kernel, keys, vals, tmp_keys, tmp_vals, count, key_bits);
+	}
+	void RadixSort64(cl::Buffer& keys, cl::Buffer& vals, cl::Buffer& tmp_keys, cl::Buffer& tmp_vals, uint32_t count, uint32_t key_bits)
+	{
+		RadixPasses(RadixC64_Kernel, RadixS64_Kernel, keys, vals, tmp_keys, tmp_vals, count, key_bits);
+	}
+	void RadixPasses(cl::Kernel& count_kernel, cl::Kernel& scatter_kernel, cl::Buffer& keys, cl::Buffer& vals,
+					 cl::Buffer& tmp_keys, cl::Buffer& tmp_vals, uint32_t count, uint32_t key_bits)
+	{
+		if (count == 0) return;
+		uint32_t threads = (count + RADIX_ITEMS - 1) / RADIX_ITEMS;
+
+		if (radix_size < threads) {
+			radix_hist = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(cl_uint)*RADIX_BINS*threads);
+			radix_size = threads;
+		}
+
+		// stable LSD passes, the sorted data always ends up in keys and vals
+		for (uint32_t shift=0; shift < key_bits; shift += RADIX_BITS) {
+			count_kernel.setArg(0, keys);
+			count_kernel.setArg(1, radix_hist);
+			count_kernel.setArg(2, count);
+			count_kernel.setArg(3, shift);
+			queue.enqueueNDRangeKernel(count_kernel, cl::NullRange, cl::NDRange(threads));
+
+			ScanExclusive(radix_hist, RADIX_BINS*threads);
+
+			scatter_kernel.setArg(0, keys);
+			scatter_kernel.setArg(1, vals);
+			scatter_kernel.setArg(2, tmp_keys);
+			scatter_kernel.setArg(3, tmp_vals);
+			scatter_kernel.setArg(4, radix_hist);
+			scatter_kernel.setArg(5, count);
+			scatter_kernel.setArg(6, shift);
+			queue.enqueueNDRangeKernel(scatter_kernel, cl::NullRange, cl::NDRange(threads));
+
+			std::swap(keys, tmp_keys);
+			std::swap(vals, tmp_vals);
+		}
+	}
+	void GridMaxRadius(uint32_t particles)
+	{
+		if (particles == 0) return;
+		queue.enqueueNDRangeKernel(GridR_Kernel, cl::NullRange, cl::NDRange(particles));
+	}
+	void GridSetup()
+	{
+		queue.enqueueNDRangeKernel(GridS_Kernel, cl::NullRange, cl::NDRange(1));
+	}
+	void GridKeys(uint32_t particles)
+	{
+		if (particles == 0) return;
+		queue.enqueueNDRangeKernel(GridK_Kernel, cl::NullRange, cl::NDRange(particles));
+	}
+	void GridCells(uint32_t particles)
+	{
+		queue.enqueueNDRangeKernel(GridC_Kernel, cl::NullRange, cl::NDRange(particles));
+	}
+	void CollideParticles(uint32_t particles)
+	{
+		queue.enqueueNDRangeKernel(Collide_Kernel, cl::NullRange, cl::NDRange(particles));
+	}
+	void ApplyCollisions(uint32_t particles)
+	{
+		queue.enqueueNDRangeKernel(Bounce_Kernel, cl::NullRange, cl::NDRange(particles));
+	}
+	void MergePairs(uint32_t particles)
+	{
+		queue.enqueueNDRangeKernel(Pairs_Kernel, cl::NullRange, cl::NDRange(particles));
+	}
+	void FillFragBuff(uint32_t ww, uint32_t wh)
+	{
+		queue.enqueueNDRangeKernel(FillF_Kernel, cl::NullRange, cl::NDRange(ww, wh));
+	}
+	void FragsToFrame(uint32_t ww, uint32_t wh)
+	{
+		queue.enqueueNDRangeKernel(CopyF_Kernel, cl::NullRange, cl::NDRange(ww, wh));
+	}
+	void FillDensBuff(uint32_t ww, uint32_t wh)
+	{
+		queue.enqueueNDRangeKernel(FillD_Kernel, cl::NullRange, cl::NDRange(ww, wh));
+	}
+	void SplatParticles(uint32_t particles, cl::Event* event = NULL)
+	{
+		if (particles == 0) return;
+		queue.enqueueNDRangeKernel(Splat_Kernel, cl::NullRange, cl::NDRange(particles), cl::NullRange, NULL, event);
+	}
+	void DensityHistogram(uint32_t ww, uint32_t wh)
+	{
+		queue.enqueueNDRangeKernel(Hist_Kernel, cl::NullRange, cl::NDRange(ww, wh));
+	}
+	void DensityExposure()
+	{
+		queue.enqueueNDRangeKernel(Expo_Kernel, cl::NullRange, cl::NDRange(1));
+	}
+	void DensityToFrame(uint32_t ww, uint32_t wh)
+	{
+		queue.enqueueNDRangeKernel(CopyD_Kernel, cl::NullRange, cl::NDRange(ww, wh));
+	}
+	void TemporalResolve(uint32_t ww, uint32_t wh)
+	{
+		queue.enqueueNDRangeKernel(TAA_Kernel, cl::NullRange, cl::NDRange(ww, wh));
+	}
+};
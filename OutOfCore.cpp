@@ -0,0 +1,279 @@
+#include "OutOfCore.h"
+#include "ParticlePool.h"
+#include "Timer.h"
+#include <random>
+#include <sstream>
+#include <iomanip>
+#include <cstring>
+
+#ifdef _WIN32
+	#include <windows.h>
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+OutOfCore::OutOfCore() : perSpecies(0), tileSize(0), stride(0), openCL(NULL), compact(false), header(NULL), base(NULL), mapBytes(0)
+{
+#ifdef _WIN32
+	fileHandle = NULL;
+	mapHandle = NULL;
+#else
+	fileDesc = -1;
+#endif
+	for (int s=0; s < OOC_SLOTS; ++s) {
+		stagePtr[s] = NULL;
+		slotBusy[s] = false;
+	}
+	blockBusy = false;
+	tileIndex = 0;
+}
+
+OutOfCore::~OutOfCore()
+{
+	for (int s=0; s < OOC_SLOTS; ++s) {
+		if (stagePtr[s] != NULL) openCL->queue.enqueueUnmapMemObject(stageBuff[s], stagePtr[s]);
+	}
+	if (openCL != NULL) openCL->queue.finish();
+	Unmap();
+}
+
+void OutOfCore::Initialize(CL* pOpenCL, uint64_t speciesCount, uint32_t tileCount, bool compactStorage, uint64_t seed)
+{
+	openCL = pOpenCL;
+	compact = compactStorage;
+	stride = compact ? sizeof(cl_CompactParticle) : sizeof(cl_Particle);
+	perSpecies = speciesCount;
+	tileSize = (uint32_t)std::min((uint64_t)std::max(tileCount, (uint32_t)SCAN_WG), perSpecies);
+
+	// the file is sized up front, pages only come into memory as tiles touch them
+	MapStore(GLOBALS::DATA_FOLDER+OOC_STORE, sizeof(OocHeader) + stride * 2 * perSpecies);
+	header = (OocHeader*)base;
+
+	if (header->magic != OOC_MAGIC || header->stride != stride || header->count != perSpecies) {
+		Timer genTimer;
+		Generate(seed);
+		header->magic = OOC_MAGIC;
+		header->stride = stride;
+		header->count = perSpecies;
+		header->step = 0;
+		PrintLine("Out-of-core store: generated "+VarToStr(2*perSpecies)+" particles in "+VarToStr(genTimer.MilliCount())+" ms");
+	} else {
+		PrintLine("Out-of-core store: resuming "+VarToStr(2*perSpecies)+" particles at step "+VarToStr(header->step));
+	}
+	PrintLine("Out-of-core store: "+VarToStr(mapBytes >> 20)+" MB on disk, "+VarToStr(tileSize)+" particle tiles, "+
+			  VarToStr((stride * tileSize * (OOC_SLOTS+1) + sizeof(cl_double4) * tileSize) >> 20)+" MB resident on the device");
+
+	std::vector<cl_double4> zeros(tileSize);
+	memset(zeros.data(), 0, sizeof(cl_double4) * tileSize);
+	targetBuff = cl::Buffer(openCL->context, CL_MEM_READ_WRITE, stride * tileSize);
+	forceBuff = cl::Buffer(openCL->context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, sizeof(cl_double4) * tileSize, zeros.data());
+
+	for (int s=0; s < OOC_SLOTS; ++s) {
+		sourceBuff[s] = cl::Buffer(openCL->context, CL_MEM_READ_ONLY, stride * tileSize);
+		stageBuff[s] = cl::Buffer(openCL->context, CL_MEM_READ_ONLY | CL_MEM_ALLOC_HOST_PTR, stride * tileSize);
+		stagePtr[s] = (uint8_t*)openCL->queue.enqueueMapBuffer(stageBuff[s], CL_TRUE, CL_MAP_WRITE, 0, stride * tileSize);
+	}
+}
+
+void OutOfCore::MapStore(const std::string& path, uint64_t bytes)
+{
+	mapBytes = bytes;
+
+#ifdef _WIN32
+	fileHandle = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (fileHandle != INVALID_HANDLE_VALUE) {
+		mapHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READWRITE, (DWORD)(bytes >> 32), (DWORD)bytes, NULL);
+		if (mapHandle != NULL) base = (uint8_t*)MapViewOfFile(mapHandle, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+	}
+#else
+	fileDesc = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+	if (fileDesc >= 0 && ftruncate(fileDesc, bytes) == 0) {
+		void* mem = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fileDesc, 0);
+		base = (mem == MAP_FAILED) ? NULL : (uint8_t*)mem;
+	}
+#endif
+
+	if (base == NULL) {
+		HandleFatalError(11, "Failed to map "+VarToStr(bytes)+" bytes of out-of-core store: "+path);
+	}
+}
+
+void OutOfCore::Unmap()
+{
+#ifdef _WIN32
+	if (base != NULL) {
+		FlushViewOfFile(base, 0);
+		UnmapViewOfFile(base);
+	}
+	if (mapHandle != NULL) CloseHandle(mapHandle);
+	if (fileHandle != NULL && fileHandle != INVALID_HANDLE_VALUE) CloseHandle(fileHandle);
+	mapHandle = fileHandle = NULL;
+#else
+	if (base != NULL) {
+		msync(base, mapBytes, MS_SYNC);
+		munmap(base, mapBytes);
+	}
+	if (fileDesc >= 0) close(fileDesc);
+	fileDesc = -1;
+#endif
+	base = NULL;
+	header = NULL;
+}
+
+void OutOfCore::Generate(uint64_t seed)
+{
+	// uniform and at rest, written straight into the mapped records
+	std::mt19937_64 rng(seed);
+	std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+	for (cl_uint s=0; s < 2; ++s) {
+		for (uint64_t i=0; i < perSpecies; ++i) {
+			cl_Particle prtcl;
+			for (int d=0; d < 3; ++d) {
+				prtcl.position.s[d] = SIM_POS_MIN + unit(rng) * SIM_POS_MOD;
+				prtcl.velocity.s[d] = 0.0;
+			}
+			prtcl.position.s[3] = prtcl.velocity.s[3] = 0.0;
+			prtcl.new_pos = prtcl.position;
+			prtcl.mass = SIM_MASS_MIN + unit(rng) * SIM_MASS_MOD;
+			prtcl.radius = sqrt(prtcl.mass / PI);
+			if (s == 1) prtcl.mass = -prtcl.mass;
+
+			if (compact) {
+				cl_CompactParticle packed = ParticlePool::Pack(prtcl);
+				memcpy(Records(s, i), &packed, stride);
+			} else {
+				memcpy(Records(s, i), &prtcl, stride);
+			}
+		}
+	}
+}
+
+void OutOfCore::Run(uint32_t steps)
+{
+	double interactions = 4.0 * (double)perSpecies * perSpecies;
+
+	for (uint32_t step=0; step < steps; ++step) {
+		Timer stepTimer;
+		cl_uint parity = header->step & 1;
+		bytesUp = bytesDown = 0;
+		copyTime = stageTime = 0.0;
+
+		for (cl_uint s=0; s < 2; ++s) {
+			for (uint64_t first=0; first < perSpecies; first += tileSize) {
+				StreamBlock(s, first, (uint32_t)std::min((uint64_t)tileSize, perSpecies - first), parity);
+			}
+		}
+		WaitBlock();
+		WaitSlots();
+		header->step++;
+
+		// link rate is over the time the copies actually ran, effective rate is over the whole step
+		double stepTime = std::max(stepTimer.MilliCount(), 0.001f);
+		double moved = (double)(bytesUp + bytesDown);
+		std::stringstream line;
+		line << "Out-of-core step " << header->step << ": " << std::fixed << std::setprecision(1) << stepTime << " ms | ";
+		line << std::setprecision(2) << (interactions / (stepTime * 1e6)) << " G interactions/s | ";
+		line << "up " << (bytesUp / 1e9) << " GB, down " << (bytesDown / 1e9) << " GB | ";
+		line << "effective " << (moved / (stepTime * 1e6)) << " GB/s, link " << (moved / (std::max(copyTime, 0.001) * 1e6)) << " GB/s, ";
+		line << std::setprecision(0) << (100.0 * copyTime / stepTime) << "% copy engine busy | ";
+		line << std::setprecision(2) << "host staging " << (bytesUp / (std::max(stageTime, 0.001) * 1e6)) << " GB/s";
+		PrintLine(line);
+	}
+
+#ifdef _WIN32
+	FlushViewOfFile(base, 0);
+#else
+	msync(base, mapBytes, MS_ASYNC);
+#endif
+}
+
+void OutOfCore::StreamBlock(cl_uint species, uint64_t first, uint32_t count, cl_uint parity)
+{
+	uint64_t blockBytes = stride * count;
+
+	// the previous block writes back into the store we are about to read tiles from
+	WaitBlock();
+	openCL->transfer_queue.enqueueWriteBuffer(targetBuff, CL_FALSE, 0, blockBytes, Records(species, first), NULL, &targetEvent);
+	openCL->transfer_queue.flush();
+	bytesUp += blockBytes;
+
+	openCL->StreamF_Kernel.setArg(0, targetBuff);
+	openCL->StreamF_Kernel.setArg(1, forceBuff);
+	openCL->StreamF_Kernel.setArg(3, count);
+	openCL->StreamF_Kernel.setArg(5, species);
+	openCL->StreamF_Kernel.setArg(8, parity);
+
+	bool firstTile = true;
+	for (cl_uint s=0; s < 2; ++s) {
+		for (uint64_t sf=0; sf < perSpecies; sf += tileSize) {
+			cl_uint tileCount = (cl_uint)std::min((uint64_t)tileSize, perSpecies - sf);
+			int slot = tileIndex++ % OOC_SLOTS;
+
+			// a slot is refilled once the kernel reading it has finished, by then the other slot is already queued
+			if (slotBusy[slot]) {
+				forceEvent[slot].wait();
+				copyTime += openCL->EventTime(uploadEvent[slot]);
+			}
+
+			Timer stageTimer;
+			memcpy(stagePtr[slot], Records(s, sf), stride * tileCount);
+			stageTime += stageTimer.MilliCount();
+
+			openCL->transfer_queue.enqueueWriteBuffer(sourceBuff[slot], CL_FALSE, 0, stride * tileCount, stagePtr[slot], NULL, &uploadEvent[slot]);
+			openCL->transfer_queue.flush();
+			bytesUp += stride * tileCount;
+
+			std::vector<cl::Event> waits(1, uploadEvent[slot]);
+			if (firstTile) waits.push_back(targetEvent);
+			firstTile = false;
+
+			// the self pair sits at a fixed offset between the tiles, other species never match
+			cl_long selfShift = (s == species) ? (cl_long)first - (cl_long)sf : (cl_long)tileCount;
+			openCL->StreamF_Kernel.setArg(2, sourceBuff[slot]);
+			openCL->StreamF_Kernel.setArg(4, tileCount);
+			openCL->StreamF_Kernel.setArg(6, s);
+			openCL->StreamF_Kernel.setArg(7, selfShift);
+			openCL->StreamForces(count, &waits, &forceEvent[slot]);
+			openCL->queue.flush();
+			slotBusy[slot] = true;
+		}
+	}
+
+	cl::Event integrateEvent;
+	openCL->StreamI_Kernel.setArg(0, targetBuff);
+	openCL->StreamI_Kernel.setArg(1, forceBuff);
+	openCL->StreamI_Kernel.setArg(2, count);
+	openCL->StreamI_Kernel.setArg(3, species);
+	openCL->StreamI_Kernel.setArg(4, parity);
+	openCL->StreamIntegrate(count, &integrateEvent);
+	openCL->queue.flush();
+
+	// only the other position field and the velocity change, so sources later this step still see the old positions
+	std::vector<cl::Event> readWaits(1, integrateEvent);
+	openCL->transfer_queue.enqueueReadBuffer(targetBuff, CL_FALSE, 0, blockBytes, Records(species, first), &readWaits, &readEvent);
+	openCL->transfer_queue.flush();
+	bytesDown += blockBytes;
+	blockBusy = true;
+}
+
+void OutOfCore::WaitBlock()
+{
+	if (!blockBusy) return;
+	readEvent.wait();
+	copyTime += openCL->EventTime(readEvent) + openCL->EventTime(targetEvent);
+	blockBusy = false;
+}
+
+void OutOfCore::WaitSlots()
+{
+	for (int s=0; s < OOC_SLOTS; ++s) {
+		if (!slotBusy[s]) continue;
+		forceEvent[s].wait();
+		copyTime += openCL->EventTime(uploadEvent[s]);
+		slotBusy[s] = false;
+	}
+}
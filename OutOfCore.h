@@ -0,0 +1,71 @@
+#pragma once
+#include "OpenCL.h"
+#include <cstdint>
+#include <string>
+
+// start of the store file, the records of both species follow it back to back
+struct OocHeader
+{
+	cl_ulong magic;
+	cl_ulong stride;
+	cl_ulong count;
+	cl_ulong step;
+}; // 32 bytes
+
+// direct sum over a particle store that lives in a memory mapped file, only one target
+// block and two source tiles are ever resident on the device
+class OutOfCore
+{
+public:
+	OutOfCore();
+	~OutOfCore();
+	void Initialize(CL* pOpenCL, uint64_t speciesCount, uint32_t tileCount, bool compactStorage, uint64_t seed);
+	void Run(uint32_t steps);
+private:
+	OutOfCore(const OutOfCore&);
+	OutOfCore& operator=(const OutOfCore&);
+	void MapStore(const std::string& path, uint64_t bytes);
+	void Unmap();
+	void Generate(uint64_t seed);
+	void StreamBlock(cl_uint species, uint64_t first, uint32_t count, cl_uint parity);
+	void WaitBlock();
+	void WaitSlots();
+	uint8_t* Records(cl_uint species, uint64_t index) const
+	{
+		return base + sizeof(OocHeader) + stride * (species * perSpecies + index);
+	}
+public:
+	uint64_t perSpecies;
+	uint32_t tileSize;
+	size_t stride;
+private:
+	CL* openCL;
+	bool compact;
+	OocHeader* header;
+	uint8_t* base;
+	uint64_t mapBytes;
+#ifdef _WIN32
+	void* fileHandle;
+	void* mapHandle;
+#else
+	int fileDesc;
+#endif
+	cl::Buffer targetBuff;
+	cl::Buffer forceBuff;
+	cl::Buffer sourceBuff[OOC_SLOTS];
+	// pinned staging so tile uploads are true async copies
+	cl::Buffer stageBuff[OOC_SLOTS];
+	uint8_t* stagePtr[OOC_SLOTS];
+	cl::Event uploadEvent[OOC_SLOTS];
+	cl::Event forceEvent[OOC_SLOTS];
+	bool slotBusy[OOC_SLOTS];
+	uint64_t tileIndex;
+	cl::Event targetEvent;
+	cl::Event readEvent;
+	bool blockBusy;
+	// per step transfer totals for the bandwidth report
+	uint64_t bytesUp;
+	uint64_t bytesDown;
+	double copyTime;
+	double stageTime;
+};
@@ -0,0 +1,207 @@
+#include "ParticlePool.h"
+
+void ParticlePool::Initialize(CL* pOpenCL, uint32_t initCount, bool compactStorage, GLGraphics* pGfx, int glIndex)
+{
+	openCL = pOpenCL;
+	compact = compactStorage;
+	stride = compact ? sizeof(cl_CompactParticle) : sizeof(cl_Particle);
+	gfx = pGfx;
+	spriteIndex = glIndex;
+	count = 0;
+	capacity = 0;
+	pairCapacity = 0;
+	sortCapacity = 0;
+
+	Grow(std::max(initCount, (uint32_t)POOL_MIN_SIZE));
+	count = initCount;
+}
+
+void ParticlePool::Reserve(uint32_t newCount)
+{
+	// grow geometrically so a stream of small inserts stays cheap
+	if (newCount > capacity) {
+		Grow(std::max(newCount, (uint32_t)(capacity * POOL_GROWTH)));
+	}
+}
+
+void ParticlePool::Grow(uint32_t newCapacity)
+{
+	if (gfx != NULL) {
+		// shared pools live in OGL vertex buffers which OGL copies itself
+		buffer = cl::Buffer();
+		gfx->ResizeSprites(spriteIndex, stride*newCapacity, stride*count);
+		buffer = cl::BufferGL(openCL->context, CL_MEM_READ_WRITE, gfx->gl_vbo_ids[spriteIndex]);
+	} else {
+		cl::Buffer newBuff(openCL->context, CL_MEM_READ_WRITE, stride*newCapacity);
+		if (count > 0) {
+			openCL->queue.enqueueCopyBuffer(buffer, newBuff, 0, 0, stride*count);
+		}
+		buffer = newBuff;
+	}
+	capacity = newCapacity;
+}
+
+void ParticlePool::Generate(cl_char species, cl_uint dist, cl_ulong seed, cl_uint clumps)
+{
+	// every particle is drawn independently from (seed, index), any pool of the same count gets the same set
+	openCL->Init_Kernel.setArg(0, buffer);
+	openCL->Init_Kernel.setArg(1, species);
+	openCL->Init_Kernel.setArg(2, (cl_uint)count);
+	openCL->Init_Kernel.setArg(3, dist);
+	openCL->Init_Kernel.setArg(4, seed);
+	openCL->Init_Kernel.setArg(5, clumps);
+	openCL->GenParticles(count);
+}
+
+void ParticlePool::Insert(const std::vector<cl_Particle>& particles)
+{
+	if (particles.empty()) return;
+
+	// only the new particles are uploaded, appended after the live ones
+	Reserve(count + particles.size());
+	if (compact) {
+		std::vector<cl_CompactParticle> packed(particles.size());
+		for (size_t i=0; i < particles.size(); ++i) packed[i] = Pack(particles[i]);
+		openCL->queue.enqueueWriteBuffer(buffer, CL_TRUE, stride*count, stride*packed.size(), packed.data());
+	} else {
+		openCL->queue.enqueueWriteBuffer(buffer, CL_TRUE, stride*count,
+										 stride*particles.size(), particles.data());
+	}
+	count += particles.size();
+}
+
+void ParticlePool::Read(std::vector<cl_Particle>& particles)
+{
+	// blocking read of the live particles, always handed back in the full layout
+	particles.resize(count);
+	if (count == 0) return;
+
+	if (compact) {
+		std::vector<cl_CompactParticle> packed(count);
+		openCL->queue.enqueueReadBuffer(buffer, CL_TRUE, 0, stride*count, packed.data());
+		for (uint32_t i=0; i < count; ++i) particles[i] = Unpack(packed[i]);
+	} else {
+		openCL->queue.enqueueReadBuffer(buffer, CL_TRUE, 0, stride*count, particles.data());
+	}
+}
+
+void ParticlePool::Remove(std::vector<uint32_t> indices)
+{
+	std::sort(indices.begin(), indices.end());
+	indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+	indices.erase(std::lower_bound(indices.begin(), indices.end(), count), indices.end());
+	if (indices.empty()) return;
+
+	// freed slots below the new count are filled from the live tail
+	uint32_t newCount = count - indices.size();
+	std::vector<cl_uint2> moves;
+	std::vector<uint32_t>::reverse_iterator dead = indices.rbegin();
+	uint32_t src = count;
+
+	for (size_t i=0; i < indices.size() && indices[i] < newCount; ++i) {
+		// walk down from the tail past slots that are being freed too
+		--src;
+		while (dead != indices.rend() && *dead == src) {
+			++dead;
+			--src;
+		}
+
+		cl_uint2 move = {{indices[i], src}};
+		moves.push_back(move);
+	}
+
+	if (!moves.empty()) {
+		UploadPairs(moves);
+		openCL->Move_Kernel.setArg(0, buffer);
+		openCL->Move_Kernel.setArg(1, pairBuff);
+		openCL->MoveParticles(moves.size());
+	}
+
+	count = newCount;
+}
+
+void ParticlePool::Merge(const std::vector<cl_uint2>& pairs)
+{
+	if (pairs.empty()) return;
+
+	// each pair absorbs its second particle into its first, pairs must not overlap
+	UploadPairs(pairs);
+	openCL->Merge_Kernel.setArg(0, buffer);
+	openCL->Merge_Kernel.setArg(1, pairBuff);
+	openCL->MergeParticles(pairs.size());
+
+	std::vector<uint32_t> absorbed;
+	absorbed.reserve(pairs.size());
+	for (size_t i=0; i < pairs.size(); ++i) {
+		absorbed.push_back(pairs[i].s[1]);
+	}
+	Remove(absorbed);
+}
+
+void ParticlePool::Reorder(cl_uint curve)
+{
+	if (count < 2) return;
+
+	// sort scratch follows the pool capacity
+	if (sortCapacity < capacity) {
+		sortCapacity = capacity;
+		curveKeys = cl::Buffer(openCL->context, CL_MEM_READ_WRITE, sizeof(cl_uint)*sortCapacity);
+		curveVals = cl::Buffer(openCL->context, CL_MEM_READ_WRITE, sizeof(cl_uint)*sortCapacity);
+		tmpKeys = cl::Buffer(openCL->context, CL_MEM_READ_WRITE, sizeof(cl_uint)*sortCapacity);
+		tmpVals = cl::Buffer(openCL->context, CL_MEM_READ_WRITE, sizeof(cl_uint)*sortCapacity);
+		sortedBuff = cl::Buffer(openCL->context, CL_MEM_READ_WRITE, stride*sortCapacity);
+	}
+
+	// sort particles along a space filling curve so neighbours sit together in memory
+	openCL->Curve_Kernel.setArg(0, buffer);
+	openCL->Curve_Kernel.setArg(1, curveKeys);
+	openCL->Curve_Kernel.setArg(2, curveVals);
+	openCL->Curve_Kernel.setArg(3, curve);
+	openCL->CurveKeys(count);
+
+	openCL->RadixSort(curveKeys, curveVals, tmpKeys, tmpVals, count, 3*CURVE_BITS);
+
+	openCL->Gather_Kernel.setArg(0, buffer);
+	openCL->Gather_Kernel.setArg(1, sortedBuff);
+	openCL->Gather_Kernel.setArg(2, curveVals);
+	openCL->GatherParticles(count);
+
+	// copy back rather than swap so shared OGL buffers stay valid
+	openCL->queue.enqueueCopyBuffer(sortedBuff, buffer, 0, 0, stride*count);
+}
+
+void ParticlePool::UploadPairs(const std::vector<cl_uint2>& pairs)
+{
+	if (pairs.size() > pairCapacity) {
+		pairCapacity = std::max((uint32_t)pairs.size(), pairCapacity * POOL_GROWTH);
+		pairBuff = cl::Buffer(openCL->context, CL_MEM_READ_ONLY, sizeof(cl_uint2)*pairCapacity);
+	}
+	openCL->queue.enqueueWriteBuffer(pairBuff, CL_TRUE, 0, sizeof(cl_uint2)*pairs.size(), pairs.data());
+}
+
+cl_CompactParticle ParticlePool::Pack(const cl_Particle& prtcl)
+{
+	// same rounding as EncodePosition, one box width maps onto the full 32-bit range
+	cl_CompactParticle packed;
+	for (int d=0; d < 3; ++d) {
+		packed.new_pos[d] = (cl_uint)llround((prtcl.new_pos.s[d] - SIM_POS_MIN) * (4294967296.0 / SIM_POS_MOD));
+		packed.position[d] = (cl_uint)llround((prtcl.position.s[d] - SIM_POS_MIN) * (4294967296.0 / SIM_POS_MOD));
+		packed.velocity[d] = (cl_float)prtcl.velocity.s[d];
+	}
+	packed.mass = prtcl.mass;
+	return packed;
+}
+
+cl_Particle ParticlePool::Unpack(const cl_CompactParticle& packed)
+{
+	cl_Particle prtcl;
+	for (int d=0; d < 3; ++d) {
+		prtcl.new_pos.s[d] = SIM_POS_MIN + packed.new_pos[d] * (SIM_POS_MOD / 4294967296.0);
+		prtcl.position.s[d] = SIM_POS_MIN + packed.position[d] * (SIM_POS_MOD / 4294967296.0);
+		prtcl.velocity.s[d] = packed.velocity[d];
+	}
+	prtcl.new_pos.s[3] = prtcl.position.s[3] = prtcl.velocity.s[3] = 0.0;
+	prtcl.mass = packed.mass;
+	prtcl.radius = sqrt(fabs(packed.mass) / PI);
+	return prtcl;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include "OpenCL.h"
+#include "GLGraphics.h"
+#include "MathExt.h"
+#include <vector>
+#include <algorithm>
+
+class ParticlePool
+{
+public:
+	void Initialize(CL* pOpenCL, uint32_t initCount, bool compactStorage, GLGraphics* pGfx = NULL, int glIndex = 0);
+	void Reserve(uint32_t newCount);
+	void Generate(cl_char species, cl_uint dist, cl_ulong seed, cl_uint clumps);
+	void Insert(const std::vector<cl_Particle>& particles);
+	void Read(std::vector<cl_Particle>& particles);
+	void Remove(std::vector<uint32_t> indices);
+	void Merge(const std::vector<cl_uint2>& pairs);
+	void Reorder(cl_uint curve);
+	static cl_CompactParticle Pack(const cl_Particle& prtcl);
+	static cl_Particle Unpack(const cl_CompactParticle& prtcl);
+private:
+	void Grow(uint32_t newCapacity);
+	void UploadPairs(const std::vector<cl_uint2>& pairs);
+public:
+	cl::Buffer buffer;
+	uint32_t count;
+	uint32_t capacity;
+	// bytes per particle on the device, 40 in the compact layout and 104 otherwise
+	size_t stride;
+	bool compact;
+private:
+	CL* openCL;
+	GLGraphics* gfx;
+	int spriteIndex;
+	cl::Buffer pairBuff;
+	uint32_t pairCapacity;
+	cl::Buffer curveKeys, curveVals;
+	cl::Buffer tmpKeys, tmpVals;
+	cl::Buffer sortedBuff;
+	uint32_t sortCapacity;
+};
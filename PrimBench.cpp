@@ -0,0 +1,270 @@
+#include "PrimBench.h"
+#include <numeric>
+#include <iomanip>
+#include <iterator>
+#include <cmath>
+
+void PrimBench::Run(CL* pOpenCL, uint32_t elements)
+{
+	openCL = pOpenCL;
+	count = elements;
+	failures = 0;
+
+	// the same random input feeds every device run and its host baseline
+	uintData.resize(count);
+	ulongData.resize(count);
+	doubleData.resize(count);
+	for (uint32_t i=0; i < count; ++i) {
+		uintData[i] = rand();
+		ulongData[i] = ((cl_ulong)rand() << 32) ^ ((cl_ulong)rand() << 16) ^ rand();
+		doubleData[i] = (rand() / (double)RAND_MAX) * 2.0 - 1.0;
+	}
+
+	srcBuff = cl::Buffer(openCL->context, CL_MEM_READ_WRITE, sizeof(cl_ulong)*count);
+	workBuff = cl::Buffer(openCL->context, CL_MEM_READ_WRITE, sizeof(cl_ulong)*count);
+	flagBuff = cl::Buffer(openCL->context, CL_MEM_READ_WRITE, sizeof(cl_uint)*count);
+	outBuff = cl::Buffer(openCL->context, CL_MEM_READ_WRITE, sizeof(cl_ulong)*count);
+	keyBuff = cl::Buffer(openCL->context, CL_MEM_READ_WRITE, sizeof(cl_ulong)*count);
+	valBuff = cl::Buffer(openCL->context, CL_MEM_READ_WRITE, sizeof(cl_uint)*count);
+	tmpKeys = cl::Buffer(openCL->context, CL_MEM_READ_WRITE, sizeof(cl_ulong)*count);
+	tmpVals = cl::Buffer(openCL->context, CL_MEM_READ_WRITE, sizeof(cl_uint)*count);
+
+	PrintLine("Primitive benchmark: "+VarToStr(count)+" elements, best of "+VarToStr(BENCH_REPEATS)+" runs");
+	BenchScan();
+	BenchCompact();
+	BenchReduce(REDUCE_SUM);
+	BenchReduce(REDUCE_MIN);
+	BenchReduce(REDUCE_MAX);
+	BenchSegmented();
+	BenchRadix32();
+	BenchRadix64();
+	PrintLine((failures == 0) ? "All primitives match the host results" :
+			  VarToStr(failures)+" primitive(s) did not match the host results");
+}
+
+void PrimBench::Finish(Timer& timer, float& best)
+{
+	openCL->queue.finish();
+	best = std::min(best, timer.MilliCount());
+}
+
+void PrimBench::Report(const std::string& name, float deviceTime, float hostTime, bool passed)
+{
+	std::stringstream line;
+	line << std::fixed << std::setprecision(3);
+	line << std::left << std::setw(14) << name;
+	line << " device " << deviceTime << " ms (" << (count / deviceTime / 1000.0f) << " M/s)";
+	line << " | host " << hostTime << " ms (" << (count / hostTime / 1000.0f) << " M/s)";
+	line << " | " << (passed ? "ok" : "MISMATCH");
+	PrintLine(line);
+	if (!passed) failures++;
+}
+
+bool PrimBench::BenchScan()
+{
+	std::vector<cl_uint> result(count), expected(count);
+	float deviceTime = 1e9f, hostTime = 1e9f;
+	Timer timer;
+
+	openCL->queue.enqueueWriteBuffer(srcBuff, CL_TRUE, 0, sizeof(cl_uint)*count, uintData.data());
+	for (int r=0; r < BENCH_REPEATS; ++r) {
+		openCL->queue.enqueueCopyBuffer(srcBuff, workBuff, 0, 0, sizeof(cl_uint)*count);
+		openCL->queue.finish();
+		timer.ResetTimer();
+		openCL->ScanExclusive(workBuff, count);
+		Finish(timer, deviceTime);
+	}
+	openCL->queue.enqueueReadBuffer(workBuff, CL_TRUE, 0, sizeof(cl_uint)*count, result.data());
+
+	for (int r=0; r < BENCH_REPEATS; ++r) {
+		timer.ResetTimer();
+		expected[0] = 0;
+		std::partial_sum(uintData.begin(), uintData.end()-1, expected.begin()+1);
+		hostTime = std::min(hostTime, timer.MilliCount());
+	}
+
+	bool passed = (result == expected);
+	Report("scan", deviceTime, hostTime, passed);
+	return passed;
+}
+
+bool PrimBench::BenchCompact()
+{
+	std::vector<cl_uint> flags(count), result, expected;
+	float deviceTime = 1e9f, hostTime = 1e9f;
+	uint32_t kept = 0;
+	Timer timer;
+
+	// keep roughly half the values
+	for (uint32_t i=0; i < count; ++i) flags[i] = uintData[i] & 1;
+
+	openCL->queue.enqueueWriteBuffer(srcBuff, CL_TRUE, 0, sizeof(cl_uint)*count, uintData.data());
+	openCL->queue.enqueueWriteBuffer(flagBuff, CL_TRUE, 0, sizeof(cl_uint)*count, flags.data());
+	for (int r=0; r < BENCH_REPEATS; ++r) {
+		timer.ResetTimer();
+		kept = openCL->Compact(srcBuff, flagBuff, outBuff, count);
+		Finish(timer, deviceTime);
+	}
+	result.resize(kept);
+	if (kept > 0) {
+		openCL->queue.enqueueReadBuffer(outBuff, CL_TRUE, 0, sizeof(cl_uint)*kept, result.data());
+	}
+
+	for (int r=0; r < BENCH_REPEATS; ++r) {
+		timer.ResetTimer();
+		expected.clear();
+		std::copy_if(uintData.begin(), uintData.end(), std::back_inserter(expected), [](cl_uint v) { return (v & 1) != 0; });
+		hostTime = std::min(hostTime, timer.MilliCount());
+	}
+
+	bool passed = (result == expected);
+	Report("compact", deviceTime, hostTime, passed);
+	return passed;
+}
+
+bool PrimBench::BenchReduce(cl_uint op)
+{
+	float deviceTime = 1e9f, hostTime = 1e9f;
+	double result = 0.0, expected = 0.0;
+	Timer timer;
+
+	openCL->queue.enqueueWriteBuffer(srcBuff, CL_TRUE, 0, sizeof(cl_double)*count, doubleData.data());
+	for (int r=0; r < BENCH_REPEATS; ++r) {
+		timer.ResetTimer();
+		openCL->Reduce(srcBuff, count, op, outBuff);
+		Finish(timer, deviceTime);
+	}
+	openCL->queue.enqueueReadBuffer(outBuff, CL_TRUE, 0, sizeof(cl_double), &result);
+
+	for (int r=0; r < BENCH_REPEATS; ++r) {
+		timer.ResetTimer();
+		if (op == REDUCE_MIN) {
+			expected = *std::min_element(doubleData.begin(), doubleData.end());
+		} else if (op == REDUCE_MAX) {
+			expected = *std::max_element(doubleData.begin(), doubleData.end());
+		} else {
+			expected = std::accumulate(doubleData.begin(), doubleData.end(), 0.0);
+		}
+		hostTime = std::min(hostTime, timer.MilliCount());
+	}
+
+	// sums are summed in a different order so allow rounding drift
+	bool passed = (op == REDUCE_SUM) ? (std::abs(result - expected) <= 1e-9 * count) : (result == expected);
+	Report((op == REDUCE_SUM) ? "reduce sum" : (op == REDUCE_MIN) ? "reduce min" : "reduce max", deviceTime, hostTime, passed);
+	return passed;
+}
+
+bool PrimBench::BenchSegmented()
+{
+	std::vector<cl_uint> offsets(1, 0);
+	float deviceTime = 1e9f, hostTime = 1e9f;
+	bool passed = true;
+	Timer timer;
+
+	// random segment lengths, including some empty ones
+	while (offsets.back() < count) {
+		offsets.push_back(std::min(offsets.back() + (cl_uint)(rand() % 2048), count));
+	}
+	uint32_t segments = offsets.size() - 1;
+	std::vector<cl_double> result(segments), expected(segments);
+	cl::Buffer offsetBuff(openCL->context, CL_MEM_READ_ONLY, sizeof(cl_uint)*offsets.size());
+	cl::Buffer resultBuff(openCL->context, CL_MEM_READ_WRITE, sizeof(cl_double)*segments);
+
+	openCL->queue.enqueueWriteBuffer(srcBuff, CL_TRUE, 0, sizeof(cl_double)*count, doubleData.data());
+	openCL->queue.enqueueWriteBuffer(offsetBuff, CL_TRUE, 0, sizeof(cl_uint)*offsets.size(), offsets.data());
+	for (int r=0; r < BENCH_REPEATS; ++r) {
+		timer.ResetTimer();
+		openCL->SegmentedReduce(srcBuff, offsetBuff, segments, REDUCE_SUM, resultBuff);
+		Finish(timer, deviceTime);
+	}
+	openCL->queue.enqueueReadBuffer(resultBuff, CL_TRUE, 0, sizeof(cl_double)*segments, result.data());
+
+	for (int r=0; r < BENCH_REPEATS; ++r) {
+		timer.ResetTimer();
+		for (uint32_t s=0; s < segments; ++s) {
+			expected[s] = std::accumulate(doubleData.begin()+offsets[s], doubleData.begin()+offsets[s+1], 0.0);
+		}
+		hostTime = std::min(hostTime, timer.MilliCount());
+	}
+
+	for (uint32_t s=0; s < segments && passed; ++s) {
+		passed = std::abs(result[s] - expected[s]) <= 1e-9 * (offsets[s+1] - offsets[s] + 1);
+	}
+	Report("segmented sum", deviceTime, hostTime, passed);
+	return passed;
+}
+
+bool PrimBench::BenchRadix32()
+{
+	std::vector<cl_uint> indices(count), resultKeys(count), resultVals(count);
+	std::vector<std::pair<cl_uint, cl_uint>> expected(count);
+	float deviceTime = 1e9f, hostTime = 1e9f;
+	bool passed = true;
+	Timer timer;
+
+	std::iota(indices.begin(), indices.end(), 0);
+	openCL->queue.enqueueWriteBuffer(srcBuff, CL_TRUE, 0, sizeof(cl_uint)*count, uintData.data());
+	openCL->queue.enqueueWriteBuffer(flagBuff, CL_TRUE, 0, sizeof(cl_uint)*count, indices.data());
+	for (int r=0; r < BENCH_REPEATS; ++r) {
+		openCL->queue.enqueueCopyBuffer(srcBuff, keyBuff, 0, 0, sizeof(cl_uint)*count);
+		openCL->queue.enqueueCopyBuffer(flagBuff, valBuff, 0, 0, sizeof(cl_uint)*count);
+		openCL->queue.finish();
+		timer.ResetTimer();
+		openCL->RadixSort(keyBuff, valBuff, tmpKeys, tmpVals, count, 32);
+		Finish(timer, deviceTime);
+	}
+	openCL->queue.enqueueReadBuffer(keyBuff, CL_TRUE, 0, sizeof(cl_uint)*count, resultKeys.data());
+	openCL->queue.enqueueReadBuffer(valBuff, CL_TRUE, 0, sizeof(cl_uint)*count, resultVals.data());
+
+	for (int r=0; r < BENCH_REPEATS; ++r) {
+		for (uint32_t i=0; i < count; ++i) expected[i] = std::make_pair(uintData[i], i);
+		timer.ResetTimer();
+		std::stable_sort(expected.begin(), expected.end(),
+						 [](const std::pair<cl_uint, cl_uint>& a, const std::pair<cl_uint, cl_uint>& b) { return a.first < b.first; });
+		hostTime = std::min(hostTime, timer.MilliCount());
+	}
+
+	for (uint32_t i=0; i < count && passed; ++i) {
+		passed = resultKeys[i] == expected[i].first && resultVals[i] == expected[i].second;
+	}
+	Report("radix sort 32", deviceTime, hostTime, passed);
+	return passed;
+}
+
+bool PrimBench::BenchRadix64()
+{
+	std::vector<cl_uint> indices(count), resultVals(count);
+	std::vector<cl_ulong> resultKeys(count);
+	std::vector<std::pair<cl_ulong, cl_uint>> expected(count);
+	float deviceTime = 1e9f, hostTime = 1e9f;
+	bool passed = true;
+	Timer timer;
+
+	std::iota(indices.begin(), indices.end(), 0);
+	openCL->queue.enqueueWriteBuffer(srcBuff, CL_TRUE, 0, sizeof(cl_ulong)*count, ulongData.data());
+	openCL->queue.enqueueWriteBuffer(flagBuff, CL_TRUE, 0, sizeof(cl_uint)*count, indices.data());
+	for (int r=0; r < BENCH_REPEATS; ++r) {
+		openCL->queue.enqueueCopyBuffer(srcBuff, keyBuff, 0, 0, sizeof(cl_ulong)*count);
+		openCL->queue.enqueueCopyBuffer(flagBuff, valBuff, 0, 0, sizeof(cl_uint)*count);
+		openCL->queue.finish();
+		timer.ResetTimer();
+		openCL->RadixSort64(keyBuff, valBuff, tmpKeys, tmpVals, count, 64);
+		Finish(timer, deviceTime);
+	}
+	openCL->queue.enqueueReadBuffer(keyBuff, CL_TRUE, 0, sizeof(cl_ulong)*count, resultKeys.data());
+	openCL->queue.enqueueReadBuffer(valBuff, CL_TRUE, 0, sizeof(cl_uint)*count, resultVals.data());
+
+	for (int r=0; r < BENCH_REPEATS; ++r) {
+		for (uint32_t i=0; i < count; ++i) expected[i] = std::make_pair(ulongData[i], i);
+		timer.ResetTimer();
+		std::stable_sort(expected.begin(), expected.end(),
+						 [](const std::pair<cl_ulong, cl_uint>& a, const std::pair<cl_ulong, cl_uint>& b) { return a.first < b.first; });
+		hostTime = std::min(hostTime, timer.MilliCount());
+	}
+
+	for (uint32_t i=0; i < count && passed; ++i) {
+		passed = resultKeys[i] == expected[i].first && resultVals[i] == expected[i].second;
+	}
+	Report("radix sort 64", deviceTime, hostTime, passed);
+	return passed;
+}
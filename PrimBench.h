@@ -0,0 +1,30 @@
+#pragma once
+#include "OpenCL.h"
+#include "Timer.h"
+#include <vector>
+#include <sstream>
+
+// checks each device primitive against its std:: equivalent and reports throughput
+class PrimBench
+{
+public:
+	void Run(CL* pOpenCL, uint32_t count);
+private:
+	bool BenchScan();
+	bool BenchCompact();
+	bool BenchReduce(cl_uint op);
+	bool BenchSegmented();
+	bool BenchRadix32();
+	bool BenchRadix64();
+	void Report(const std::string& name, float deviceTime, float hostTime, bool passed);
+	void Finish(Timer& timer, float& total);
+private:
+	CL* openCL;
+	uint32_t count;
+	std::vector<cl_uint> uintData;
+	std::vector<cl_ulong> ulongData;
+	std::vector<cl_double> doubleData;
+	cl::Buffer srcBuff, workBuff, flagBuff, outBuff;
+	cl::Buffer keyBuff, valBuff, tmpKeys, tmpVals;
+	uint32_t failures;
+};
@@ -1,28 +1,144 @@
-#pragma once
-#include <string>
-#include <mutex>
-#include <unordered_map>
-
-#define CAMSPIN_SPEED	0.001
-#define CAMMOVE_SPEED	1.0
-
-#define CL_LOGGING		1
-#define CL_COMPLOG		1
-
-#define CONFIG_FILE     "settings.cfg"
-#define CL_BUILD_LOG    "logs/cl_build.log"
-
-#define WINDOW_TITLE	"Negative Mass Simulator"
-
-#if defined (__APPLE__) || defined(MACOSX)
-	#define CL_GL_SHARING_EXT "cl_APPLE_gl_sharing"
-#else
-	#define CL_GL_SHARING_EXT "cl_khr_gl_sharing"
-#endif
-
-namespace GLOBALS {
-
-	extern std::unordered_map<std::string,std::string> config_map;
-    extern std::string DATA_FOLDER;
-    extern std::mutex COUT_MUTEX;
-}
+#pragma once
+#include <string>
+#include <mutex>
+#include <unordered_map>
+
+#define CAMSPIN_SPEED	0.001
+#define CAMMOVE_SPEED	1.0
+
+#define CL_LOGGING		1
+#define CL_COMPLOG		1
+
+#define CONFIG_FILE     "settings.cfg"
+#define CL_BUILD_LOG    "logs/cl_build.log"
+#define DIAG_LOG        "logs/diagnostics.csv"
+#define OOC_STORE       "ooc_particles.bin"
+#define ENSEMBLE_LOG    "logs/ensemble.csv"
+#define ANALYSIS_LOG    "logs/analysis.csv"
+#define GROUPS_LOG      "logs/groups.csv"
+#define ENSEMBLE_PARAMS "ensemble.csv"
+
+#define SPRITE_VS_FILE  "shaders/sprite.vert"
+#define SPRITE_FS_FILE  "shaders/sprite.frag"
+
+#define WINDOW_TITLE	"Negative Mass Simulator"
+
+#define RENDER_COMPUTE	0
+#define RENDER_SPRITES	1
+#define RENDER_DENSITY	2
+
+#define AA_SUPERSAMPLE	0
+#define AA_COVERAGE		1
+#define AA_TEMPORAL		2
+
+#define TAA_JITTER_FRAMES	8
+
+#define CULL_WG_SIZE	256
+
+#define SCAN_WG			256
+#define SCAN_BLOCK		512
+#define RADIX_BITS		4
+#define RADIX_BINS		16
+#define RADIX_ITEMS		16
+#define REDUCE_GROUPS	64
+#define REDUCE_SUM		0
+#define REDUCE_MIN		1
+#define REDUCE_MAX		2
+#define BENCH_REPEATS	10
+
+#define DIAG_TERMS		11
+#define DIAG_GROUPS		64
+#define DIAG_ROWS		(DIAG_TERMS*2 + 1)
+
+#define ENS_TERMS		7
+#define ENS_G_SPREAD	0.5
+
+#define ANA_BINS		64
+#define ANA_STATS		6
+#define ANA_SUMS		7
+#define ANA_MAXES		2
+#define ANA_GROUPS		64
+#define ANA_MESH		32
+#define ANA_CELLS		(ANA_MESH*ANA_MESH*ANA_MESH)
+#define ANA_K_BINS		(ANA_MESH/2)
+#define ANA_VALUES		(ANA_STATS + 2*ANA_K_BINS)
+#define ANA_HIST		(7*ANA_BINS)
+#define ANA_RADIUS_MAX	(SIM_POS_MOD * 0.5)
+#define ANA_SEP_MAX		(SIM_POS_MOD * 0.8660254037844386)
+
+#define FOF_TERMS		9
+
+#define GRID_MAX_DIM	64
+#define GRID_KEY_BITS	18
+#define GRID_NEG_BIT	0x80000000
+#define GRID_INDEX_MASK	0x7FFFFFFF
+
+#define CURVE_BITS		10
+#define CURVE_MORTON	0
+#define CURVE_HILBERT	1
+
+#define COLLIDE_OFF		0
+#define COLLIDE_BOUNCE	1
+#define COLLIDE_MERGE	2
+
+#define POOL_MIN_SIZE	1024
+#define POOL_GROWTH		2
+
+#define EMIT_COUNT		256
+#define EMIT_DIST		500.0
+#define EMIT_SPREAD		200.0
+
+#define INIT_UNIFORM	0
+#define INIT_LATTICE	1
+#define INIT_PLUMMER	2
+#define INIT_DISK		3
+#define INIT_CLUMPS		4
+
+#define SIM_POS_MIN		10000.0
+#define SIM_POS_MOD		10000.0
+#define SIM_MASS_MIN	1000.0
+#define SIM_MASS_MOD	10000
+#define SIM_POS_MAX		19999.0
+#define SIM_G			0.0006674
+#define SIM_SPEED_MULT	100.0
+#define SIM_IMP_MAX		24998.5
+#define SIM_IMP_MIN		5000.5
+#define SIM_INV_MASS	20000000.0
+
+#define FORCE_SCALAR	0
+#define FORCE_SSE4		1
+#define FORCE_AVX2		2
+#define FORCE_AVX512	3
+#define FORCE_LANES		8
+#define FORCE_BLOCK		256
+
+#define HOST_MAX_NODES	64
+#define HOST_HUGE_PAGE	(2*1024*1024)
+
+#define OOC_MAGIC		0x31434F4F4D49534EULL
+#define OOC_SLOTS		2
+
+#define FRAME_RING_SIZE	3
+
+#define SCALE_FRAMES	30
+#define SCALE_STEP		0.1f
+#define SCALE_HEADROOM	0.8f
+
+#define DENS_BINS		64
+#define DENS_INIT_EXPO	4.0f
+
+#define SPRITE_NEAR		1.0
+#define SPRITE_FAR		100000.0
+
+#if defined (__APPLE__) || defined(MACOSX)
+	#define CL_GL_SHARING_EXT "cl_APPLE_gl_sharing"
+#else
+	#define CL_GL_SHARING_EXT "cl_khr_gl_sharing"
+#endif
+
+namespace GLOBALS {
+
+	extern std::unordered_map<std::string,std::string> config_map;
+    extern std::string DATA_FOLDER;
+    extern std::mutex COUT_MUTEX;
+}
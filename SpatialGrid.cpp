@@ -0,0 +1,123 @@
+#include "SpatialGrid.h"
+
+void SpatialGrid::Initialize(CL* pOpenCL, int collideMode)
+{
+	openCL = pOpenCL;
+	mode = collideMode;
+	merges = 0;
+	capacity = 0;
+
+	// grid info holds the max radius, grid dimension, cell size and merge count
+	gridInfo = cl::Buffer(openCL->context, CL_MEM_READ_WRITE, sizeof(cl_uint)*4);
+	cellRange = cl::Buffer(openCL->context, CL_MEM_READ_WRITE, sizeof(cl_uint2)*GRID_MAX_DIM*GRID_MAX_DIM*GRID_MAX_DIM);
+}
+
+void SpatialGrid::Reserve(uint32_t count)
+{
+	if (count <= capacity) return;
+	capacity = std::max(count, capacity * POOL_GROWTH);
+
+	cellKeys = cl::Buffer(openCL->context, CL_MEM_READ_WRITE, sizeof(cl_uint)*capacity);
+	cellVals = cl::Buffer(openCL->context, CL_MEM_READ_WRITE, sizeof(cl_uint)*capacity);
+	tmpKeys = cl::Buffer(openCL->context, CL_MEM_READ_WRITE, sizeof(cl_uint)*capacity);
+	tmpVals = cl::Buffer(openCL->context, CL_MEM_READ_WRITE, sizeof(cl_uint)*capacity);
+	velDeltas = cl::Buffer(openCL->context, CL_MEM_READ_WRITE, sizeof(cl_double3)*capacity);
+	partners = cl::Buffer(openCL->context, CL_MEM_READ_WRITE, sizeof(cl_uint)*capacity);
+	mergePairs = cl::Buffer(openCL->context, CL_MEM_READ_WRITE, sizeof(cl_uint2)*(capacity/2 + 1));
+}
+
+void SpatialGrid::Collide(ParticlePool& posPool, ParticlePool& negPool)
+{
+	uint32_t count = posPool.count + negPool.count;
+	if (count == 0) return;
+	Reserve(count);
+
+	// size the cells from the biggest particle
+	openCL->queue.enqueueFillBuffer(gridInfo, (cl_uint)0, 0, sizeof(cl_uint)*4);
+	openCL->GridR_Kernel.setArg(0, posPool.buffer);
+	openCL->GridR_Kernel.setArg(1, gridInfo);
+	openCL->GridMaxRadius(posPool.count);
+	openCL->GridR_Kernel.setArg(0, negPool.buffer);
+	openCL->GridMaxRadius(negPool.count);
+
+	openCL->GridS_Kernel.setArg(0, gridInfo);
+	openCL->GridSetup();
+
+	// key both species by cell, negatives are flagged and follow the positives
+	openCL->GridK_Kernel.setArg(0, posPool.buffer);
+	openCL->GridK_Kernel.setArg(1, cellKeys);
+	openCL->GridK_Kernel.setArg(2, cellVals);
+	openCL->GridK_Kernel.setArg(3, gridInfo);
+	openCL->GridK_Kernel.setArg(4, (cl_uint)0);
+	openCL->GridK_Kernel.setArg(5, (cl_uint)0);
+	openCL->GridKeys(posPool.count);
+
+	openCL->GridK_Kernel.setArg(0, negPool.buffer);
+	openCL->GridK_Kernel.setArg(4, (cl_uint)GRID_NEG_BIT);
+	openCL->GridK_Kernel.setArg(5, (cl_uint)posPool.count);
+	openCL->GridKeys(negPool.count);
+
+	openCL->RadixSort(cellKeys, cellVals, tmpKeys, tmpVals, count, GRID_KEY_BITS);
+
+	// find where each cell's run starts and ends, empty cells stay at zero length
+	openCL->queue.enqueueFillBuffer(cellRange, (cl_uint)0, 0, sizeof(cl_uint2)*GRID_MAX_DIM*GRID_MAX_DIM*GRID_MAX_DIM);
+	openCL->GridC_Kernel.setArg(0, cellKeys);
+	openCL->GridC_Kernel.setArg(1, cellRange);
+	openCL->GridC_Kernel.setArg(2, count);
+	openCL->GridCells(count);
+
+	// test each particle against its 27 neighbouring cells
+	openCL->Collide_Kernel.setArg(0, posPool.buffer);
+	openCL->Collide_Kernel.setArg(1, negPool.buffer);
+	openCL->Collide_Kernel.setArg(2, cellKeys);
+	openCL->Collide_Kernel.setArg(3, cellVals);
+	openCL->Collide_Kernel.setArg(4, cellRange);
+	openCL->Collide_Kernel.setArg(5, gridInfo);
+	openCL->Collide_Kernel.setArg(6, velDeltas);
+	openCL->Collide_Kernel.setArg(7, partners);
+	openCL->Collide_Kernel.setArg(8, (cl_uint)mode);
+	openCL->CollideParticles(count);
+
+	if (mode == COLLIDE_MERGE) {
+		MergeParticles(posPool, negPool);
+	} else {
+		openCL->Bounce_Kernel.setArg(0, posPool.buffer);
+		openCL->Bounce_Kernel.setArg(1, negPool.buffer);
+		openCL->Bounce_Kernel.setArg(2, cellVals);
+		openCL->Bounce_Kernel.setArg(3, velDeltas);
+		openCL->ApplyCollisions(count);
+	}
+}
+
+void SpatialGrid::MergeParticles(ParticlePool& posPool, ParticlePool& negPool)
+{
+	uint32_t count = posPool.count + negPool.count;
+	cl_uint info[4];
+
+	openCL->Pairs_Kernel.setArg(0, cellVals);
+	openCL->Pairs_Kernel.setArg(1, partners);
+	openCL->Pairs_Kernel.setArg(2, mergePairs);
+	openCL->Pairs_Kernel.setArg(3, gridInfo);
+	openCL->MergePairs(count);
+
+	// the pools compact on the host so the pair list has to come back
+	openCL->queue.enqueueReadBuffer(gridInfo, CL_TRUE, 0, sizeof(info), info);
+	if (info[3] == 0) return;
+
+	std::vector<cl_uint2> pairs(info[3]);
+	std::vector<cl_uint2> posPairs, negPairs;
+	openCL->queue.enqueueReadBuffer(mergePairs, CL_TRUE, 0, sizeof(cl_uint2)*pairs.size(), pairs.data());
+
+	for (size_t i=0; i < pairs.size(); ++i) {
+		cl_uint2 pair = {{pairs[i].s[0] & GRID_INDEX_MASK, pairs[i].s[1] & GRID_INDEX_MASK}};
+		if (pairs[i].s[0] & GRID_NEG_BIT) {
+			negPairs.push_back(pair);
+		} else {
+			posPairs.push_back(pair);
+		}
+	}
+
+	posPool.Merge(posPairs);
+	negPool.Merge(negPairs);
+	merges += pairs.size();
+}
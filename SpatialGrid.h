@@ -0,0 +1,29 @@
+#pragma once
+#include "OpenCL.h"
+#include "ParticlePool.h"
+#include <vector>
+
+class SpatialGrid
+{
+public:
+	void Initialize(CL* pOpenCL, int collideMode);
+	void Collide(ParticlePool& posPool, ParticlePool& negPool);
+private:
+	void Reserve(uint32_t count);
+	void MergeParticles(ParticlePool& posPool, ParticlePool& negPool);
+public:
+	int mode;
+	uint32_t merges;
+private:
+	CL* openCL;
+	cl::Buffer gridInfo;
+	cl::Buffer cellRange;
+	cl::Buffer cellKeys;
+	cl::Buffer cellVals;
+	cl::Buffer tmpKeys;
+	cl::Buffer tmpVals;
+	cl::Buffer velDeltas;
+	cl::Buffer partners;
+	cl::Buffer mergePairs;
+	uint32_t capacity;
+};
@@ -0,0 +1,146 @@
+#include "TaskPool.h"
+#include <algorithm>
+
+TaskPool::TaskPool() : steals(0), placement(NULL), runFunc(NULL), remaining(0), generation(0), idleWorkers(0), quit(false) {}
+
+TaskPool::~TaskPool()
+{
+	Shutdown();
+}
+
+void TaskPool::Initialize(uint32_t threadCount, const HostTopology* topology)
+{
+	Shutdown();
+	quit = false;
+	placement = topology;
+	threadCount = std::max(threadCount, (uint32_t)1);
+
+	workers.clear();
+	for (uint32_t w=0; w < threadCount; ++w) {
+		workers.push_back(std::unique_ptr<Worker>(new Worker()));
+	}
+
+	// new workers start on the current generation or they would wake for a run that already finished
+	uint32_t current;
+	{
+		std::lock_guard<std::mutex> guard(runLock);
+		current = generation;
+	}
+
+	// the calling thread acts as worker 0 and is never pinned since it also drives rendering
+	for (uint32_t w=1; w < threadCount; ++w) {
+		threads.push_back(std::thread(&TaskPool::WorkerLoop, this, w, current));
+	}
+}
+
+void TaskPool::Shutdown()
+{
+	{
+		std::lock_guard<std::mutex> guard(runLock);
+		quit = true;
+	}
+	runStart.notify_all();
+	for (size_t t=0; t < threads.size(); ++t) {
+		threads[t].join();
+	}
+	threads.clear();
+}
+
+void TaskPool::Run(uint32_t taskCount, const TaskFunc& func)
+{
+	if (taskCount == 0) return;
+	uint32_t workerCount = workers.size();
+
+	// contiguous runs per worker keep neighbouring tasks on one core until someone steals
+	for (uint32_t w=0; w < workerCount; ++w) {
+		uint32_t first = (uint64_t)taskCount * w / workerCount;
+		uint32_t last = (uint64_t)taskCount * (w+1) / workerCount;
+		std::lock_guard<std::mutex> guard(workers[w]->lock);
+		for (uint32_t t=first; t < last; ++t) {
+			workers[w]->tasks.push_back(t);
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(runLock);
+		runFunc = &func;
+		remaining = taskCount;
+		idleWorkers = 0;
+		generation++;
+	}
+	runStart.notify_all();
+
+	DrainTasks(0);
+
+	// every task is done, now wait for the workers to park so func can go out of scope
+	std::unique_lock<std::mutex> guard(runLock);
+	runDone.wait(guard, [this, workerCount] { return idleWorkers == workerCount - 1; });
+	runFunc = NULL;
+}
+
+void TaskPool::WorkerLoop(uint32_t index, uint32_t seen)
+{
+	if (placement != NULL) {
+		HostTopology::PinThread(placement->WorkerCpu(index));
+	}
+
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> guard(runLock);
+			runStart.wait(guard, [this, seen] { return quit || generation != seen; });
+			if (quit) return;
+			seen = generation;
+		}
+
+		DrainTasks(index);
+
+		{
+			std::lock_guard<std::mutex> guard(runLock);
+			idleWorkers++;
+		}
+		runDone.notify_one();
+	}
+}
+
+void TaskPool::DrainTasks(uint32_t index)
+{
+	uint32_t task;
+
+	// keep stealing until the whole run is finished, not just until our deque is empty
+	while (remaining.load() > 0) {
+		if (PopTask(index, task) || StealTask(index, task)) {
+			(*runFunc)(task, index);
+			remaining--;
+		} else {
+			std::this_thread::yield();
+		}
+	}
+}
+
+bool TaskPool::PopTask(uint32_t index, uint32_t& task)
+{
+	Worker& worker = *workers[index];
+	std::lock_guard<std::mutex> guard(worker.lock);
+	if (worker.tasks.empty()) return false;
+	task = worker.tasks.front();
+	worker.tasks.pop_front();
+	return true;
+}
+
+bool TaskPool::StealTask(uint32_t index, uint32_t& task)
+{
+	uint32_t workerCount = workers.size();
+
+	// take from the far end of a victim so we stay out of its way
+	for (uint32_t v=1; v < workerCount; ++v) {
+		Worker& victim = *workers[(index + v) % workerCount];
+		std::lock_guard<std::mutex> guard(victim.lock);
+		if (!victim.tasks.empty()) {
+			task = victim.tasks.back();
+			victim.tasks.pop_back();
+			steals++;
+			return true;
+		}
+	}
+	return false;
+}
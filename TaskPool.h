@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include "HostNuma.h"
+
+// fixed set of workers, each with its own task deque, idle workers steal from the others
+class TaskPool
+{
+public:
+	typedef std::function<void(uint32_t task, uint32_t worker)> TaskFunc;
+public:
+	TaskPool();
+	~TaskPool();
+	void Initialize(uint32_t threadCount, const HostTopology* topology = NULL);
+	void Run(uint32_t taskCount, const TaskFunc& func);
+	uint32_t ThreadCount() const { return workers.size(); }
+private:
+	struct Worker
+	{
+		std::deque<uint32_t> tasks;
+		std::mutex lock;
+	};
+	void WorkerLoop(uint32_t index, uint32_t seen);
+	void DrainTasks(uint32_t index);
+	bool PopTask(uint32_t index, uint32_t& task);
+	bool StealTask(uint32_t index, uint32_t& task);
+	void Shutdown();
+public:
+	std::atomic<uint64_t> steals;
+private:
+	std::vector<std::unique_ptr<Worker>> workers;
+	std::vector<std::thread> threads;
+	const HostTopology* placement;
+	std::mutex runLock;
+	std::condition_variable runStart;
+	std::condition_variable runDone;
+	const TaskFunc* runFunc;
+	std::atomic<uint32_t> remaining;
+	uint32_t generation;
+	uint32_t idleWorkers;
+	bool quit;
+};